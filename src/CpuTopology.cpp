@@ -0,0 +1,232 @@
+#include "CpuTopology.h"
+
+#include "Assert.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+namespace fs = std::filesystem;
+
+namespace olive {
+
+namespace {
+
+/*
+ * Return the first line of a sysfs file, or an empty string if not present
+ */
+std::string read_line (const fs::path &path)
+{
+  std::ifstream file (path);
+
+  std::string line;
+
+  std::getline (file, line);
+
+  boost::algorithm::trim (line);
+
+  return line;
+}
+
+int read_int (const fs::path &path, int defaultValue)
+{
+  auto line = read_line (path);
+
+  return line.empty () ? defaultValue : std::stoi (line);
+}
+
+} // namespace {
+
+CpuTopology::CpuTopology (const std::string &sysfs)
+{
+  fs::path root (sysfs);
+
+  for (int cpu : parse_cpu_list (read_line (root / "cpu" / "online")))
+  {
+    CpuInfo info;
+
+    fs::path cpuPath = root / "cpu" / ("cpu" + std::to_string (cpu));
+
+    info.cpu     = cpu;
+    info.package = read_int (cpuPath / "topology" / "physical_package_id", 0);
+    info.core    = read_int (cpuPath / "topology" / "core_id", cpu);
+    /*
+     * Without an L3 cache the cpus in a package share the last level cache
+     */
+    info.l3 = -1;
+
+    std::error_code error;
+
+    for (auto &entry : fs::directory_iterator (cpuPath / "cache", error))
+    {
+      if (read_int (entry.path () / "level", 0) == 3)
+      {
+        auto shared = parse_cpu_list (read_line (entry.path () /
+                                                 "shared_cpu_list"));
+        if (!shared.empty ())
+        {
+          info.l3 = *std::min_element (shared.begin (), shared.end ());
+        }
+      }
+    }
+
+    m_cpus.push_back (info);
+  }
+  /*
+   * Cpus are on node 0 if the system has no NUMA nodes
+   */
+  std::error_code error;
+
+  for (auto &entry : fs::directory_iterator (root / "node", error))
+  {
+    auto name = entry.path ().filename ().string ();
+
+    if (name.rfind ("node", 0) != 0 || name.size () == 4 ||
+        !std::all_of (name.begin () + 4, name.end (), ::isdigit))
+    {
+      continue;
+    }
+
+    int node = std::stoi (name.substr (4));
+
+    for (int cpu : parse_cpu_list (read_line (entry.path () / "cpulist")))
+    {
+      for (auto &info : m_cpus)
+      {
+        if (info.cpu == cpu)
+        {
+          info.node = node;
+        }
+      }
+    }
+  }
+
+  for (auto &info : m_cpus)
+  {
+    if (info.l3 == -1)
+    {
+      auto first = std::find_if (m_cpus.begin (), m_cpus.end (),
+        [&info] (const CpuInfo &other) {
+          return other.package == info.package;
+        });
+
+      info.l3 = first->cpu;
+    }
+  }
+
+  BOOST_LOG_TRIVIAL (debug) << "Discovered " << m_cpus.size ()
+                            << " online cpus in " << sysfs;
+}
+
+const CpuInfo &CpuTopology::cpu (int cpu) const
+{
+  auto info = std::find_if (m_cpus.begin (), m_cpus.end (),
+                            [cpu] (const CpuInfo &i) { return i.cpu == cpu; });
+
+  CHECK_SS (info != m_cpus.end (), "Cpu is not online: " << cpu);
+
+  return *info;
+}
+
+int CpuTopology::select (const std::string &specification)
+{
+  auto separator = specification.find (':');
+
+  if (separator == std::string::npos)
+  {
+    int cpu = std::stoi (specification);
+
+    if (cpu > -1)
+    {
+      this->cpu (cpu);
+    }
+
+    return cpu;
+  }
+
+  auto scope = specification.substr (0, separator);
+
+  CHECK_SS (scope == "l3" || scope == "node",
+            "Invalid cpu specification: " << specification);
+
+  const CpuInfo &reference =
+                        cpu (std::stoi (specification.substr (separator + 1)));
+
+  auto inScope = [&scope, &reference] (const CpuInfo &info) {
+    return (scope == "l3") ? (info.l3   == reference.l3)
+                           : (info.node == reference.node);
+  };
+
+  auto otherCore = [&reference] (const CpuInfo &info) {
+    return info.package != reference.package || info.core != reference.core;
+  };
+
+  auto selected = [this] (const CpuInfo &info) {
+    return std::find (m_selected.begin (), m_selected.end (), info.cpu)
+                                                       != m_selected.end ();
+  };
+  /*
+   * Prefer a cpu on another core which has not been selected yet, then any cpu
+   * on another core, then a hyper-thread sibling of the reference cpu
+   */
+  std::vector<std::function<bool (const CpuInfo&)>> preferences {
+    [&] (const CpuInfo &info) { return otherCore (info) && !selected (info); },
+    [&] (const CpuInfo &info) { return otherCore (info); },
+    [&] (const CpuInfo &info) { return info.cpu != reference.cpu; }
+  };
+
+  for (auto &preference : preferences)
+  {
+    for (auto &info : m_cpus)
+    {
+      if (inScope (info) && preference (info))
+      {
+        m_selected.push_back (info.cpu);
+
+        return info.cpu;
+      }
+    }
+  }
+
+  CHECK_SS (false, "No cpu available for specification: " << specification);
+
+  return -1;
+}
+
+std::vector<int> CpuTopology::parse_cpu_list (const std::string &list)
+{
+  std::vector<int> cpus;
+
+  std::vector<std::string> ranges;
+
+  boost::algorithm::split (ranges, list, boost::is_any_of (","));
+
+  for (auto &range : ranges)
+  {
+    boost::algorithm::trim (range);
+
+    if (range.empty ())
+    {
+      continue;
+    }
+
+    auto dash = range.find ('-');
+
+    int first = std::stoi (range.substr (0, dash));
+    int last  = (dash == std::string::npos)
+              ? first : std::stoi (range.substr (dash + 1));
+
+    for (int cpu = first; cpu <= last; ++cpu)
+    {
+      cpus.push_back (cpu);
+    }
+  }
+
+  return cpus;
+}
+
+} // namespace olive
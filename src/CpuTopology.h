@@ -0,0 +1,94 @@
+#ifndef OLIVE_CPU_TOPOLOGY_H
+#define OLIVE_CPU_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+namespace olive {
+
+/*
+ * Location of a cpu in the system topology
+ */
+struct CpuInfo
+{
+  int cpu     = -1;
+  /*
+   * NUMA node of the cpu
+   */
+  int node    = 0;
+  /*
+   * Physical socket of the cpu
+   */
+  int package = 0;
+  /*
+   * Physical core of the cpu, hyper-threads share a core
+   */
+  int core    = 0;
+  /*
+   * Identifier of the last level cache shared by the cpu, being the lowest cpu
+   * number sharing the cache
+   */
+  int l3      = 0;
+};
+
+/*
+ * Cpu topology of the system discovered from sysfs.
+ *
+ * Used to place producer and consumer threads so that they communicate through
+ * a shared L3 cache or at least the same NUMA node.
+ */
+class CpuTopology
+{
+public:
+  /*
+   * Read the topology of the online cpus from sysfs
+   */
+  explicit CpuTopology (const std::string &sysfs = "/sys/devices/system");
+
+  /*
+   * Return the online cpus
+   */
+  const std::vector<CpuInfo> &cpus () const { return m_cpus; }
+
+  /*
+   * Return the topology of a cpu, throws if the cpu is not online
+   */
+  const CpuInfo &cpu (int cpu) const;
+
+  /*
+   * Return the NUMA node of a cpu
+   */
+  int node (int cpu) const { return this->cpu (cpu).node; }
+
+  /*
+   * Select a cpu from a specification, returning -1 for no cpu binding:
+   *
+   *   "-1"         no binding
+   *   "<cpu>"      the cpu number
+   *   "l3:<cpu>"   a cpu on a different core sharing the L3 cache of the cpu
+   *   "node:<cpu>" a cpu on a different core on the NUMA node of the cpu
+   *
+   * The relative forms place a consumer close to a producer bound to <cpu>.
+   * Each relative selection returns a different cpu, if one is available, so
+   * that several consumers can be placed in turn.
+   *
+   * Throws if the specification is invalid or no cpu matches.
+   */
+  int select (const std::string &specification);
+
+  /*
+   * Parse a sysfs cpu list such as "0-3,8,10-11"
+   */
+  static std::vector<int> parse_cpu_list (const std::string &list);
+
+private:
+  std::vector<CpuInfo> m_cpus;
+  /*
+   * Cpus returned by relative selections
+   */
+  std::vector<int> m_selected;
+};
+
+} // namespace olive
+
+#endif // OLIVE_CPU_TOPOLOGY_H
@@ -0,0 +1,155 @@
+#ifndef OLIVE_SPMC_MULTI_SOURCE_H
+#define OLIVE_SPMC_MULTI_SOURCE_H
+
+#include "SPMCQueue.h"
+#include "detail/SharedMemory.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace olive {
+
+/*
+ * A multiple producer data source publishing a single ordered stream to an
+ * SPMCQueue.
+ *
+ * Each producer thread pushes to its own in-process single producer lane. A
+ * sequencer thread merges the lanes in to the queue, assigning the stream
+ * sequence numbers, so the queue keeps a single producer and consumers use an
+ * unchanged SPMCSink.
+ *
+ * Messages of one producer keep their order. Messages of different producers
+ * are interleaved in the order the sequencer reads them. Timestamps are taken
+ * when a message is pushed to a lane, so latency includes the merge.
+ */
+template <typename QueueType>
+class SPMCMultiSource
+{
+private:
+  SPMCMultiSource (const SPMCMultiSource &) = delete;
+  SPMCMultiSource & operator= (const SPMCMultiSource &) = delete;
+
+public:
+  /*
+   * Default capacity in bytes of the lane of each producer
+   */
+  static constexpr size_t LANE_CAPACITY_DEFAULT = 64 * 1024;
+
+  /*
+   * Create a source for a number of producer threads, publishing to a queue
+   * for use in a single process
+   */
+  SPMCMultiSource (size_t capacity, size_t producers,
+                   size_t laneCapacity = LANE_CAPACITY_DEFAULT);
+
+  /*
+   * Create a source for a number of producer threads, publishing to a queue in
+   * shared memory for use by multiple processes
+   */
+  SPMCMultiSource (const std::string &memoryName,
+                   const std::string &queueName,
+                   size_t             capacity,
+                   size_t             producers,
+                   size_t             laneCapacity = LANE_CAPACITY_DEFAULT);
+
+  /*
+   * Stops the sequencer. Messages remaining in the lanes are not published.
+   */
+  ~SPMCMultiSource ();
+
+  /*
+   * Stop producers and the sequencer
+   */
+  void stop ();
+
+  /*
+   * Return the number of producers
+   */
+  size_t producers () const { return m_lanes.size (); }
+
+  /*
+   * Serialise data from a producer to its lane
+   * Blocks until successful
+   *
+   * Only one thread may push to each producer index.
+   */
+  void next (size_t producer, const std::vector<uint8_t> &data);
+
+  /*
+   * Serialise POD data from a producer to its lane
+   * Blocks until successful
+   */
+  template<typename POD>
+  void next (size_t producer, const POD &data);
+
+  /*
+   * Reference to the queue to be shared with SPMCSink objects for
+   * inter-thread communication only
+   */
+  QueueType& queue () { return m_queue; }
+
+private:
+  /*
+   * Lane holding the messages of one producer until they are sequenced
+   */
+  using Lane = SPMCQueue<std::allocator<uint8_t>, 1>;
+
+  /*
+   * Maximum number of messages forwarded from one lane before the sequencer
+   * moves to the next lane
+   */
+  static constexpr size_t LANE_BATCH = 64;
+
+  /*
+   * Create the lanes and start the sequencer thread
+   */
+  void start (size_t producers, size_t laneCapacity);
+
+  /*
+   * Push a message to the lane of a producer, blocking until successful
+   */
+  template<typename Data>
+  void push_to_lane (size_t producer, Header &header, const Data &data);
+
+  /*
+   * Merge the lanes in to the queue until stopped
+   */
+  void sequence ();
+
+private:
+
+  alignas (CACHE_LINE_SIZE)
+  QueueType m_queue;
+
+  std::vector<std::unique_ptr<Lane>> m_lanes;
+  /*
+   * Consumer state of the sequencer for each lane
+   */
+  std::vector<detail::ConsumerState> m_laneConsumers;
+
+  alignas (CACHE_LINE_SIZE)
+  std::atomic<bool> m_stop = { false };
+  /*
+   * Sequence number of the last message published to the queue
+   */
+  uint64_t m_sequenceNumber = 0;
+
+  std::thread m_sequencer;
+};
+
+/*
+ * Helper types
+ */
+using SPMCMultiSourceProcess =
+                          SPMCMultiSource<SPMCQueue<SharedMemory::Allocator>>;
+using SPMCMultiSourceThread  =
+                          SPMCMultiSource<SPMCQueue<std::allocator<uint8_t>>>;
+
+} // namespace olive
+
+#include "SPMCMultiSource.inl"
+
+#endif // OLIVE_SPMC_MULTI_SOURCE_H
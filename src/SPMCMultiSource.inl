@@ -0,0 +1,154 @@
+#include "Assert.h"
+#include "Chrono.h"
+#include "detail/Utils.h"
+
+#include <boost/log/trivial.hpp>
+
+namespace olive {
+
+template <class QueueType>
+SPMCMultiSource<QueueType>::SPMCMultiSource (size_t capacity,
+                                             size_t producers,
+                                             size_t laneCapacity)
+: m_queue (capacity)
+{
+  start (producers, laneCapacity);
+}
+
+template <class QueueType>
+SPMCMultiSource<QueueType>::SPMCMultiSource (const std::string &memoryName,
+                                             const std::string &queueName,
+                                             size_t             capacity,
+                                             size_t             producers,
+                                             size_t             laneCapacity)
+: m_queue (memoryName, queueName, capacity)
+{
+  start (producers, laneCapacity);
+
+  BOOST_LOG_TRIVIAL(info) << "Found or created queue named '"
+    << queueName << "' with capacity of " << capacity << " bytes and "
+    << producers << " producers";
+}
+
+template <class QueueType>
+SPMCMultiSource<QueueType>::~SPMCMultiSource ()
+{
+  stop ();
+
+  if (m_sequencer.joinable ())
+  {
+    m_sequencer.join ();
+  }
+
+  for (size_t i = 0; i < m_lanes.size (); ++i)
+  {
+    m_lanes[i]->unregister_consumer (m_laneConsumers[i]);
+  }
+}
+
+template <class QueueType>
+void SPMCMultiSource<QueueType>::start (size_t producers, size_t laneCapacity)
+{
+  CHECK (producers > 0, "SPMCMultiSource requires at least one producer");
+
+  m_laneConsumers.resize (producers);
+
+  for (size_t i = 0; i < producers; ++i)
+  {
+    m_lanes.push_back (std::make_unique<Lane> (laneCapacity));
+    /*
+     * The sequencer is the single NoDrop consumer of each lane
+     */
+    m_lanes.back ()->register_consumer (m_laneConsumers[i]);
+  }
+
+  m_sequencer = std::thread ([this] () { sequence (); });
+}
+
+template <class QueueType>
+void SPMCMultiSource<QueueType>::stop ()
+{
+  m_stop = true;
+}
+
+template <class QueueType>
+void SPMCMultiSource<QueueType>::next (size_t producer,
+                                       const std::vector<uint8_t> &data)
+{
+  Header header;
+  header.size = data.size ();
+
+  push_to_lane (producer, header, data);
+}
+
+template <class QueueType>
+template<typename POD>
+void SPMCMultiSource<QueueType>::next (size_t producer, const POD &data)
+{
+  Header header;
+  header.size = sizeof (POD);
+
+  push_to_lane (producer, header, data);
+}
+
+template <class QueueType>
+template<typename Data>
+void SPMCMultiSource<QueueType>::push_to_lane (size_t producer,
+                                               Header &header,
+                                               const Data &data)
+{
+  assert (producer < m_lanes.size ());
+
+  Lane &lane = *m_lanes[producer];
+
+  header.timestamp = nanoseconds_since_epoch (Clock::now ());
+
+  while (!m_stop && !lane.push (header, data))
+  {
+    /*
+     * Re-generate the timestamp if the lane is full so that only internal
+     * latency is measured
+     */
+    header.timestamp = nanoseconds_since_epoch (Clock::now ());
+  }
+}
+
+template <class QueueType>
+void SPMCMultiSource<QueueType>::sequence ()
+{
+  Header header;
+
+  std::vector<uint8_t> data;
+
+  while (!m_stop)
+  {
+    bool idle = true;
+
+    for (size_t i = 0; i < m_lanes.size (); ++i)
+    {
+      Lane &lane = *m_lanes[i];
+
+      for (size_t n = 0; n < LANE_BATCH; ++n)
+      {
+        if (!lane.pop (header, data, m_laneConsumers[i]))
+        {
+          break;
+        }
+
+        idle = false;
+
+        header.seqNum = ++m_sequenceNumber;
+
+        while (!m_queue.push (header, data) && !m_stop)
+        { }
+      }
+    }
+
+    if (idle)
+    {
+      SPMC_CPU_PAUSE ();
+    }
+  }
+}
+
+} // namespace olive
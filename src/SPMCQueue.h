@@ -1,6 +1,8 @@
 #ifndef OLIVE_SPMC_QUEUE_H
 #define OLIVE_SPMC_QUEUE_H
 
+#include "detail/HeaderCodec.h"
+#include "detail/QueueLayout.h"
 #include "detail/SharedMemory.h"
 #include "detail/SPMCQueue.h"
 
@@ -9,45 +11,138 @@
 
 namespace olive {
 
+/*
+ * A read-only view of the next message in a queue.
+ *
+ * The payload data points into the queue memory and remains valid until the
+ * view is released. A payload which wraps around the end of the queue is
+ * copied to a buffer local to the consumer.
+ */
+struct ReadView
+{
+  Header         header;
+  const uint8_t *data   = { nullptr };
+  size_t         size   = { 0 };
+  /*
+   * Set if the payload was copied and validated, and the consumer has already
+   * advanced past the message
+   */
+  bool           copied = { false };
+};
+
 /*
  * Single producer / multiple consumer queue which wraps the functionality of
  * the detail::SPMCQueue and adds some additional functionality whiich is local
  * to the client consumer.
  *
  * The producers and consumers can be separate threads or processes.
+ *
+ * WireHeader is the format of the message headers stored in the queue, either
+ * Header or CompactHeader. Messages are always pushed and popped with a Header,
+ * which is converted to and from the queue format.
  */
 template <class Allocator,
-          uint8_t MaxNoDropConsumers = MAX_NO_DROP_CONSUMERS_DEFAULT>
+          uint8_t MaxNoDropConsumers = MAX_NO_DROP_CONSUMERS_DEFAULT,
+          bool PowerOf2Capacity = false,
+          class WireHeader = Header>
 class SPMCQueue
 {
-  using QueueType = detail::SPMCQueue<Allocator, MaxNoDropConsumers>;
+  using QueueType = detail::SPMCQueue<Allocator, MaxNoDropConsumers,
+                                      PowerOf2Capacity>;
+
+  using HeaderCodec = detail::HeaderCodec<WireHeader>;
 
 public:
+  /*
+   * The message header format stored in the queue
+   */
+  using HeaderType = WireHeader;
+
   /*
    * Construct an SPMCQueue for use by a single producer and multiple consumer
    * threads in a single process.
+   *
+   * Up to maxConsumers NoDrop consumers can be registered with the queue.
+   *
+   * The page options are applied to the queue buffer.
    */
-  SPMCQueue (size_t capacity);
+  SPMCQueue (size_t capacity, uint8_t maxConsumers = MaxNoDropConsumers,
+             const PageOptions &pages = PageOptions ());
 
   /*
    * Creates named shared memory and then constructs an SPMCQueue (or opens an
    * existing queue if available) for inter-process communication.
+   *
+   * The maximum number of NoDrop consumers is stored in the shared queue, so
+   * consumers opening an existing queue use the value set by the producer.
+   *
+   * Opening an existing queue restarts the producer. Consumers of the previous
+   * producer move to the latest data when they next request data, without
+   * reopening the shared memory.
+   *
+   * The page options are applied to the whole shared memory segment.
    */
   SPMCQueue (const std::string &memoryName,
              const std::string &queueName,
-             size_t             capacity);
+             size_t             capacity,
+             uint8_t            maxConsumers = MaxNoDropConsumers,
+             const PageOptions &pages = PageOptions ());
 
   /*
    * Open an existing shared memory SPMCQueue for use by a consumer in
    * inter-process communication.
    *
-   * Does not create shared memory or shared objects.
+   * Does not create shared memory or shared objects. The page options are
+   * applied to the whole shared memory segment.
+   *
+   * Throws if the queue was created with a different layout, for example by a
+   * producer built with a different header format or queue version.
+   */
+  SPMCQueue (const std::string &memoryName,
+             const std::string &queueName,
+             const PageOptions &pages = PageOptions ());
+
+  /*
+   * Open an existing shared memory SPMCQueue mapped read-only, for example to
+   * monitor the queue without registering as a consumer.
+   *
+   * Only the const methods may be called on a queue opened read-only.
    */
   SPMCQueue (const std::string &memoryName,
+             const std::string &queueName,
+             boost::interprocess::open_read_only_t);
+
+  /*
+   * Construct an SPMCQueue, or open an existing queue as a restarted producer,
+   * in shared memory mapped by the caller, so that several queues share one
+   * mapping of a segment. The memory must outlive the queue.
+   */
+  SPMCQueue (boost::interprocess::managed_shared_memory &memory,
+             const std::string &queueName,
+             size_t             capacity,
+             uint8_t            maxConsumers = MaxNoDropConsumers);
+
+  /*
+   * Open an existing SPMCQueue for use by a consumer in shared memory mapped by
+   * the caller. The memory must outlive the queue.
+   */
+  SPMCQueue (boost::interprocess::managed_shared_memory &memory,
              const std::string &queueName);
 
   /*
-   * Register a consumer thread or process
+   * Return the size of shared memory required by a queue with a capacity in
+   * bytes and a maximum number of NoDrop consumers
+   */
+  static size_t memory_size (size_t capacity,
+                             uint8_t maxConsumers = MaxNoDropConsumers);
+
+  /*
+   * Register a consumer thread or process.
+   *
+   * The consumer starts reading from the latest data, or from retained data
+   * when a start position is set on the consumer state. Retained messages are
+   * located from the headers pushed with them, so only queues of header framed
+   * messages support starting from retained data.
    */
   void register_consumer (detail::ConsumerState &consumer);
   /*
@@ -62,6 +157,50 @@ public:
    */
   size_t capacity () const;
 
+  /*
+   * Return the maximum number of NoDrop consumers
+   */
+  uint8_t consumer_capacity () const;
+
+  /*
+   * Set the time for which a NoDrop consumer may block the producer without
+   * reading before it is evicted and continues as a Drop consumer.
+   *
+   * Consumers whose process has exited are always evicted. A zero lease, the
+   * default, evicts no other consumers.
+   */
+  void consumer_lease (Nanoseconds lease);
+
+  /*
+   * Set the limits beyond which a lagging NoDrop consumer is demoted to a Drop
+   * consumer, bounding the time the producer is held back by slow consumers.
+   *
+   * A demoted consumer reports the messages it misses as dropped.
+   */
+  void lag_policy (const LagPolicy &policy);
+
+  /*
+   * Return the number of NoDrop consumers evicted by the producer
+   */
+  uint64_t evicted_consumers () const;
+
+  /*
+   * Return a snapshot of the queue metrics: the data published, full queue
+   * stalls, drops, evictions and the progress of each NoDrop consumer
+   */
+  QueueMetrics metrics () const;
+
+  /*
+   * Return the doorbell rung by the producer when data is published
+   */
+  detail::Doorbell &doorbell ();
+
+  /*
+   * Ring a doorbell in the same shared memory as the queue in place of the
+   * queue's own doorbell, for example the doorbell of a topic directory
+   */
+  void share_doorbell (detail::Doorbell &doorbell);
+
   /*
    * Return true if queue is empty
    */
@@ -82,7 +221,7 @@ public:
    * Push data of type POD into the queue.
    *
    * Useful if the header type has no associated data. An example would be when
-   * sending warmup messages.
+   * sending warmup messages. A Header is converted to the queue header format.
    */
   template <class Data>
   bool push (const Data &data);
@@ -105,10 +244,43 @@ public:
   template <class Header>
   bool push (const Header &header, const std::vector<uint8_t> &data);
 
+  /*
+   * Push a batch of messages, each a header and data pair, and publish them to
+   * the consumers together.
+   *
+   * Returns false without pushing any messages if the batch does not fit in
+   * the queue. The headers and data vectors must be the same size.
+   */
+  template <class Header, class Data>
+  bool push_batch (const std::vector<Header> &headers,
+                   const std::vector<Data>   &data);
+
+  /*
+   * Reserve space in the queue for a header and a payload of size bytes.
+   *
+   * Returns a pointer to the payload region in the queue which the producer can
+   * serialise data to directly, or nullptr if the queue is full. The data is
+   * published by calling commit ().
+   */
+  uint8_t *reserve (size_t size);
+
+  /*
+   * Write the header in front of the reserved payload and publish both to the
+   * consumers
+   */
+  template <class Header>
+  void commit (const Header &header);
+
   /*
    * Pop header and data from the queue
    *
    * The BufferType should have the methods resize () and data ()
+   *
+   * Messages with a type rejected by the consumer type filter are skipped
+   * without reading the payload.
+   *
+   * A Drop consumer which has been overtaken by the producer skips to the
+   * latest data and returns false. Dropped messages are counted by the consumer.
    */
   template <class BufferType>
   bool pop (Header &header, BufferType &data, detail::ConsumerState &consumer);
@@ -119,6 +291,110 @@ public:
   template <class POD>
   bool pop (POD &pod, detail::ConsumerState &consumer);
 
+  /*
+   * Return a view of the next message without copying the payload out of the
+   * queue.
+   *
+   * The consumer must release () the view before requesting the next one.
+   *
+   * Only NoDrop consumers read the payload in place. The payload is copied out
+   * of the queue for Drop consumers, replaying consumers and consumers the
+   * producer evicted, as pop () does.
+   */
+  bool read_view (ReadView &view, detail::ConsumerState &consumer);
+
+  /*
+   * Release a view returned by read_view () and advance the consumer past it.
+   *
+   * Returns false if the producer evicted the consumer and may have overwritten
+   * the payload while it was read, in which case the view must be discarded.
+   */
+  bool release (const ReadView &view, detail::ConsumerState &consumer);
+
+  /*
+   * Pass up to maxMessages messages from the consumer's current data range to
+   * callback (header, data, size) in a single loop.
+   *
+   * The progress of the consumer is published to the producer once, after the
+   * loop. Payloads of NoDrop consumers are not copied out of the queue and are
+   * only valid during the callback. If the producer evicts the consumer and
+   * overwrites a payload passed to the callback, draining stops after it. A
+   * consumer whose next header was overwritten continues draining copies as a
+   * Drop consumer.
+   *
+   * Returns the number of messages passed to the callback.
+   */
+  template <class Callback>
+  size_t drain (Callback &&callback, size_t maxMessages,
+                detail::ConsumerState &consumer);
+
+  /*
+   * Move a consumer to the first retained message with a sequence number of at
+   * least seqNum, for example to re-read a gap in the messages received.
+   *
+   * The search starts from the nearest message before seqNum recorded in the
+   * sequence number index, or from the oldest retained message. A NoDrop
+   * consumer moved back replays messages as a Drop consumer until it returns
+   * to where it was.
+   *
+   * Returns true if the message with sequence number seqNum is retained.
+   */
+  bool seek (uint64_t seqNum, detail::ConsumerState &consumer);
+
+private:
+  /*
+   * Find or construct the queue in shared memory, restarting the producer of
+   * a queue which already exists
+   */
+  void find_or_construct (boost::interprocess::managed_shared_memory &memory,
+                          const std::string &queueName,
+                          size_t             capacity,
+                          uint8_t            maxConsumers);
+
+  /*
+   * Publish the data consumed to the producer and request the range of data
+   * which is currently available to consume.
+   *
+   * Return false if there is no new data available.
+   */
+  bool update_data_range (detail::ConsumerState &consumer);
+
+  /*
+   * Pop header and data for a Drop consumer, validating the data was not
+   * overwritten by the producer while it was being read
+   */
+  template <class BufferType>
+  bool pop_drop (Header &header, BufferType &data,
+                 detail::ConsumerState &consumer);
+
+  /*
+   * Return true if a header read in place by a NoDrop consumer at position was
+   * not overwritten by the producer and describes a message within the data
+   * range of the consumer
+   */
+  bool valid_in_place (const WireHeader &wire, uint64_t position,
+                       const detail::ConsumerState &consumer) const;
+
+  /*
+   * Demote a NoDrop consumer whose data was overwritten while it was read in
+   * place. Return false if the consumer was not evicted or has no data to read
+   * as a Drop consumer.
+   */
+  bool demote_overwritten (detail::ConsumerState &consumer);
+
+  /*
+   * Return a Header in the queue header format. Other header types are stored
+   * in the queue unchanged.
+   */
+  template <class Header>
+  decltype (auto) encode (const Header &header) const;
+
+  /*
+   * Record the position of a message in the sequence number index of the queue
+   */
+  template <class Header>
+  void index (const Header &header, uint64_t position);
+
 private:
   /*
    * Memory shared between processes
@@ -134,6 +410,18 @@ private:
    */
   alignas (CACHE_LINE_SIZE)
   QueuePtr m_queue;
+  /*
+   * Start of the region returned by the last call to reserve ()
+   */
+  uint8_t *m_reserved = { nullptr };
+  /*
+   * Position of the region returned by the last call to reserve ()
+   */
+  uint64_t m_reservedPosition = { 0 };
+  /*
+   * Headers of the last batch converted to the queue header format
+   */
+  std::vector<WireHeader> m_batchHeaders;
 };
 
 } // namespace olive {
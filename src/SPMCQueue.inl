@@ -7,246 +7,1017 @@
 
 namespace olive {
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-SPMCQueue<Allocator, MaxNoDropConsumers>::SPMCQueue (size_t capacity)
-: m_queue (std::make_unique<QueueType> (capacity))
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  SPMCQueue (size_t capacity, uint8_t maxConsumers, const PageOptions &pages)
+: m_queue (std::make_unique<QueueType> (capacity, maxConsumers, pages))
 {
   CHECK (m_queue.get () != nullptr,
         "In-process SPMCQueue initialisation failed");
 
-  CHECK (capacity > sizeof (Header),
+  CHECK (capacity > sizeof (WireHeader),
         "SPMCQueue capacity must be greater than header size");
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-SPMCQueue<Allocator, MaxNoDropConsumers>::SPMCQueue (
-  const std::string &memoryName,
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  SPMCQueue (const std::string &memoryName,
   const std::string &queueName,
-  size_t capacity)
+  size_t capacity,
+  uint8_t maxConsumers,
+  const PageOptions &pages)
 {
-  CHECK (capacity > sizeof (Header),
+  CHECK (capacity > sizeof (WireHeader),
         "SPMCQueue capacity must be greater than header size");
   /*
    * Create named shared memory block, or open it if it already exists
    */
-  size_t memory_size = capacity
-                     + SharedMemory::BOOK_KEEPING
-                     + sizeof (SPMCQueue<SharedMemory::Allocator>);
-
   namespace bi = boost::interprocess;
 
   m_memory = bi::managed_shared_memory (bi::open_or_create,
-                             memoryName.c_str (), memory_size);
+                  memoryName.c_str (), memory_size (capacity, maxConsumers));
 
-  SharedMemory::Allocator allocator (m_memory.get_segment_manager ());
+  detail::prepare_pages (m_memory.get_address (), m_memory.get_size (), pages);
 
   BOOST_LOG_TRIVIAL(info) << "Find or construct shared memory object: "
     << queueName << " in named shared memory: " << memoryName;
 
-  m_queue = m_memory.find_or_construct<QueueType> (queueName.c_str())
-                                                  (capacity, allocator);
-  CHECK_SS (m_queue != nullptr,
-             "Shared memory object initialisation failed: " << queueName);
+  find_or_construct (m_memory, queueName, capacity, maxConsumers);
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-SPMCQueue<Allocator, MaxNoDropConsumers>::SPMCQueue (
-  const std::string &memoryName,
-  const std::string &queueName)
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  SPMCQueue (const std::string &memoryName,
+  const std::string &queueName,
+  const PageOptions &pages)
   : m_memory (boost::interprocess::open_only, memoryName.c_str ())
 {
   namespace bi = boost::interprocess;
 
+  detail::prepare_pages (m_memory.get_address (), m_memory.get_size (), pages);
+
   BOOST_LOG_TRIVIAL(info) << "Find shared memory object: " << queueName
                           << " in named shared memory: " << memoryName;
 
-  auto memory = m_memory.find<QueueType> (queueName.c_str());
+  m_queue = detail::find_queue<QueueType> (m_memory, queueName,
+                                           sizeof (WireHeader));
 
-  m_queue = memory.first;
+  CHECK_SS (m_queue != nullptr,
+             "Shared memory object initialisation failed: " << queueName);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  SPMCQueue (const std::string &memoryName,
+  const std::string &queueName,
+  boost::interprocess::open_read_only_t)
+  : m_memory (boost::interprocess::open_read_only, memoryName.c_str ())
+{
+  BOOST_LOG_TRIVIAL(info) << "Find shared memory object: " << queueName
+                          << " in read-only shared memory: " << memoryName;
+
+  m_queue = detail::find_queue_read_only<QueueType> (m_memory, queueName,
+                                                     sizeof (WireHeader));
 
   CHECK_SS (m_queue != nullptr,
              "Shared memory object initialisation failed: " << queueName);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  SPMCQueue (boost::interprocess::managed_shared_memory &memory,
+  const std::string &queueName,
+  size_t capacity,
+  uint8_t maxConsumers)
+{
+  CHECK (capacity > sizeof (WireHeader),
+        "SPMCQueue capacity must be greater than header size");
 
+  BOOST_LOG_TRIVIAL(info) << "Find or construct shared memory object: "
+    << queueName << " in mapped shared memory";
+
+  find_or_construct (memory, queueName, capacity, maxConsumers);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  SPMCQueue (boost::interprocess::managed_shared_memory &memory,
+  const std::string &queueName)
+{
+  BOOST_LOG_TRIVIAL(info) << "Find shared memory object: " << queueName
+                          << " in mapped shared memory";
+
+  m_queue = detail::find_queue<QueueType> (memory, queueName,
+                                           sizeof (WireHeader));
+
+  CHECK_SS (m_queue != nullptr,
+             "Shared memory object initialisation failed: " << queueName);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  find_or_construct (boost::interprocess::managed_shared_memory &memory,
+                     const std::string &queueName,
+                     size_t             capacity,
+                     uint8_t            maxConsumers)
+{
   /*
-   * check we have a single queue object, not an array of them
+   * A queue which already exists was created by an earlier producer
    */
-  CHECK_SS (memory.second == 1,
-             "Queue object: " << queueName << " should not be an array");
+  bool restart = false;
+
+  m_queue = detail::find_or_construct_queue<QueueType> (memory, queueName,
+                          capacity, maxConsumers, sizeof (WireHeader), restart);
+  CHECK_SS (m_queue != nullptr,
+             "Shared memory object initialisation failed: " << queueName);
+
+  if (restart)
+  {
+    m_queue->restart_producer ();
+  }
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  memory_size (size_t capacity, uint8_t maxConsumers)
+{
+  return SharedMemory::BOOK_KEEPING
+       + detail::queue_block_size<QueueType> (capacity, maxConsumers,
+                                              sizeof (WireHeader));
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-size_t SPMCQueue<Allocator, MaxNoDropConsumers>::capacity () const
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  capacity () const
 {
   return m_queue->capacity ();
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::empty (
-  detail::ConsumerState &consumer) const
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+uint8_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  consumer_capacity () const
+{
+  return m_queue->back_pressure ().consumer_capacity ();
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  consumer_lease (Nanoseconds lease)
+{
+  m_queue->back_pressure ().consumer_lease (lease);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  lag_policy (const LagPolicy &policy)
+{
+  m_queue->back_pressure ().lag_policy (policy);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+uint64_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  evicted_consumers () const
+{
+  return m_queue->back_pressure ().evictions ();
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+QueueMetrics
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  metrics () const
+{
+  QueueMetrics metrics;
+
+  m_queue->back_pressure ().metrics (metrics);
+
+  return metrics;
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+detail::Doorbell &
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  doorbell ()
+{
+  return m_queue->back_pressure ().doorbell ();
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  share_doorbell (detail::Doorbell &doorbell)
+{
+  m_queue->back_pressure ().share_doorbell (doorbell);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  empty (detail::ConsumerState &consumer) const
 {
   return (read_available (consumer) == 0);
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-uint64_t SPMCQueue<Allocator, MaxNoDropConsumers>::read_available (
-  detail::ConsumerState &consumer) const
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+uint64_t
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  read_available (detail::ConsumerState &consumer) const
 {
   return m_queue->read_available (consumer);
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-uint64_t SPMCQueue<Allocator, MaxNoDropConsumers>::write_available () const
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+uint64_t
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  write_available () const
 {
   return m_queue->back_pressure ().write_available ();
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
 template <class Data>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::push (const Data &data)
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  push (const Data &data)
 {
   static_assert (std::is_trivially_copyable<Data>::value,
                 "Type must be trivially copyable");
+  /*
+   * Only headers pushed without data, such as warmup messages, frame messages
+   */
+  if constexpr (std::is_same<Data, olive::Header>::value ||
+                std::is_same<Data, WireHeader>::value)
+  {
+    if (!m_queue->template push_variadic<WireHeader> (encode (data)))
+    {
+      return false;
+    }
+  }
+  else if (!m_queue->push (data))
+  {
+    return false;
+  }
 
-  return m_queue->push (data);
+  m_queue->back_pressure ().published (1);
+
+  return true;
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
 template <class Header, class Data>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::push (
-  const Header  &header,
-  const Data    &data)
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  push (const Header &header, const Data &data)
 {
   static_assert (std::is_trivially_copyable<Header>::value,
                 "Header type must be trivially copyable");
   static_assert (std::is_trivially_copyable<Data>::value,
                 "Data type must be trivially copyable");
 
-  return m_queue->push_variadic (header, data);
+  uint64_t position = m_queue->back_pressure ().claimed_total ();
+
+  if (!m_queue->template push_variadic<WireHeader> (encode (header), data))
+  {
+    return false;
+  }
+
+  m_queue->back_pressure ().published (1);
+
+  index (header, position);
+
+  return true;
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
 template <class Header>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::push (
-  const Header &header,
-  const std::vector<uint8_t> &data)
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  push (const Header &header, const std::vector<uint8_t> &data)
 {
   static_assert (std::is_trivially_copyable<Header>::value,
                 "Header type must be trivially copyable");
 
-  return m_queue->push_variadic (header, data);
+  uint64_t position = m_queue->back_pressure ().claimed_total ();
+
+  if (!m_queue->template push_variadic<WireHeader> (encode (header), data))
+  {
+    return false;
+  }
+
+  m_queue->back_pressure ().published (1);
+
+  index (header, position);
+
+  return true;
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-void SPMCQueue<Allocator, MaxNoDropConsumers>::register_consumer (
-  detail::ConsumerState &consumer)
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+template <class Header, class Data>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  push_batch (const std::vector<Header> &headers, const std::vector<Data> &data)
 {
+  static_assert (std::is_trivially_copyable<Header>::value,
+                "Header type must be trivially copyable");
+
+  assert (headers.size () == data.size ());
+
+  uint64_t position = m_queue->back_pressure ().claimed_total ();
+
+  bool pushed = false;
+
+  if constexpr (std::is_same<Header, olive::Header>::value &&
+                !std::is_same<WireHeader, olive::Header>::value)
+  {
+    m_batchHeaders.resize (headers.size ());
+
+    for (size_t i = 0; i < headers.size (); ++i)
+    {
+      m_batchHeaders[i] = encode (headers[i]);
+    }
+
+    pushed = m_queue->push_batch (m_batchHeaders.data (), data.data (),
+                                  headers.size ());
+  }
+  else
+  {
+    pushed = m_queue->push_batch (headers.data (), data.data (),
+                                  headers.size ());
+  }
+
+  if (!pushed)
+  {
+    return false;
+  }
+
+  m_queue->back_pressure ().published (headers.size ());
+
+  for (size_t i = 0; i < headers.size (); ++i)
+  {
+    index (headers[i], position);
+
+    position += sizeof (WireHeader) + get_size (data[i]);
+  }
+
+  return true;
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+uint8_t *
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  reserve (size_t size)
+{
+  m_reserved = m_queue->template reserve<WireHeader> (
+                                                  sizeof (WireHeader) + size);
+
+  if (m_reserved == nullptr)
+  {
+    return nullptr;
+  }
+  /*
+   * The region is the last data claimed, after any padding
+   */
+  m_reservedPosition = m_queue->back_pressure ().claimed_total ()
+                     - sizeof (WireHeader) - size;
+
+  return m_reserved + sizeof (WireHeader);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+template <class Header>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  commit (const Header &header)
+{
+  static_assert (std::is_trivially_copyable<Header>::value,
+                "Header type must be trivially copyable");
+
+  assert (m_reserved != nullptr);
+
+  const auto &wire = encode (header);
+
+  static_assert (sizeof (wire) == sizeof (WireHeader),
+                "Header type must be the size of the queue header");
+
+  std::memcpy (m_reserved, &wire, sizeof (WireHeader));
+
+  m_queue->commit ();
+
+  m_queue->back_pressure ().published (1);
+
+  index (header, m_reservedPosition);
+
+  m_reserved = nullptr;
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  register_consumer (detail::ConsumerState &consumer)
+{
+  if (consumer.registered ())
+  {
+    return;
+  }
+
   m_queue->register_consumer (consumer);
+
+  if (consumer.start ().origin == StartPosition::SequenceNumber)
+  {
+    uint64_t seqNum = consumer.start ().seqNum;
+
+    seek (seqNum, consumer);
+    /*
+     * Messages from seqNum which are no longer retained are counted as dropped
+     */
+    if (seqNum > 1)
+    {
+      consumer.sequence_number (seqNum - 1);
+    }
+  }
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  seek (uint64_t seqNum, detail::ConsumerState &consumer)
+{
+  auto &backPressure = m_queue->back_pressure ();
+  /*
+   * Publish the progress of the consumer so that its position is known
+   */
+  backPressure.update_consumer_state (consumer);
+
+  consumer.data_range ().read_available (0);
+  /*
+   * A Drop consumer is not protected by back-pressure, so it moves to the
+   * latest data and seeks back from there
+   */
+  if (consumer.mode () == ConsumerMode::Drop && !consumer.replaying ())
+  {
+    backPressure.resync (consumer);
+  }
+
+  uint64_t oldest  = m_queue->oldest_position ();
+  uint64_t indexed = 0;
+
+  WireHeader wire;
+  /*
+   * Start from the nearest indexed message before seqNum if it is still
+   * retained, otherwise from the oldest retained message
+   */
+  if (m_queue->indexed_position (seqNum, indexed) && indexed > oldest &&
+      indexed < backPressure.consumer_position (consumer))
+  {
+    backPressure.rewind (consumer, indexed);
+
+    m_queue->peek (wire, consumer);
+
+    const uint64_t indexedSeqNum = seqNum - MODULUS_POWER_OF_2 (seqNum,
+                                                  QueueType::INDEX_INTERVAL);
+
+    if (backPressure.overwritten (indexed) || wire.type == PADDING_MESSAGE_TYPE
+        || wire.seqNum != static_cast<decltype (wire.seqNum)> (indexedSeqNum))
+    {
+      backPressure.rewind (consumer, oldest);
+    }
+  }
+  else
+  {
+    backPressure.rewind (consumer, oldest);
+  }
+
+  Header header;
+
+  while (!consumer.data_range ().empty () || update_data_range (consumer))
+  {
+    uint64_t position = consumer.position ()
+                      + consumer.data_range ().consumed ();
+
+    m_queue->peek (wire, consumer);
+    /*
+     * A header read as by a Drop consumer is only trusted if the producer has
+     * not begun overwriting it. If it has, the consumer skips ahead.
+     */
+    if (consumer.mode () == ConsumerMode::Drop &&
+        backPressure.overwritten (position))
+    {
+      backPressure.resync (consumer);
+
+      return false;
+    }
+
+    if (consumer.accepts (wire.type))
+    {
+      HeaderCodec::decode (wire, header, m_queue->timestamp_base (), consumer);
+
+      if (header.seqNum >= seqNum)
+      {
+        return (header.seqNum == seqNum);
+      }
+    }
+
+    m_queue->skip (sizeof (WireHeader) + wire.size, consumer);
+
+    consumer.data_range ().consumed (sizeof (WireHeader) + wire.size);
+  }
+
+  return false;
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-void SPMCQueue<Allocator, MaxNoDropConsumers>::unregister_consumer (
-  detail::ConsumerState &consumer)
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  unregister_consumer (detail::ConsumerState &consumer)
 {
   m_queue->unregister_consumer (consumer);
 }
-template <class Allocator, uint8_t MaxNoDropConsumers>
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  update_data_range (detail::ConsumerState &consumer)
+{
+  auto &backPressure = m_queue->back_pressure ();
+  /*
+   * A consumer of a restarted producer continues from the latest data of the
+   * new producer
+   */
+  if (SPMC_EXPECT_FALSE (m_queue->producer_restarted (consumer)))
+  {
+    backPressure.restart_consumer (consumer);
+
+    consumer.sequence_number_base (m_queue->sequence_number_base ());
+  }
+  else
+  {
+    backPressure.update_consumer_state (consumer);
+  }
+  /*
+   * Get the size of data available in the queue for a consumer
+   */
+  size_t read_available = backPressure.read_available (consumer);
+  /*
+   * Update the consumable range if new data is available
+   */
+  consumer.data_range ().read_available (read_available);
+
+  return (read_available > 0);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
 template <class BufferType>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::pop (
-  Header     &header,
-  BufferType &data,
-  detail::ConsumerState &consumer)
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  pop (Header &header, BufferType &data, detail::ConsumerState &consumer)
 {
   /*
    * If all available data in a consumer has been consumed, request more data to
    * be added to the consumer cache
    */
-  if (consumer.data_range ().empty ())
+  if (consumer.data_range ().empty () && !update_data_range (consumer))
   {
-    auto &backPressure = m_queue->back_pressure ();
+    return false;
+  }
 
-    backPressure.update_consumer_state (consumer);
+  if (consumer.mode () == ConsumerMode::Drop)
+  {
+    return pop_drop (header, data, consumer);
+  }
+  WireHeader wire;
+
+  uint64_t position = consumer.position () + consumer.data_range ().consumed ();
+
+  while (true)
+  {
     /*
-     * Get the size of data available in the queue for a consumer
+     * The header is read before it is validated, as it may be overwritten by
+     * the producer once it evicts the consumer
      */
-    size_t read_available = backPressure.read_available (consumer);
+    m_queue->peek (wire, consumer);
+
+    if (SPMC_EXPECT_FALSE (!valid_in_place (wire, position, consumer)))
+    {
+      return demote_overwritten (consumer) && pop_drop (header, data, consumer);
+    }
+
+    m_queue->skip (sizeof (WireHeader), consumer);
+
+    if (SPMC_EXPECT_TRUE (consumer.accepts (wire.type)))
+    {
+      HeaderCodec::decode (wire, header, m_queue->timestamp_base (), consumer);
+
+      consumer.consumed_sequence_number (header.seqNum);
+
+      data.resize (header.size);
+
+      m_queue->pop (data.data (), header.size, consumer);
+
+      consumer.data_range ().consumed (sizeof (WireHeader) + header.size);
+      /*
+       * The next update demotes a consumer evicted by the producer
+       */
+      return !m_queue->back_pressure ().overwritten (consumer, position);
+    }
     /*
-     * Update the consumable range if new data is available
+     * Skip warmup messages, padding at the end of the queue and messages
+     * rejected by the type filter without reading the payload
      */
-    consumer.data_range ().read_available (read_available);
+    m_queue->skip (wire.size, consumer);
+
+    consumer.data_range ().consumed (sizeof (WireHeader) + wire.size);
+
+    if (consumer.data_range ().empty () && !update_data_range (consumer))
+    {
+      return false;
+    }
     /*
-     * Return false if no new data is available
+     * Updating the data range may find the consumer was evicted by the producer
      */
-    if (read_available == 0)
+    if (SPMC_EXPECT_FALSE (consumer.mode () == ConsumerMode::Drop))
     {
-      return false;
+      return pop_drop (header, data, consumer);
     }
+
+    position = consumer.position () + consumer.data_range ().consumed ();
   }
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+template <class POD>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  pop (POD &pod, detail::ConsumerState &consumer)
+{
+  /*
+   * If all available data in a consumer has been consumed, request more data to
+   * be added to the consumer cache
+   */
+  if (consumer.data_range ().empty () && !update_data_range (consumer))
+  {
+    return false;
+  }
+  uint64_t position = consumer.position () + consumer.data_range ().consumed ();
   /*
    * Test caching all available consumer data
    */
-  if (m_queue->pop (header, consumer))
+  if (m_queue->pop (pod, consumer))
+  {
+    consumer.data_range ().consumed (sizeof (POD));
+
+    if (consumer.mode () == ConsumerMode::Drop &&
+        m_queue->back_pressure ().overwritten (position))
+    {
+      m_queue->back_pressure ().resync (consumer);
+
+      return false;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+template <class BufferType>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  pop_drop (Header &header, BufferType &data, detail::ConsumerState &consumer)
+{
+  auto &backPressure = m_queue->back_pressure ();
+
+  uint64_t position = 0;
+
+  WireHeader wire;
+
+  while (true)
+  {
+    position = consumer.position () + consumer.data_range ().consumed ();
+    /*
+     * The header is only trusted if the producer has not begun overwriting it
+     */
+    m_queue->pop (wire, consumer);
+
+    if (backPressure.overwritten (position))
+    {
+      backPressure.resync (consumer);
+
+      return false;
+    }
+
+    if (SPMC_EXPECT_TRUE (consumer.accepts (wire.type)))
+    {
+      break;
+    }
+    /*
+     * Skip warmup, padding and filtered messages without reading the payload
+     */
+    m_queue->skip (wire.size, consumer);
+
+    consumer.data_range ().consumed (sizeof (WireHeader) + wire.size);
+
+    if (consumer.data_range ().empty () && !update_data_range (consumer))
+    {
+      return false;
+    }
+  }
+
+  HeaderCodec::decode (wire, header, m_queue->timestamp_base (), consumer);
+
+  data.resize (header.size);
+
+  m_queue->pop (data.data (), header.size, consumer);
+
+  if (backPressure.overwritten (position))
+  {
+    backPressure.resync (consumer);
+
+    return false;
+  }
+
+  consumer.data_range ().consumed (sizeof (WireHeader) + header.size);
+
+  uint64_t dropped = consumer.sequence_number (header.seqNum);
+
+  if (SPMC_EXPECT_FALSE (dropped > 0))
+  {
+    backPressure.dropped (dropped);
+  }
+
+  return true;
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  valid_in_place (const WireHeader &wire, uint64_t position,
+                  const detail::ConsumerState &consumer) const
+{
+  /*
+   * The header read is trusted only if it was not overwritten, so a size torn
+   * by the producer is never used to read past the data published
+   */
+  return (!m_queue->back_pressure ().overwritten (consumer, position) &&
+          sizeof (WireHeader) + wire.size
+            <= consumer.data_range ().read_available ());
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  demote_overwritten (detail::ConsumerState &consumer)
+{
+  /*
+   * The update demotes an evicted consumer to read from the position of the
+   * overwritten header
+   */
+  return (update_data_range (consumer) &&
+          consumer.mode () == ConsumerMode::Drop);
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  read_view (ReadView &view, detail::ConsumerState &consumer)
+{
+  if (consumer.data_range ().empty () && !update_data_range (consumer))
+  {
+    return false;
+  }
+  WireHeader wire;
+  /*
+   * Updating the data range may find the consumer was evicted by the producer
+   */
+  while (SPMC_EXPECT_TRUE (consumer.mode () == ConsumerMode::NoDrop))
   {
-    if (header.type == WARMUP_MESSAGE_TYPE)
+    uint64_t position = consumer.position ()
+                      + consumer.data_range ().consumed ();
+    /*
+     * Copy the header out of the queue as it may not be aligned
+     */
+    m_queue->peek (wire, consumer);
+
+    if (SPMC_EXPECT_FALSE (!valid_in_place (wire, position, consumer)))
     {
-      // Warmup messages do not have a payload and are not used by the consumer
-      consumer.data_range ().consumed (sizeof (Header));
+      if (!demote_overwritten (consumer))
+      {
+        return false;
+      }
 
+      break;
+    }
+
+    if (SPMC_EXPECT_TRUE (consumer.accepts (wire.type)))
+    {
+      HeaderCodec::decode (wire, view.header, m_queue->timestamp_base (),
+                           consumer);
+
+      consumer.consumed_sequence_number (view.header.seqNum);
+
+      view.size   = view.header.size;
+      view.data   = m_queue->read_pointer (sizeof (WireHeader), view.size,
+                                           consumer);
+      view.copied = false;
+
+      return true;
+    }
+    /*
+     * Skip warmup, padding and filtered messages without reading the payload
+     */
+    m_queue->skip (sizeof (WireHeader) + wire.size, consumer);
+
+    consumer.data_range ().consumed (sizeof (WireHeader) + wire.size);
+
+    if (consumer.data_range ().empty () && !update_data_range (consumer))
+    {
       return false;
     }
+  }
+  /*
+   * Data which may be overwritten is copied and validated
+   */
+  auto &data = consumer.wrap_buffer ();
 
-    data.resize (header.size);
+  if (!pop_drop (view.header, data, consumer))
+  {
+    return false;
+  }
 
-    m_queue->pop (data.data (), header.size, consumer);
+  view.size   = data.size ();
+  view.data   = data.data ();
+  view.copied = true;
 
-    consumer.data_range ().consumed (sizeof (Header) + header.size);
+  return true;
+}
 
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  release (const ReadView &view, detail::ConsumerState &consumer)
+{
+  if (view.copied)
+  {
     return true;
   }
 
-  return false;
+  uint64_t position = consumer.position () + consumer.data_range ().consumed ();
+
+  m_queue->skip (sizeof (WireHeader) + view.size, consumer);
+
+  consumer.data_range ().consumed (sizeof (WireHeader) + view.size);
+
+  return !m_queue->back_pressure ().overwritten (consumer, position);
 }
 
-template <class Allocator, uint8_t MaxNoDropConsumers>
-template <class POD>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::pop (
-  POD &pod,
-  detail::ConsumerState &consumer)
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+template <class Callback>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  drain (Callback &&callback, size_t maxMessages,
+         detail::ConsumerState &consumer)
 {
+  size_t count = 0;
+
+  Header header;
   /*
-   * If all available data in a consumer has been consumed, request more
+   * Updating the data range may find the consumer was evicted by the producer
    */
-  if (consumer.data_range ().empty ())
+  if (consumer.mode () == ConsumerMode::NoDrop &&
+      consumer.data_range ().empty () && !update_data_range (consumer))
   {
-    auto &backPressure = m_queue->back_pressure ();
+    return 0;
+  }
 
-    backPressure.update_consumer_state (consumer);
+  if (consumer.mode () == ConsumerMode::Drop)
+  {
     /*
-     * Get the size of data available in the queue for a consumer
+     * Data read by a Drop consumer must be copied and validated before use
      */
-    size_t read_available = backPressure.read_available (consumer);
+    auto &data = consumer.wrap_buffer ();
+
+    while (count < maxMessages && pop (header, data, consumer))
+    {
+      callback (header, data.data (), data.size ());
+
+      ++count;
+    }
+
+    return count;
+  }
+
+  auto &backPressure = m_queue->back_pressure ();
+
+  WireHeader wire;
+
+  while (count < maxMessages && !consumer.data_range ().empty ())
+  {
+    uint64_t position = consumer.position ()
+                      + consumer.data_range ().consumed ();
+
+    m_queue->peek (wire, consumer);
     /*
-     * Update the consumer range with current data is availability
+     * The producer overwrote the header after evicting the consumer, which
+     * continues draining copies of the data as a Drop consumer
      */
-    consumer.data_range ().read_available (read_available);
+    if (SPMC_EXPECT_FALSE (!valid_in_place (wire, position, consumer)))
+    {
+      if (!demote_overwritten (consumer))
+      {
+        return count;
+      }
+
+      return count + drain (std::forward<Callback> (callback),
+                            maxMessages - count, consumer);
+    }
+
+    if (SPMC_EXPECT_TRUE (consumer.accepts (wire.type)))
+    {
+      HeaderCodec::decode (wire, header, m_queue->timestamp_base (), consumer);
+
+      consumer.consumed_sequence_number (header.seqNum);
+
+      callback (header,
+                m_queue->read_pointer (sizeof (WireHeader), wire.size,
+                                       consumer),
+                header.size);
+
+      ++count;
+    }
+
+    m_queue->skip (sizeof (WireHeader) + wire.size, consumer);
+
+    consumer.data_range ().consumed (sizeof (WireHeader) + wire.size);
     /*
-     * Return if no new data is available
+     * Stop once the producer has evicted the consumer and overwritten its data,
+     * the update below then demotes the consumer
      */
-    if (read_available == 0)
+    if (SPMC_EXPECT_FALSE (backPressure.overwritten (consumer, position)))
     {
-      return false;
+      break;
     }
   }
   /*
-   * Test caching all available consumer data
+   * Publish the data consumed to the producer
    */
-  if (m_queue->pop (pod, consumer))
-  {
-    consumer.data_range ().consumed (sizeof (POD));
+  update_data_range (consumer);
 
-    return true;
+  return count;
+}
+
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+template <class Header>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  index (const Header &header, uint64_t position)
+{
+  if constexpr (std::is_same<Header, olive::Header>::value)
+  {
+    m_queue->index (header.seqNum, position);
   }
+}
 
-  return false;
+template <class Allocator, uint8_t MaxNoDropConsumers, bool PowerOf2Capacity,
+          class WireHeader>
+template <class Header>
+decltype (auto)
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity, WireHeader>::
+  encode (const Header &header) const
+{
+  if constexpr (std::is_same<Header, olive::Header>::value)
+  {
+    /*
+     * Keep the timestamps pushed near the timestamp base of compact headers
+     */
+    if (SPMC_EXPECT_FALSE (HeaderCodec::rebase (header.timestamp,
+                                                m_queue->timestamp_base ())))
+    {
+      m_queue->timestamp_base (header.timestamp);
+    }
+
+    return HeaderCodec::encode (header);
+  }
+  else
+  {
+    return header;
+  }
 }
 
 } // namespace olive {
@@ -2,9 +2,12 @@
 #define OLIVE_SPMC_SINK_H
 
 #include "SPMCQueue.h"
+#include "WaitStrategy.h"
 #include "detail/SharedMemory.h"
 
 #include <atomic>
+#include <functional>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -18,8 +21,11 @@ namespace olive {
  *
  * If the SPMCSink is constructed to allow dropping of messages then it will
  * not exert back-pressure on the server.
+ *
+ * The WaitStrategy sets how the blocking methods wait while the queue is empty,
+ * see WaitStrategy.h
  */
-template <typename QueueType>
+template <typename QueueType, typename WaitStrategy = BusySpinWait>
 class SPMCSink
 {
 private:
@@ -28,15 +34,24 @@ private:
 
 public:
   /*
-   * Initialise a sink to consume data from named shared memory
+   * Initialise a sink to consume data from named shared memory, applying the
+   * page options to the shared memory.
+   *
+   * The sink starts from the latest data unless a start position in the data
+   * retained in the queue is requested, so that a restarted client can recover
+   * the messages it missed.
    */
-  SPMCSink (const std::string &memoryName, const std::string &queueName);
+  SPMCSink (const std::string &memoryName, const std::string &queueName,
+            ConsumerMode mode = ConsumerMode::NoDrop,
+            const PageOptions &pages = PageOptions (),
+            const StartPosition &start = StartPosition ());
 
   /*
    * Initialise a sink consuming from a queue shared between threads in a
    * single process.
    */
-  SPMCSink (QueueType &queue);
+  SPMCSink (QueueType &queue, ConsumerMode mode = ConsumerMode::NoDrop,
+            const StartPosition &start = StartPosition ());
 
   ~SPMCSink ();
 
@@ -46,7 +61,8 @@ public:
   void stop ();
 
   /*
-   * Retrieve the next packet of data, non-blocking
+   * Retrieve the next packet of data, blocking until a packet is available or
+   * the sink is stopped
    */
   template<typename Vector>
   bool next (Header &header, Vector &data);
@@ -57,18 +73,81 @@ public:
   template<typename Vector>
   bool next_non_blocking (Header &header, Vector &data);
 
-private:
   /*
-   * Pull data from the shared queue.
+   * Pop the next POD pushed without a header, for example from a SPMCSlotQueue.
+   * Blocks until a POD is available or the sink is stopped.
+   */
+  template<typename POD>
+  bool pop (POD &data);
+
+  /*
+   * Pop the next POD pushed without a header, non-blocking
+   */
+  template<typename POD>
+  bool pop_non_blocking (POD &data);
+
+  /*
+   * Retrieve a view of the next packet of data without copying the payload out
+   * of the queue. Blocks until a packet is available or the sink is stopped.
    *
-   * A placeholder function for backoff strategy implementations
+   * The view must be released before requesting the next packet.
+   */
+  bool read_view (ReadView &view);
+
+  /*
+   * Release a view returned by read_view (). Returns false if the view was
+   * overwritten while it was read and must be discarded.
    */
-  bool receive (Header &header, std::vector<uint8_t> &data);
+  bool release (const ReadView &view);
+
+  /*
+   * Callback passed the header, payload data and payload size of a message
+   */
+  using DrainCallback = std::function<void (const Header&,
+                                            const uint8_t*, size_t)>;
+  /*
+   * Pass up to maxMessages of the messages currently available to a callback
+   * in a single loop, publishing progress to the producer once at the end.
+   * Non-blocking.
+   *
+   * Payload data is only valid for the duration of the callback.
+   *
+   * Returns the number of messages consumed.
+   */
+  size_t drain (const DrainCallback &callback,
+                size_t maxMessages = std::numeric_limits<size_t>::max ());
+
+  /*
+   * Drain messages to a functor, which may be inlined into the drain loop
+   */
+  template<typename Callback>
+  size_t drain (Callback &&callback,
+                size_t maxMessages = std::numeric_limits<size_t>::max ());
+
+  /*
+   * Set the message types received by the sink. Messages of other types are
+   * skipped without reading their payload.
+   */
+  void type_filter (const TypeFilter &filter);
+
+  /*
+   * Return the number of messages dropped by a sink which allows dropping of
+   * messages
+   */
+  uint64_t dropped () const;
+
+  /*
+   * Return true if a sink which did not allow dropping of messages was demoted
+   * by the server and now drops messages when it falls behind
+   */
+  bool evicted () const;
 
 private:
 
   bool m_stop = { false };
 
+  WaitStrategy m_wait;
+
   detail::ConsumerState m_consumer;
 
   std::unique_ptr<QueueType> m_queuePtr;
@@ -5,63 +5,159 @@
 
 namespace olive {
 
-template <typename QueueType>
-SPMCSink<QueueType>::SPMCSink (const std::string &memoryName,
-                        const std::string &queueName)
-: m_queuePtr (std::make_unique<QueueType> (memoryName, queueName)),
+template <typename QueueType, typename WaitStrategy>
+SPMCSink<QueueType, WaitStrategy>::SPMCSink (const std::string &memoryName,
+                                             const std::string &queueName,
+                                             ConsumerMode mode,
+                                             const PageOptions &pages,
+                                             const StartPosition &start)
+: m_consumer (mode),
+  m_queuePtr (std::make_unique<QueueType> (memoryName, queueName, pages)),
   m_queue (*m_queuePtr)
 {
+  m_consumer.start (start);
+
   m_queue.register_consumer (m_consumer);
 }
 
-template <typename QueueType>
-SPMCSink<QueueType>::SPMCSink (QueueType &queue)
-: m_queue (queue)
+template <typename QueueType, typename WaitStrategy>
+SPMCSink<QueueType, WaitStrategy>::SPMCSink (QueueType &queue,
+                                             ConsumerMode mode,
+                                             const StartPosition &start)
+: m_consumer (mode),
+  m_queue (queue)
 {
+  m_consumer.start (start);
+
   m_queue.register_consumer (m_consumer);
 }
 
-template <typename QueueType>
-SPMCSink<QueueType>::~SPMCSink ()
+template <typename QueueType, typename WaitStrategy>
+SPMCSink<QueueType, WaitStrategy>::~SPMCSink ()
 {
   stop ();
 
   m_queue.unregister_consumer (m_consumer);
 }
 
-template <typename QueueType>
-void SPMCSink<QueueType>::stop ()
+template <typename QueueType, typename WaitStrategy>
+void SPMCSink<QueueType, WaitStrategy>::stop ()
 {
   m_stop = true;
 }
 
-template <typename QueueType>
+template <typename QueueType, typename WaitStrategy>
 template<typename Vector>
-bool SPMCSink<QueueType>::next (Header &header, Vector &data)
+bool SPMCSink<QueueType, WaitStrategy>::next (Header &header, Vector &data)
 {
   while (!m_stop)
   {
     if (m_queue.pop (header, data, m_consumer))
     {
+      m_wait.reset (m_queue.doorbell ());
       return true;
     }
+
+    m_wait.idle (m_queue.doorbell ());
   }
 
+  m_wait.reset (m_queue.doorbell ());
+
   return false;
 }
 
-template <typename QueueType>
+template <typename QueueType, typename WaitStrategy>
 template<typename Vector>
-bool SPMCSink<QueueType>::next_non_blocking (Header &header, Vector &data)
+bool SPMCSink<QueueType, WaitStrategy>::next_non_blocking (Header &header,
+                                                          Vector &data)
+{
+  return (m_queue.pop (header, data, m_consumer));
+}
+
+template <typename QueueType, typename WaitStrategy>
+template<typename POD>
+bool SPMCSink<QueueType, WaitStrategy>::pop (POD &data)
+{
+  while (!m_stop)
+  {
+    if (m_queue.pop (data, m_consumer))
+    {
+      m_wait.reset (m_queue.doorbell ());
+      return true;
+    }
+
+    m_wait.idle (m_queue.doorbell ());
+  }
+
+  m_wait.reset (m_queue.doorbell ());
+
+  return false;
+}
+
+template <typename QueueType, typename WaitStrategy>
+template<typename POD>
+bool SPMCSink<QueueType, WaitStrategy>::pop_non_blocking (POD &data)
+{
+  return m_queue.pop (data, m_consumer);
+}
+
+template <typename QueueType, typename WaitStrategy>
+bool SPMCSink<QueueType, WaitStrategy>::read_view (ReadView &view)
+{
+  while (!m_stop)
+  {
+    if (m_queue.read_view (view, m_consumer))
+    {
+      m_wait.reset (m_queue.doorbell ());
+      return true;
+    }
+
+    m_wait.idle (m_queue.doorbell ());
+  }
+
+  m_wait.reset (m_queue.doorbell ());
+
+  return false;
+}
+
+template <typename QueueType, typename WaitStrategy>
+bool SPMCSink<QueueType, WaitStrategy>::release (const ReadView &view)
+{
+  return m_queue.release (view, m_consumer);
+}
+
+template <typename QueueType, typename WaitStrategy>
+size_t SPMCSink<QueueType, WaitStrategy>::drain (
+  const DrainCallback &callback, size_t maxMessages)
+{
+  return m_queue.drain (callback, maxMessages, m_consumer);
+}
+
+template <typename QueueType, typename WaitStrategy>
+template<typename Callback>
+size_t SPMCSink<QueueType, WaitStrategy>::drain (Callback &&callback,
+                                                 size_t maxMessages)
+{
+  return m_queue.drain (std::forward<Callback> (callback), maxMessages,
+                        m_consumer);
+}
+
+template <typename QueueType, typename WaitStrategy>
+void SPMCSink<QueueType, WaitStrategy>::type_filter (const TypeFilter &filter)
+{
+  m_consumer.type_filter (filter);
+}
+
+template <typename QueueType, typename WaitStrategy>
+uint64_t SPMCSink<QueueType, WaitStrategy>::dropped () const
 {
-  return (m_queue.pop (header, data));
+  return m_consumer.dropped ();
 }
 
-// TODO receive policies (eg backoff/yield)
-template <typename QueueType>
-bool SPMCSink<QueueType>::receive (Header &header, std::vector<uint8_t> &data)
+template <typename QueueType, typename WaitStrategy>
+bool SPMCSink<QueueType, WaitStrategy>::evicted () const
 {
-  return (SPMC_EXPECT_TRUE (m_queue.pop (header, data)));
+  return m_consumer.evicted ();
 }
 
 }
@@ -0,0 +1,148 @@
+#ifndef OLIVE_SPMC_SLOT_QUEUE_H
+#define OLIVE_SPMC_SLOT_QUEUE_H
+
+#include "detail/QueueLayout.h"
+#include "detail/SharedMemory.h"
+#include "detail/SPMCSlotQueue.h"
+
+#include <memory>
+#include <string>
+
+namespace olive {
+
+/*
+ * Single producer / multiple consumer queue of fixed size slots holding values
+ * of a trivially copyable type T, for streams where every message is the same
+ * POD type.
+ *
+ * Values are copied to and from cache line aligned slots without headers, so
+ * there is no serialisation or wrapping of data around the end of the queue.
+ *
+ * The capacity is a number of slots which must be a power of two. NoDrop and
+ * Drop consumers behave as for SPMCQueue. The queue can be used with SPMCSource
+ * push () and SPMCSink pop ().
+ */
+template <class T, class Allocator,
+          uint8_t MaxNoDropConsumers = MAX_NO_DROP_CONSUMERS_DEFAULT>
+class SPMCSlotQueue
+{
+  using QueueType = detail::SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>;
+
+public:
+  /*
+   * Construct a slot queue for use by a single producer and multiple consumer
+   * threads in a single process. The page options are applied to the slots.
+   */
+  SPMCSlotQueue (size_t capacity, uint8_t maxConsumers = MaxNoDropConsumers,
+                 const PageOptions &pages = PageOptions ());
+
+  /*
+   * Creates named shared memory and then constructs a slot queue (or opens an
+   * existing queue if available) for inter-process communication.
+   *
+   * The page options are applied to the whole shared memory segment.
+   */
+  SPMCSlotQueue (const std::string &memoryName,
+                 const std::string &queueName,
+                 size_t             capacity,
+                 uint8_t            maxConsumers = MaxNoDropConsumers,
+                 const PageOptions &pages = PageOptions ());
+
+  /*
+   * Open an existing shared memory slot queue for use by a consumer in
+   * inter-process communication
+   */
+  SPMCSlotQueue (const std::string &memoryName,
+                 const std::string &queueName,
+                 const PageOptions &pages = PageOptions ());
+
+  /*
+   * Return the size of shared memory required by a queue with a capacity in
+   * slots and a maximum number of NoDrop consumers
+   */
+  static size_t memory_size (size_t capacity,
+                             uint8_t maxConsumers = MaxNoDropConsumers);
+
+  /*
+   * Register a consumer thread or process
+   */
+  void register_consumer (detail::ConsumerState &consumer);
+
+  /*
+   * Inform producer that a consumer is stopping
+   */
+  void unregister_consumer (detail::ConsumerState &consumer);
+
+  /*
+   * Return the number of slots in the queue
+   */
+  size_t capacity () const;
+
+  /*
+   * Set the time for which a NoDrop consumer may block the producer without
+   * reading before it is evicted and continues as a Drop consumer.
+   *
+   * Consumers whose process has exited are always evicted. A zero lease, the
+   * default, evicts no other consumers.
+   */
+  void consumer_lease (Nanoseconds lease);
+
+  /*
+   * Set the limits beyond which a lagging NoDrop consumer is demoted to a Drop
+   * consumer. The maximum lag is a number of values rather than bytes.
+   */
+  void lag_policy (const LagPolicy &policy);
+
+  /*
+   * Return the number of NoDrop consumers evicted by the producer
+   */
+  uint64_t evicted_consumers () const;
+
+  /*
+   * Return a snapshot of the queue metrics, counting values rather than bytes
+   */
+  QueueMetrics metrics () const;
+
+  /*
+   * Return the doorbell rung by the producer when a value is published
+   */
+  detail::Doorbell &doorbell ();
+
+  /*
+   * Return the number of values available to a consumer
+   */
+  size_t read_available (detail::ConsumerState &consumer) const;
+
+  /*
+   * Push a value to the queue. Always succeeds unless there are slow consumers
+   * configured to be non-dropping.
+   */
+  bool push (const T &value);
+
+  /*
+   * Pop the next value from the queue, returns false if no value is available
+   */
+  bool pop (T &value, detail::ConsumerState &consumer);
+
+private:
+  /*
+   * Memory shared between processes
+   */
+  boost::interprocess::managed_shared_memory m_memory;
+
+  typedef typename std::conditional<
+          std::is_same<std::allocator<uint8_t>, Allocator>::value,
+          std::unique_ptr<QueueType>,
+          QueueType*>::type QueuePtr;
+  /*
+   * The shared queue
+   */
+  alignas (CACHE_LINE_SIZE)
+  QueuePtr m_queue;
+};
+
+} // namespace olive {
+
+#include "SPMCSlotQueue.inl"
+
+#endif // OLIVE_SPMC_SLOT_QUEUE_H
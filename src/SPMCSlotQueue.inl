@@ -0,0 +1,149 @@
+#include "Assert.h"
+
+#include <boost/log/trivial.hpp>
+
+namespace olive {
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  SPMCSlotQueue (size_t capacity, uint8_t maxConsumers,
+                 const PageOptions &pages)
+: m_queue (std::make_unique<QueueType> (capacity, maxConsumers, pages))
+{
+  CHECK (m_queue.get () != nullptr,
+        "In-process SPMCSlotQueue initialisation failed");
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  SPMCSlotQueue (const std::string &memoryName,
+                 const std::string &queueName,
+                 size_t capacity,
+                 uint8_t maxConsumers,
+                 const PageOptions &pages)
+{
+  namespace bi = boost::interprocess;
+  /*
+   * Create named shared memory block, or open it if it already exists
+   */
+  m_memory = bi::managed_shared_memory (bi::open_or_create,
+                  memoryName.c_str (), memory_size (capacity, maxConsumers));
+
+  detail::prepare_pages (m_memory.get_address (), m_memory.get_size (), pages);
+
+  BOOST_LOG_TRIVIAL(info) << "Find or construct shared memory object: "
+    << queueName << " in named shared memory: " << memoryName;
+
+  bool found = false;
+
+  m_queue = detail::find_or_construct_queue<QueueType> (m_memory, queueName,
+                                    capacity, maxConsumers, sizeof (T), found);
+  CHECK_SS (m_queue != nullptr,
+             "Shared memory object initialisation failed: " << queueName);
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  SPMCSlotQueue (const std::string &memoryName,
+                 const std::string &queueName,
+                 const PageOptions &pages)
+  : m_memory (boost::interprocess::open_only, memoryName.c_str ())
+{
+  detail::prepare_pages (m_memory.get_address (), m_memory.get_size (), pages);
+
+  BOOST_LOG_TRIVIAL(info) << "Find shared memory object: " << queueName
+                          << " in named shared memory: " << memoryName;
+
+  m_queue = detail::find_queue<QueueType> (m_memory, queueName, sizeof (T));
+
+  CHECK_SS (m_queue != nullptr,
+             "Shared memory object initialisation failed: " << queueName);
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+size_t SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  memory_size (size_t capacity, uint8_t maxConsumers)
+{
+  return SharedMemory::BOOK_KEEPING
+       + detail::queue_block_size<QueueType> (capacity, maxConsumers,
+                                              sizeof (T));
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+void SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  register_consumer (detail::ConsumerState &consumer)
+{
+  m_queue->register_consumer (consumer);
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+void SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  unregister_consumer (detail::ConsumerState &consumer)
+{
+  m_queue->unregister_consumer (consumer);
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+size_t SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::capacity () const
+{
+  return m_queue->capacity ();
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+void SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  consumer_lease (Nanoseconds lease)
+{
+  m_queue->back_pressure ().consumer_lease (lease);
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+void SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  lag_policy (const LagPolicy &policy)
+{
+  m_queue->back_pressure ().lag_policy (policy);
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+uint64_t SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  evicted_consumers () const
+{
+  return m_queue->back_pressure ().evictions ();
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+QueueMetrics SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::metrics () const
+{
+  QueueMetrics metrics;
+
+  m_queue->back_pressure ().metrics (metrics);
+
+  return metrics;
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+detail::Doorbell &SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::doorbell ()
+{
+  return m_queue->back_pressure ().doorbell ();
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+size_t SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  read_available (detail::ConsumerState &consumer) const
+{
+  return m_queue->read_available (consumer);
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+bool SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::push (const T &value)
+{
+  return m_queue->push (value);
+}
+
+template <class T, class Allocator, uint8_t MaxNoDropConsumers>
+bool SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::pop (
+  T &value, detail::ConsumerState &consumer)
+{
+  return m_queue->pop (value, consumer);
+}
+
+} // namespace olive {
@@ -1,4 +1,5 @@
 #ifndef OLIVE_SPMC_SOURCE_H
+#define OLIVE_SPMC_SOURCE_H
 
 #include "SPMCQueue.h"
 #include "detail/SharedMemory.h"
@@ -27,6 +28,14 @@ public:
    */
   SPMCSource (size_t capacity);
 
+  /*
+   * Create a source object for use in a single process by multiple threads,
+   * supporting up to maxConsumers NoDrop consumers. The page options are
+   * applied to the queue memory.
+   */
+  SPMCSource (size_t capacity, uint8_t maxConsumers,
+              const PageOptions &pages = PageOptions ());
+
   /*
    * Create a source object in shared memory for use by multiple processes
    */
@@ -34,6 +43,25 @@ public:
               const std::string &queueName,
               size_t             capacity);
 
+  /*
+   * Create a source object in shared memory for use by multiple processes,
+   * supporting up to maxConsumers NoDrop consumers. The page options are
+   * applied to the shared memory.
+   */
+  SPMCSource (const std::string &memoryName,
+              const std::string &queueName,
+              size_t             capacity,
+              uint8_t            maxConsumers,
+              const PageOptions &pages = PageOptions ());
+
+  /*
+   * Create a source object in shared memory already mapped by the caller,
+   * which must outlive the source
+   */
+  SPMCSource (boost::interprocess::managed_shared_memory &memory,
+              const std::string &queueName,
+              size_t             capacity);
+
   /*
    * Stop source sending data
    */
@@ -58,6 +86,39 @@ public:
   template<typename POD>
   void next (const POD &data);
 
+  /*
+   * Push a POD to the queue without a header, for example to a SPMCSlotQueue
+   * whose slots each hold one value.
+   * Blocks until successful
+   */
+  template<typename POD>
+  void push (const POD &data);
+
+  /*
+   * Serialise a batch of payloads to the queue and publish them to the
+   * consumers in a single commit. Payloads are POD types or byte vectors.
+   * Blocks until successful
+   *
+   * The batch must fit in the queue along with a header for each payload.
+   */
+  template<typename Data>
+  void next_batch (const std::vector<Data> &data);
+
+  /*
+   * Reserve space in the queue for a payload of size bytes which can be
+   * serialised directly into the queue, avoiding an intermediate copy.
+   * Blocks until successful.
+   *
+   * Returns nullptr if the source is stopped. Publish the payload by calling
+   * commit ().
+   */
+  uint8_t *reserve (size_t size);
+
+  /*
+   * Publish the payload serialised to the space returned by reserve ()
+   */
+  void commit ();
+
   /*
    * Send a header message to the queue intended to keep queue warm in the cache
    */
@@ -79,6 +140,10 @@ private:
 
   uint64_t m_sequenceNumber = 0;
 
+  size_t m_reservedSize = 0;
+
+  std::vector<Header> m_batchHeaders;
+
   alignas (CACHE_LINE_SIZE)
   const Header m_warmupHdr = {
       HEADER_VERSION,
@@ -7,6 +7,12 @@ SPMCSource<Queuetype>::SPMCSource (size_t capacity)
 : m_queue (capacity)
 { }
 
+template <class Queuetype>
+SPMCSource<Queuetype>::SPMCSource (size_t capacity, uint8_t maxConsumers,
+                                   const PageOptions &pages)
+: m_queue (capacity, maxConsumers, pages)
+{ }
+
 template <class Queuetype>
 SPMCSource<Queuetype>::SPMCSource (const std::string &memoryName,
                                    const std::string &queueName,
@@ -17,6 +23,30 @@ SPMCSource<Queuetype>::SPMCSource (const std::string &memoryName,
     << queueName << "' with capacity of " << capacity << " bytes";
 }
 
+template <class Queuetype>
+SPMCSource<Queuetype>::SPMCSource (const std::string &memoryName,
+                                   const std::string &queueName,
+                                   size_t             capacity,
+                                   uint8_t            maxConsumers,
+                                   const PageOptions &pages)
+: m_queue (memoryName, queueName, capacity, maxConsumers, pages)
+{
+  BOOST_LOG_TRIVIAL(info) << "Found or created queue named '"
+    << queueName << "' with capacity of " << capacity << " bytes and "
+    << static_cast<size_t> (maxConsumers) << " consumer slots";
+}
+
+template <class Queuetype>
+SPMCSource<Queuetype>::SPMCSource (
+  boost::interprocess::managed_shared_memory &memory,
+  const std::string                          &queueName,
+  size_t                                      capacity)
+: m_queue (memory, queueName, capacity)
+{
+  BOOST_LOG_TRIVIAL(info) << "Found or created queue named '"
+    << queueName << "' with capacity of " << capacity << " bytes";
+}
+
 template <class Queuetype>
 void SPMCSource<Queuetype>::stop ()
 {
@@ -67,6 +97,89 @@ void SPMCSource<Queuetype>::next (const POD &data)
   }
 }
 
+template <class Queuetype>
+template<typename POD>
+void SPMCSource<Queuetype>::push (const POD &data)
+{
+  while (!m_stop && !m_queue.push (data))
+  { }
+}
+
+template <class Queuetype>
+template<typename Data>
+void SPMCSource<Queuetype>::next_batch (const std::vector<Data> &data)
+{
+  /*
+   * A stopped source pushes nothing, so must not consume sequence numbers
+   */
+  if (m_stop)
+  {
+    return;
+  }
+
+  int64_t timestamp = nanoseconds_since_epoch (Clock::now ());
+
+  m_batchHeaders.resize (data.size ());
+
+  for (size_t i = 0; i < data.size (); ++i)
+  {
+    Header &header = m_batchHeaders[i];
+
+    header.size      = get_size (data[i]);
+    header.seqNum    = m_sequenceNumber + i + 1;
+    header.timestamp = timestamp;
+  }
+
+  bool pushed = false;
+
+  while (!m_stop && !(pushed = m_queue.push_batch (m_batchHeaders, data)))
+  {
+    /*
+     * Update the timestamp so that only internal latency is measured
+     */
+    timestamp = nanoseconds_since_epoch (Clock::now ());
+
+    for (auto &header : m_batchHeaders)
+    {
+      header.timestamp = timestamp;
+    }
+  }
+  /*
+   * The source may be stopped while the queue is full
+   */
+  if (pushed)
+  {
+    m_sequenceNumber += data.size ();
+  }
+}
+
+template <class Queuetype>
+uint8_t *SPMCSource<Queuetype>::reserve (size_t size)
+{
+  uint8_t *payload = nullptr;
+
+  while (!m_stop && (payload = m_queue.reserve (size)) == nullptr)
+  { }
+
+  m_reservedSize = size;
+
+  return payload;
+}
+
+template <class Queuetype>
+void SPMCSource<Queuetype>::commit ()
+{
+  Header header;
+  header.size      = m_reservedSize;
+  header.seqNum    = ++m_sequenceNumber;
+  /*
+   * Timestamp on commit so that only internal latency is measured
+   */
+  header.timestamp = nanoseconds_since_epoch (Clock::now ());
+
+  m_queue.commit (header);
+}
+
 template <class Queuetype>
 void SPMCSource<Queuetype>::next_keep_warm ()
 {
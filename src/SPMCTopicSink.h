@@ -0,0 +1,102 @@
+#ifndef OLIVE_SPMC_TOPIC_SINK_H
+#define OLIVE_SPMC_TOPIC_SINK_H
+
+#include "SPMCQueue.h"
+#include "SPMCSink.h"
+#include "WaitStrategy.h"
+#include "detail/SharedMemory.h"
+#include "detail/TopicDirectory.h"
+
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace olive {
+
+/*
+ * A data sink subscribing to a subset of the topics published to a shared
+ * memory segment by an SPMCTopicSource.
+ *
+ * The queues of the subscribed topics are polled in turn so that a busy topic
+ * does not starve the others. Only the queues of subscribed topics are read.
+ *
+ * The WaitStrategy sets how next () waits while all subscribed topics are
+ * empty, see WaitStrategy.h
+ */
+template <typename QueueType, typename WaitStrategy = BusySpinWait>
+class SPMCTopicSink
+{
+private:
+  SPMCTopicSink (const SPMCTopicSink &) = delete;
+  SPMCTopicSink & operator= (const SPMCTopicSink &) = delete;
+
+public:
+  /*
+   * Subscribe to topics in named shared memory.
+   *
+   * Throws if a topic is not in the topic directory.
+   */
+  SPMCTopicSink (const std::string              &memoryName,
+                 const std::vector<std::string> &topics,
+                 ConsumerMode mode = ConsumerMode::NoDrop);
+
+  /*
+   * Stop retrieving data from shared memory
+   */
+  void stop ();
+
+  /*
+   * Retrieve the next packet of data from any subscribed topic, blocking until
+   * a packet is available or the sink is stopped.
+   *
+   * The topic is set to the index of the packet topic in topics ().
+   */
+  template<typename Vector>
+  bool next (Header &header, Vector &data, size_t &topic);
+
+  /*
+   * Retrieve the next packet of data from any subscribed topic, non-blocking
+   */
+  template<typename Vector>
+  bool next_non_blocking (Header &header, Vector &data, size_t &topic);
+
+  /*
+   * Return the subscribed topics
+   */
+  const std::vector<std::string> &topics () const { return m_topics; }
+
+private:
+  bool m_stop = { false };
+
+  std::vector<std::string> m_topics;
+
+  /*
+   * Mapping of the segment shared by the queues of all subscribed topics
+   */
+  boost::interprocess::managed_shared_memory m_memory;
+
+  detail::TopicDirectory *m_directory = { nullptr };
+
+  std::vector<std::unique_ptr<QueueType>> m_queues;
+
+  std::vector<std::unique_ptr<SPMCSink<QueueType>>> m_sinks;
+  /*
+   * Index of the next topic to poll first
+   */
+  size_t m_next = { 0 };
+
+  WaitStrategy m_wait;
+};
+
+/*
+ * Helper types
+ */
+using SPMCTopicSinkProcess = SPMCTopicSink<SPMCQueue<SharedMemory::Allocator>>;
+
+} // namespace olive
+
+#include "SPMCTopicSink.inl"
+
+#endif // OLIVE_SPMC_TOPIC_SINK_H
@@ -0,0 +1,98 @@
+#include "Assert.h"
+#include "detail/SharedMemoryObject.h"
+
+#include <boost/log/trivial.hpp>
+
+namespace olive {
+
+template <typename QueueType, typename WaitStrategy>
+SPMCTopicSink<QueueType, WaitStrategy>::SPMCTopicSink (
+  const std::string              &memoryName,
+  const std::vector<std::string> &topics,
+  ConsumerMode                    mode)
+: m_topics (topics),
+  m_memory (boost::interprocess::open_only, memoryName.c_str ())
+{
+  CHECK (!topics.empty (), "No topics to subscribe to");
+
+  m_directory = detail::find_aligned<detail::TopicDirectory> (m_memory,
+                                                 detail::TOPIC_DIRECTORY_NAME);
+
+  CHECK_SS (m_directory != nullptr,
+            "Topic directory not found in shared memory: " << memoryName);
+
+  for (const auto &topic : topics)
+  {
+    CHECK_SS (m_directory->contains (topic), "Topic not found: " << topic);
+
+    m_queues.push_back (std::make_unique<QueueType> (
+                        m_memory, detail::topic_queue_name (topic)));
+
+    m_sinks.push_back (std::make_unique<SPMCSink<QueueType>> (
+                       *m_queues.back (), mode));
+
+    BOOST_LOG_TRIVIAL (info) << "Subscribed to topic '" << topic << "'";
+  }
+}
+
+template <typename QueueType, typename WaitStrategy>
+void SPMCTopicSink<QueueType, WaitStrategy>::stop ()
+{
+  m_stop = true;
+
+  for (auto &sink : m_sinks)
+  {
+    sink->stop ();
+  }
+}
+
+template <typename QueueType, typename WaitStrategy>
+template<typename Vector>
+bool SPMCTopicSink<QueueType, WaitStrategy>::next (Header &header,
+                                                   Vector &data,
+                                                   size_t &topic)
+{
+  while (!m_stop)
+  {
+    if (next_non_blocking (header, data, topic))
+    {
+      m_wait.reset (m_directory->doorbell ());
+      return true;
+    }
+
+    m_wait.idle (m_directory->doorbell ());
+  }
+
+  m_wait.reset (m_directory->doorbell ());
+
+  return false;
+}
+
+template <typename QueueType, typename WaitStrategy>
+template<typename Vector>
+bool SPMCTopicSink<QueueType, WaitStrategy>::next_non_blocking (Header &header,
+                                                                Vector &data,
+                                                                size_t &topic)
+{
+  size_t count = m_sinks.size ();
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    size_t index = m_next;
+
+    if (++m_next == count)
+    {
+      m_next = 0;
+    }
+
+    if (m_sinks[index]->next_non_blocking (header, data))
+    {
+      topic = index;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace olive
@@ -0,0 +1,92 @@
+#ifndef OLIVE_SPMC_TOPIC_SOURCE_H
+#define OLIVE_SPMC_TOPIC_SOURCE_H
+
+#include "SPMCQueue.h"
+#include "SPMCSource.h"
+#include "detail/SharedMemory.h"
+#include "detail/TopicDirectory.h"
+
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace olive {
+
+/*
+ * A single producer, multiple consumer data source publishing to named topics.
+ *
+ * Each topic is carried by its own SPMC queue in a single shared memory
+ * segment, so consumers subscribing to a subset of topics never read the data
+ * of other topics. The topics are listed in a directory in the segment.
+ */
+template <typename QueueType>
+class SPMCTopicSource
+{
+private:
+  SPMCTopicSource (const SPMCTopicSource &) = delete;
+  SPMCTopicSource & operator= (const SPMCTopicSource &) = delete;
+
+public:
+  /*
+   * Create named shared memory of memorySize bytes, or open it if it already
+   * exists, and find or create the topic directory
+   */
+  SPMCTopicSource (const std::string &memoryName, size_t memorySize);
+
+  /*
+   * Return the size of shared memory required for a number of topics, each
+   * with a queue capacity in bytes
+   */
+  static size_t memory_size (size_t capacity, size_t topicCount);
+
+  /*
+   * Find or create the queue for a topic and add the topic to the directory.
+   *
+   * Returns the topic index to be passed to next ().
+   */
+  size_t add_topic (const std::string &topic, size_t capacity);
+
+  /*
+   * Serialise data and send to the queue of a topic
+   * Blocks until successful
+   */
+  template<typename Data>
+  void next (size_t topic, const Data &data);
+
+  /*
+   * Stop sending data to all topics
+   */
+  void stop ();
+
+  /*
+   * Return all of the topics in the directory
+   */
+  std::vector<std::string> topics () const;
+
+private:
+  std::string m_memoryName;
+  /*
+   * Mapping of the segment shared by the queues of all topics
+   */
+  boost::interprocess::managed_shared_memory m_memory;
+
+  detail::TopicDirectory *m_directory = { nullptr };
+
+  std::vector<std::string> m_topics;
+
+  std::vector<std::unique_ptr<SPMCSource<QueueType>>> m_sources;
+};
+
+/*
+ * Helper types
+ */
+using SPMCTopicSourceProcess =
+                            SPMCTopicSource<SPMCQueue<SharedMemory::Allocator>>;
+
+} // namespace olive
+
+#include "SPMCTopicSource.inl"
+
+#endif // OLIVE_SPMC_TOPIC_SOURCE_H
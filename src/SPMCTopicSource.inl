@@ -0,0 +1,96 @@
+#include "Assert.h"
+#include "detail/SharedMemoryObject.h"
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace olive {
+
+template <typename QueueType>
+SPMCTopicSource<QueueType>::SPMCTopicSource (const std::string &memoryName,
+                                             size_t             memorySize)
+: m_memoryName (memoryName)
+{
+  namespace bi = boost::interprocess;
+
+  m_memory = bi::managed_shared_memory (bi::open_or_create,
+                                        memoryName.c_str (), memorySize);
+
+  m_directory = detail::find_or_construct_aligned<detail::TopicDirectory> (
+                                    m_memory, detail::TOPIC_DIRECTORY_NAME);
+
+  CHECK_SS (m_directory != nullptr,
+            "Topic directory initialisation failed: " << memoryName);
+}
+
+template <typename QueueType>
+size_t SPMCTopicSource<QueueType>::memory_size (size_t capacity,
+                                                size_t topicCount)
+{
+  return SharedMemory::BOOK_KEEPING
+       + detail::aligned_object_size<detail::TopicDirectory> ()
+       + QueueType::memory_size (capacity) * topicCount;
+}
+
+template <typename QueueType>
+size_t SPMCTopicSource<QueueType>::add_topic (const std::string &topic,
+                                              size_t             capacity)
+{
+  CHECK_SS (std::find (m_topics.begin (), m_topics.end (), topic)
+                                                          == m_topics.end (),
+            "Topic already added: " << topic);
+
+  CHECK_SS (!topic.empty () &&
+            topic.size () <= detail::TopicDirectory::MAX_TOPIC_NAME_SIZE,
+            "Invalid topic name: " << topic);
+
+  m_sources.push_back (std::make_unique<SPMCSource<QueueType>> (
+                    m_memory, detail::topic_queue_name (topic), capacity));
+  /*
+   * Publishing to any topic rings the directory doorbell, which consumers of
+   * several topics wait on
+   */
+  m_sources.back ()->queue ().share_doorbell (m_directory->doorbell ());
+  /*
+   * Add the topic to the directory once the queue exists so that a consumer
+   * finding the topic can open the queue
+   */
+  auto addTopic = [this, &topic] () { m_directory->add (topic); };
+
+  m_memory.atomic_func (addTopic);
+
+  m_topics.push_back (topic);
+
+  BOOST_LOG_TRIVIAL (info) << "Added topic '" << topic << "' to shared memory "
+                           << m_memoryName;
+
+  return m_topics.size () - 1;
+}
+
+template <typename QueueType>
+template<typename Data>
+void SPMCTopicSource<QueueType>::next (size_t topic, const Data &data)
+{
+  assert (topic < m_sources.size ());
+
+  m_sources[topic]->next (data);
+}
+
+template <typename QueueType>
+void SPMCTopicSource<QueueType>::stop ()
+{
+  for (auto &source : m_sources)
+  {
+    source->stop ();
+  }
+}
+
+template <typename QueueType>
+std::vector<std::string> SPMCTopicSource<QueueType>::topics () const
+{
+  return m_directory->topics ();
+}
+
+} // namespace olive
@@ -4,6 +4,8 @@
 #include "Assert.h"
 #include "Buffer.h"
 #include "Logger.h"
+#include "WaitStrategy.h"
+#include "detail/Doorbell.h"
 #include "detail/SharedMemory.h"
 
 #include <boost/interprocess/managed_shared_memory.hpp>
@@ -19,8 +21,11 @@ namespace olive {
 
 /*
  * Stream shared memory data from a single producer / single consumer queue
+ *
+ * The WaitStrategy sets how next () waits while the queue is empty, see
+ * WaitStrategy.h
  */
-template <typename Allocator>
+template <typename Allocator, typename WaitStrategy = BusySpinWait>
 class SPSCSink
 {
 private:
@@ -32,7 +37,11 @@ public:
 
   ~SPSCSink ();
   /*
-   * Retrieve the next packet of data.
+   * Retrieve the next packet of data, blocking until a packet is available or
+   * the sink is stopped.
+   *
+   * With a prefetch cache the sink does not wait, it returns false if no
+   * packet is available.
    */
   bool next (Header &header, std::vector<uint8_t> &data);
 
@@ -76,6 +85,10 @@ private:
 
   Buffer<std::allocator<uint8_t>> m_cache;
 
+  detail::Doorbell *m_doorbell = { nullptr };
+
+  WaitStrategy m_wait;
+
   alignas (CACHE_LINE_SIZE)
   std::unique_ptr<SharedMemory::Allocator> m_allocator;
 
@@ -1,8 +1,10 @@
+#include "detail/SharedMemoryObject.h"
+
 namespace olive {
 
-template <typename Allocator>
-SPSCSink<Allocator>::SPSCSink (const std::string &memoryName,
-                               size_t prefetchSize)
+template <typename Allocator, typename WaitStrategy>
+SPSCSink<Allocator, WaitStrategy>::SPSCSink (const std::string &memoryName,
+                                             size_t prefetchSize)
 {
   namespace bi = boost::interprocess;
 
@@ -39,6 +41,9 @@ SPSCSink<Allocator>::SPSCSink (const std::string &memoryName,
   CHECK_SS (m_queuePtr != nullptr,
     "Failed to create shared memory queue: " << queueName);
 
+  m_doorbell = detail::find_or_construct_aligned<detail::Doorbell> (
+                                        m_memory, queueName + ":doorbell");
+
   BOOST_LOG_TRIVIAL (info) << "SPSCSink constructed " << queueName;
 
   if (prefetchSize > 0)
@@ -54,14 +59,14 @@ SPSCSink<Allocator>::SPSCSink (const std::string &memoryName,
   ++(*readyCounter);
 }
 
-template <typename Allocator>
-SPSCSink<Allocator>::~SPSCSink ()
+template <typename Allocator, typename WaitStrategy>
+SPSCSink<Allocator, WaitStrategy>::~SPSCSink ()
 {
   stop ();
 }
 
-template <typename Allocator>
-void SPSCSink<Allocator>::stop ()
+template <typename Allocator, typename WaitStrategy>
+void SPSCSink<Allocator, WaitStrategy>::stop ()
 {
   if (!m_stop)
   {
@@ -69,8 +74,9 @@ void SPSCSink<Allocator>::stop ()
   }
 }
 
-template <typename Allocator>
-bool SPSCSink<Allocator>::next (Header &header, std::vector<uint8_t> &data)
+template <typename Allocator, typename WaitStrategy>
+bool SPSCSink<Allocator, WaitStrategy>::next (Header &header,
+                                              std::vector<uint8_t> &data)
 {
   while (!m_stop)
   {
@@ -78,6 +84,7 @@ bool SPSCSink<Allocator>::next (Header &header, std::vector<uint8_t> &data)
     {
       if (!pop<Header> (header))
       {
+        m_wait.idle (*m_doorbell);
         continue;
       }
 
@@ -90,6 +97,7 @@ bool SPSCSink<Allocator>::next (Header &header, std::vector<uint8_t> &data)
         {
           if (SPMC_EXPECT_TRUE (pop (data.data (), header.size)))
           {
+            m_wait.reset (*m_doorbell);
             return true;
           }
         }
@@ -101,18 +109,20 @@ bool SPSCSink<Allocator>::next (Header &header, std::vector<uint8_t> &data)
     }
   }
 
+  m_wait.reset (*m_doorbell);
+
   return false;
 }
 
-template <typename Allocator>
+template <typename Allocator, typename WaitStrategy>
 template <typename POD>
-bool SPSCSink<Allocator>::pop (POD &pod)
+bool SPSCSink<Allocator, WaitStrategy>::pop (POD &pod)
 {
   return pop (reinterpret_cast<uint8_t*> (&pod), sizeof (POD));
 }
 
-template <typename Allocator>
-bool SPSCSink<Allocator>::pop (uint8_t *to, size_t size)
+template <typename Allocator, typename WaitStrategy>
+bool SPSCSink<Allocator, WaitStrategy>::pop (uint8_t *to, size_t size)
 {
   auto &queue = *m_queuePtr;
 
@@ -130,9 +140,10 @@ bool SPSCSink<Allocator>::pop (uint8_t *to, size_t size)
   return popped_size;
 }
 
-template <typename Allocator>
+template <typename Allocator, typename WaitStrategy>
 template<class Header, class Data>
-bool SPSCSink<Allocator>::pop_from_cache (Header &header, Data &data)
+bool SPSCSink<Allocator, WaitStrategy>::pop_from_cache (Header &header,
+                                                        Data &data)
 {
   /*
    * Append as much available data as possible to the cache
@@ -184,8 +195,8 @@ bool SPSCSink<Allocator>::pop_from_cache (Header &header, Data &data)
   return false;
 }
 
-template <typename Allocator>
-bool SPSCSink<Allocator>::prefetch_to_cache ()
+template <typename Allocator, typename WaitStrategy>
+bool SPSCSink<Allocator, WaitStrategy>::prefetch_to_cache ()
 {
   auto &queue = *m_queuePtr;
 
@@ -3,6 +3,7 @@
 
 #include "Assert.h"
 #include "Chrono.h"
+#include "detail/Doorbell.h"
 #include "detail/SharedMemory.h"
 
 #include <boost/interprocess/managed_shared_memory.hpp>
@@ -75,6 +76,10 @@ private:
 
   SharedMemory::SPSCQueue *m_queue = { nullptr };
   SharedMemory::SPSCQueue &m_queueRef;
+  /*
+   * Doorbell shared with the sink, rung when data is pushed
+   */
+  detail::Doorbell *m_doorbell = { nullptr };
 };
 
 /*
@@ -1,3 +1,5 @@
+#include "detail/SharedMemoryObject.h"
+
 namespace olive {
 
 namespace bi = boost::interprocess;
@@ -24,6 +26,9 @@ SPSCSource<Allocator>::SPSCSource (const std::string &memoryName,
   CHECK_SS (m_queue != nullptr,
             "shared memory object initialisation failed: " << objectName);
 
+  m_doorbell = detail::find_or_construct_aligned<detail::Doorbell> (
+                                        m_memory, objectName + ":doorbell");
+
   BOOST_LOG_TRIVIAL (info) << "Found or created queue named '"
     << m_name << "' with capacity of " << capacity << " bytes";
 }
@@ -69,6 +74,8 @@ void SPSCSource<Allocator>::next (const std::vector<uint8_t> &data)
                 data.data (), data.size ());
 
   m_queueRef.push (m_buffer.data (), m_buffer.size ());
+
+  m_doorbell->ring ();
 }
 
 template <typename Allocator>
@@ -0,0 +1,101 @@
+#ifndef OLIVE_WAIT_STRATEGY_H
+#define OLIVE_WAIT_STRATEGY_H
+
+#include "Chrono.h"
+#include "detail/Doorbell.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace olive {
+
+/*
+ * Wait strategies used by a sink while the queue it consumes from is empty.
+ *
+ * The sink calls idle () after each unsuccessful poll of the queue and reset ()
+ * after a successful poll or before returning without data.
+ *
+ * The strategies trade wake up latency against CPU use:
+ *
+ *   BusySpinWait   lowest latency, uses a whole core
+ *   PauseSpinWait  spins using the pause instruction, saving power and freeing
+ *                  resources for a hyper-thread sibling
+ *   SpinYieldWait  spins then yields the core to other threads
+ *   BlockingWait   spins then sleeps on the queue doorbell until the producer
+ *                  publishes data
+ */
+
+/*
+ * Poll the queue continuously
+ */
+class BusySpinWait
+{
+public:
+  void idle (detail::Doorbell &) { }
+
+  void reset (detail::Doorbell &) { }
+};
+
+/*
+ * Poll the queue continuously, pausing between polls
+ */
+class PauseSpinWait
+{
+public:
+  void idle (detail::Doorbell &);
+
+  void reset (detail::Doorbell &) { }
+};
+
+/*
+ * Poll the queue a number of times, then yield between polls
+ */
+class SpinYieldWait
+{
+public:
+  static constexpr size_t SPINS = 100;
+
+  void idle (detail::Doorbell &);
+
+  void reset (detail::Doorbell &);
+
+private:
+  size_t m_spins = { 0 };
+};
+
+/*
+ * Poll the queue a number of times, then sleep until the producer rings the
+ * queue doorbell.
+ *
+ * The sleep times out so that a stopped sink is noticed. The first sleep after
+ * arming the doorbell is shorter, see Doorbell. A sink which found every
+ * doorbell entry held backs off from the recheck timeout to TIMEOUT.
+ */
+class BlockingWait
+{
+public:
+  static constexpr size_t SPINS = 100;
+
+  static constexpr Nanoseconds TIMEOUT = Milliseconds (10);
+
+  void idle (detail::Doorbell &doorbell);
+
+  void reset (detail::Doorbell &doorbell);
+
+private:
+  size_t      m_spins    = { 0 };
+
+  bool        m_armed    = { false };
+
+  int32_t     m_lease    = { -1 };
+
+  uint32_t    m_sequence = { 0 };
+
+  Nanoseconds m_timeout  = { TIMEOUT };
+};
+
+} // namespace olive
+
+#include "WaitStrategy.inl"
+
+#endif // OLIVE_WAIT_STRATEGY_H
@@ -0,0 +1,77 @@
+#include "detail/Utils.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace olive {
+
+inline
+void PauseSpinWait::idle (detail::Doorbell &)
+{
+  SPMC_CPU_PAUSE ();
+}
+
+inline
+void SpinYieldWait::idle (detail::Doorbell &)
+{
+  if (m_spins < SPINS)
+  {
+    ++m_spins;
+
+    SPMC_CPU_PAUSE ();
+  }
+  else
+  {
+    std::this_thread::yield ();
+  }
+}
+
+inline
+void SpinYieldWait::reset (detail::Doorbell &)
+{
+  m_spins = 0;
+}
+
+inline
+void BlockingWait::idle (detail::Doorbell &doorbell)
+{
+  if (m_spins < SPINS)
+  {
+    ++m_spins;
+
+    SPMC_CPU_PAUSE ();
+  }
+  else if (!m_armed)
+  {
+    /*
+     * Return so that the sink polls the queue once more after arming, data
+     * published before the doorbell was armed is not rung for
+     */
+    m_sequence = doorbell.arm (m_lease);
+    m_armed    = true;
+    m_timeout  = detail::Doorbell::RECHECK_TIMEOUT;
+  }
+  else
+  {
+    doorbell.wait (m_sequence, m_timeout);
+    /*
+     * Stay armed, so only the first wait is limited to the recheck timeout
+     */
+    m_sequence = doorbell.sequence ();
+    m_timeout  = m_lease < 0 ? std::min (m_timeout * 2, TIMEOUT) : TIMEOUT;
+  }
+}
+
+inline
+void BlockingWait::reset (detail::Doorbell &doorbell)
+{
+  if (m_armed)
+  {
+    doorbell.disarm (m_lease);
+    m_armed = false;
+  }
+
+  m_spins = 0;
+}
+
+} // namespace olive
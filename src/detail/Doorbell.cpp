@@ -0,0 +1,130 @@
+#include "detail/Doorbell.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <ctime>
+
+namespace olive {
+namespace detail {
+
+namespace {
+
+static_assert (sizeof (std::atomic<uint32_t>) == sizeof (uint32_t),
+               "The futex word must be a 32 bit integer");
+
+long futex (std::atomic<uint32_t> *word, int op, uint32_t value,
+            const timespec *timeout)
+{
+  return syscall (SYS_futex, reinterpret_cast<uint32_t*> (word), op, value,
+                  timeout, nullptr, 0);
+}
+
+} // namespace {
+
+Doorbell::Doorbell ()
+{
+  for (auto &pid : m_waiterPids)
+  {
+    pid.store (0, std::memory_order_relaxed);
+  }
+}
+
+uint32_t Doorbell::arm (int32_t &lease)
+{
+  int32_t self = ::getpid ();
+
+  lease = -1;
+
+  for (size_t i = 0; i < MAX_WAITERS && lease < 0; ++i)
+  {
+    int32_t expected = 0;
+
+    if (m_waiterPids[i].load (std::memory_order_relaxed) == 0 &&
+        m_waiterPids[i].compare_exchange_strong (expected, self,
+                                                 std::memory_order_relaxed))
+    {
+      lease = static_cast<int32_t> (i);
+    }
+  }
+
+  if (lease >= 0)
+  {
+    m_waiters.fetch_add (1, std::memory_order_seq_cst);
+  }
+
+  return m_sequence.load (std::memory_order_seq_cst);
+}
+
+void Doorbell::disarm (int32_t lease)
+{
+  if (lease < 0)
+  {
+    return;
+  }
+
+  int32_t self = ::getpid ();
+  /*
+   * The entry may have been reclaimed if this process was mistaken for one
+   * which had exited, in which case the count was already decremented
+   */
+  if (m_waiterPids[lease].compare_exchange_strong (self, 0,
+                                                   std::memory_order_relaxed))
+  {
+    m_waiters.fetch_sub (1, std::memory_order_relaxed);
+  }
+}
+
+void Doorbell::reclaim ()
+{
+  for (auto &entry : m_waiterPids)
+  {
+    int32_t pid = entry.load (std::memory_order_relaxed);
+
+    if (pid > 0 && ::kill (pid, 0) != 0 && errno == ESRCH &&
+        entry.compare_exchange_strong (pid, 0, std::memory_order_relaxed))
+    {
+      m_waiters.fetch_sub (1, std::memory_order_relaxed);
+    }
+  }
+}
+
+void Doorbell::wait (uint32_t sequence, Nanoseconds timeout)
+{
+  auto seconds = std::chrono::duration_cast<Seconds> (timeout);
+
+  timespec time;
+  time.tv_sec  = seconds.count ();
+  time.tv_nsec = (timeout - seconds).count ();
+  /*
+   * Returns immediately if the producer has rung since the sequence was read.
+   * Spurious wake ups are handled by the caller checking the queue again.
+   */
+  futex (&m_sequence, FUTEX_WAIT, sequence, &time);
+}
+
+void Doorbell::wake ()
+{
+  m_sequence.fetch_add (1, std::memory_order_release);
+
+  futex (&m_sequence, FUTEX_WAKE, INT_MAX, nullptr);
+  /*
+   * A waiter which exited while armed would otherwise cost a system call on
+   * every ring
+   */
+  int64_t now = nanoseconds_since_epoch (Clock::now ());
+
+  if (now >= m_nextReclaim.load (std::memory_order_relaxed))
+  {
+    m_nextReclaim.store (now + RECLAIM_INTERVAL.count (),
+                         std::memory_order_relaxed);
+    reclaim ();
+  }
+}
+
+} // namespace detail {
+} // namespace olive {
@@ -0,0 +1,134 @@
+#ifndef OLIVE_DETAIL_DOORBELL_H
+#define OLIVE_DETAIL_DOORBELL_H
+
+#include "Chrono.h"
+#include "detail/SharedMemory.h"
+#include "detail/Utils.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace olive {
+namespace detail {
+
+/*
+ * A doorbell used by the producer to wake consumers sleeping on an empty queue.
+ *
+ * The doorbell is placed in the shared queue state and uses a process shared
+ * futex so that it works between threads and between processes.
+ *
+ * A consumer arms the doorbell, checks the queue once more, then waits on the
+ * sequence returned when arming. The producer only reads the doorbell, and
+ * makes a system call if a consumer is armed.
+ *
+ * The producer does not fence between publishing data and reading the waiter
+ * count, so it may miss a consumer arming concurrently with a publication. The
+ * consumer pays for this instead: its first wait after arming is limited to
+ * RECHECK_TIMEOUT, after which the publication is visible to it.
+ *
+ * Each armed consumer holds one of MAX_WAITERS entries recording its process
+ * id, so the entries of a consumer process which exits while armed are
+ * reclaimed and the producer stops waking it.
+ */
+class Doorbell
+{
+public:
+  static constexpr size_t MAX_WAITERS = 64;
+  /*
+   * Limit on the first wait after arming, covering a publication which did not
+   * see the waiter
+   */
+  static constexpr Nanoseconds RECHECK_TIMEOUT = Microseconds (50);
+  /*
+   * Minimum interval between checks made by the producer for waiters which
+   * have exited
+   */
+  static constexpr Nanoseconds RECLAIM_INTERVAL = Milliseconds (100);
+
+  Doorbell ();
+  /*
+   * Wake any consumers waiting on the doorbell.
+   *
+   * Call after publishing data to the queue.
+   */
+  void ring ();
+  /*
+   * Register as a waiter, setting lease to the waiter entry held, and return
+   * the doorbell sequence number to be passed to wait ().
+   *
+   * Check the queue for data after arming to avoid missing a ring. If every
+   * entry is held the lease is -1 and the waiter relies on its wait timing out.
+   */
+  uint32_t arm (int32_t &lease);
+  /*
+   * Unregister as a waiter, releasing the entry held
+   */
+  void disarm (int32_t lease);
+  /*
+   * Return the doorbell sequence number, to wait again without re-arming
+   */
+  uint32_t sequence () const;
+  /*
+   * Sleep until the doorbell is rung after the sequence number was returned
+   * by arm () or the timeout expires
+   */
+  void wait (uint32_t sequence, Nanoseconds timeout);
+  /*
+   * Release the entries of waiters whose process has exited
+   */
+  void reclaim ();
+  /*
+   * Return the number of armed consumers
+   */
+  uint32_t waiters () const;
+
+private:
+  void wake ();
+
+private:
+  /*
+   * Number of armed consumers, read by the producer on each ring
+   */
+  alignas (CACHE_LINE_SIZE)
+  std::atomic<uint32_t> m_waiters = { 0 };
+  /*
+   * Futex word incremented by the producer when waking consumers
+   */
+  std::atomic<uint32_t> m_sequence = { 0 };
+  /*
+   * Time after which the producer next checks for waiters which have exited
+   */
+  std::atomic<int64_t> m_nextReclaim = { 0 };
+  /*
+   * Process ids of the armed consumers, zero for a free entry
+   */
+  alignas (CACHE_LINE_SIZE)
+  std::array<std::atomic<int32_t>, MAX_WAITERS> m_waiterPids;
+};
+
+inline
+void Doorbell::ring ()
+{
+  if (SPMC_EXPECT_FALSE (m_waiters.load (std::memory_order_relaxed) > 0))
+  {
+    wake ();
+  }
+}
+
+inline
+uint32_t Doorbell::sequence () const
+{
+  return m_sequence.load (std::memory_order_acquire);
+}
+
+inline
+uint32_t Doorbell::waiters () const
+{
+  return m_waiters.load (std::memory_order_relaxed);
+}
+
+} // namespace detail {
+} // namespace olive {
+
+#endif // OLIVE_DETAIL_DOORBELL_H
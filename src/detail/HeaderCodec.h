@@ -0,0 +1,74 @@
+#ifndef OLIVE_DETAIL_HEADER_CODEC_H
+#define OLIVE_DETAIL_HEADER_CODEC_H
+
+#include "detail/SharedMemory.h"
+#include "detail/SPMCBackPressure.h"
+
+namespace olive {
+namespace detail {
+
+/*
+ * Convert a Header to and from the header format stored in a queue.
+ *
+ * encode () returns the header to push to the queue. decode () restores a
+ * Header from a header popped by a consumer, using the timestamp base of the
+ * queue.
+ */
+template <typename WireHeader>
+struct HeaderCodec;
+
+/*
+ * The standard header is stored in the queue unchanged
+ */
+template <>
+struct HeaderCodec<Header>
+{
+  static const Header &encode (const Header &header);
+
+  static void decode (const Header &wire, Header &header,
+                      int64_t timestampBase, ConsumerState &consumer);
+  /*
+   * Return true if the timestamp base must be moved to a timestamp pushed
+   */
+  static bool rebase (int64_t, int64_t) { return false; }
+};
+
+/*
+ * The compact header holds a 32 bit size and sequence number and the low 48
+ * bits of the timestamp.
+ *
+ * Message sizes must be less than 4GB. Timestamps are restored to the nearest
+ * value to the queue timestamp base, so a message must be popped while its
+ * timestamp is within about 39 hours of the base. The producer moves the base
+ * to any timestamp it pushes more than about 19 hours from the base, so the
+ * timestamps of a long running producer never overflow. Sequence numbers are
+ * restored relative to the last sequence number decoded by the consumer.
+ */
+template <>
+struct HeaderCodec<CompactHeader>
+{
+  static constexpr uint64_t TIMESTAMP_MASK = (uint64_t (1) << 48) - 1;
+  /*
+   * The stored timestamp of a Header with the default timestamp. A timestamp
+   * with the same low 48 bits is stored one nanosecond later.
+   */
+  static constexpr uint64_t UNSET_TIMESTAMP = uint64_t (1) << 47;
+  /*
+   * Distance from the timestamp base at which the producer moves the base
+   */
+  static constexpr uint64_t REBASE_DISTANCE = uint64_t (1) << 46;
+
+  static CompactHeader encode (const Header &header);
+
+  static void decode (const CompactHeader &wire, Header &header,
+                      int64_t timestampBase, ConsumerState &consumer);
+
+  static bool rebase (int64_t timestamp, int64_t timestampBase);
+};
+
+} // namespace detail {
+} // namespace olive {
+
+#include "detail/HeaderCodec.inl"
+
+#endif // OLIVE_DETAIL_HEADER_CODEC_H
@@ -0,0 +1,91 @@
+#include <cassert>
+
+namespace olive {
+namespace detail {
+
+inline
+const Header &HeaderCodec<Header>::encode (const Header &header)
+{
+  return header;
+}
+
+inline
+void HeaderCodec<Header>::decode (const Header &wire, Header &header,
+                                  int64_t, ConsumerState &)
+{
+  header = wire;
+}
+
+inline
+CompactHeader HeaderCodec<CompactHeader>::encode (const Header &header)
+{
+  assert (header.size <= std::numeric_limits<uint32_t>::max ());
+
+  uint64_t timestamp = UNSET_TIMESTAMP;
+
+  if (header.timestamp != DEFAULT_TIMESTAMP)
+  {
+    timestamp = static_cast<uint64_t> (header.timestamp) & TIMESTAMP_MASK;
+
+    if (SPMC_EXPECT_FALSE (timestamp == UNSET_TIMESTAMP))
+    {
+      ++timestamp;
+    }
+  }
+
+  CompactHeader wire;
+  wire.type          = header.type;
+  wire.timestampHigh = static_cast<uint16_t> (timestamp >> 32);
+  wire.size          = static_cast<uint32_t> (header.size);
+  wire.seqNum        = static_cast<uint32_t> (header.seqNum);
+  wire.timestampLow  = static_cast<uint32_t> (timestamp);
+
+  return wire;
+}
+
+inline
+void HeaderCodec<CompactHeader>::decode (const CompactHeader &wire,
+                                         Header &header,
+                                         int64_t timestampBase,
+                                         ConsumerState &consumer)
+{
+  assert (wire.version == COMPACT_HEADER_VERSION);
+  uint64_t timestamp = (static_cast<uint64_t> (wire.timestampHigh) << 32) |
+                       wire.timestampLow;
+
+  header.version   = wire.version;
+  header.type      = wire.type;
+  header.size      = wire.size;
+  header.seqNum    = consumer.extend_sequence_number (wire.seqNum);
+  header.timestamp = DEFAULT_TIMESTAMP;
+
+  if (timestamp != UNSET_TIMESTAMP)
+  {
+    /*
+     * Sign extend the 48 bit distance of the timestamp from the base
+     */
+    int64_t offset = static_cast<int64_t> (
+          (timestamp - static_cast<uint64_t> (timestampBase)) << 16) >> 16;
+
+    header.timestamp = timestampBase + offset;
+  }
+}
+
+inline
+bool HeaderCodec<CompactHeader>::rebase (int64_t timestamp,
+                                         int64_t timestampBase)
+{
+  if (timestamp == DEFAULT_TIMESTAMP)
+  {
+    return false;
+  }
+
+  uint64_t to   = static_cast<uint64_t> (timestamp);
+  uint64_t from = static_cast<uint64_t> (timestampBase);
+
+  return (((timestamp > timestampBase) ? to - from : from - to)
+            >= REBASE_DISTANCE);
+}
+
+} // namespace detail {
+} // namespace olive {
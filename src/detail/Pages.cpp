@@ -0,0 +1,130 @@
+#include "detail/Pages.h"
+
+#include <boost/log/trivial.hpp>
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * Defined by glibc 2.35 and later, supported by Linux 5.14 and later
+ */
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+namespace olive {
+namespace detail {
+
+namespace {
+
+/*
+ * Fault in every page of a page aligned memory range for writing without
+ * modifying it.
+ *
+ * Reading private anonymous memory, as allocated for an in-process queue, only
+ * maps the shared zero page, so the pages are faulted in by writes to avoid a
+ * copy on write fault when the producer first writes to each page.
+ */
+void prefault_pages (uint8_t *begin, size_t size, size_t pageSize)
+{
+  if (madvise (begin, size, MADV_POPULATE_WRITE) == 0)
+  {
+    return;
+  }
+  /*
+   * Fallback for kernels older than 5.14. Adding zero atomically writes to the
+   * page without losing a concurrent write by a process sharing the memory.
+   */
+  for (size_t offset = 0; offset < size; offset += pageSize)
+  {
+    __atomic_fetch_add (begin + offset, 0, __ATOMIC_RELAXED);
+  }
+}
+
+/*
+ * Bind a page aligned memory range to a NUMA node, moving any pages already
+ * faulted in
+ */
+void bind_to_node (uint8_t *begin, size_t size, int node)
+{
+  const size_t bits = sizeof (unsigned long) * 8;
+
+  std::vector<unsigned long> mask (node / bits + 1, 0);
+
+  mask[node / bits] = 1UL << (node % bits);
+
+  if (syscall (SYS_mbind, begin, size, MPOL_BIND, mask.data (),
+               mask.size () * bits + 1, MPOL_MF_MOVE) != 0)
+  {
+    BOOST_LOG_TRIVIAL (warning) << "Failed to bind memory to NUMA node "
+                                << node << ": " << std::strerror (errno);
+  }
+}
+
+} // namespace {
+
+void prepare_pages (void *address, size_t size, const PageOptions &options)
+{
+  if (size == 0 ||
+      (!options.hugePages && !options.lockPages && options.numaNode < 0))
+  {
+    return;
+  }
+  /*
+   * Align the start of the range down to a page boundary as required by
+   * madvise () and mlock ()
+   */
+  const size_t pageSize = static_cast<size_t> (sysconf (_SC_PAGESIZE));
+
+  auto start = reinterpret_cast<uintptr_t> (address);
+  auto begin = start & ~(pageSize - 1);
+
+  size_t length = size + (start - begin);
+
+  auto *pages = reinterpret_cast<uint8_t*> (begin);
+
+  if (options.hugePages)
+  {
+    if (madvise (pages, length, MADV_HUGEPAGE) != 0)
+    {
+      BOOST_LOG_TRIVIAL (warning) << "Failed to enable huge pages: "
+                                  << std::strerror (errno);
+    }
+  }
+
+  if (options.numaNode >= 0)
+  {
+    bind_to_node (pages, length, options.numaNode);
+  }
+
+  if (options.lockPages)
+  {
+    /*
+     * Locking memory faults in each page of the range
+     */
+    if (mlock (pages, length) != 0)
+    {
+      BOOST_LOG_TRIVIAL (warning) << "Failed to lock " << length
+        << " bytes of memory: " << std::strerror (errno);
+
+      prefault_pages (pages, length, pageSize);
+    }
+  }
+
+  BOOST_LOG_TRIVIAL (info) << "Prepared " << length << " bytes of memory"
+    << (options.hugePages ? " with huge pages" : "")
+    << (options.lockPages ? " locked in RAM" : "")
+    << (options.numaNode >= 0 ? " on NUMA node " +
+                                std::to_string (options.numaNode) : "");
+}
+
+} // namespace detail {
+} // namespace olive {
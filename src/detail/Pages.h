@@ -0,0 +1,43 @@
+#ifndef OLIVE_DETAIL_PAGES_H
+#define OLIVE_DETAIL_PAGES_H
+
+#include <cstddef>
+
+namespace olive {
+
+/*
+ * Options for the memory pages backing a queue
+ */
+struct PageOptions
+{
+  /*
+   * Back the memory with transparent huge pages to reduce TLB misses
+   */
+  bool hugePages = false;
+  /*
+   * Lock the memory in RAM and fault in every page up front so that no page
+   * faults occur while streaming
+   */
+  bool lockPages = false;
+  /*
+   * Bind the memory to a NUMA node, or -1 to use the default placement of the
+   * kernel on first touch
+   */
+  int numaNode = -1;
+};
+
+namespace detail {
+
+/*
+ * Apply page options to a memory range.
+ *
+ * Huge pages and locked memory depend on the system configuration, such as
+ * /sys/kernel/mm/transparent_hugepage and RLIMIT_MEMLOCK. Failures are logged
+ * as warnings and if locking fails the pages are still faulted in.
+ */
+void prepare_pages (void *address, size_t size, const PageOptions &options);
+
+} // namespace detail {
+} // namespace olive {
+
+#endif // OLIVE_DETAIL_PAGES_H
@@ -0,0 +1,150 @@
+#ifndef OLIVE_DETAIL_QUEUE_LAYOUT_H
+#define OLIVE_DETAIL_QUEUE_LAYOUT_H
+
+#include "detail/SharedMemory.h"
+
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#include <string>
+
+namespace olive {
+namespace detail {
+
+/*
+ * Identifies a shared memory block holding a queue
+ */
+static constexpr uint64_t QUEUE_LAYOUT_MAGIC = 0x4f4c495645515545;
+
+/*
+ * Incremented whenever the layout of a queue in shared memory changes, so that
+ * a process built with a different layout fails to open the queue rather than
+ * reading it incorrectly
+ */
+static constexpr uint16_t QUEUE_LAYOUT_VERSION = 6;
+
+/*
+ * State of the queue in a block. The header is written in the constructing
+ * state before the queue is constructed and marked constructed afterwards, so
+ * a block left by a producer which stopped while constructing the queue is
+ * recognised and initialised again by the next producer.
+ */
+static constexpr uint8_t QUEUE_CONSTRUCTING = 1;
+
+static constexpr uint8_t QUEUE_CONSTRUCTED  = 2;
+
+/*
+ * Header at the start of the shared memory block holding a queue.
+ *
+ * The queue object, which holds the producer cursors, consumer registration
+ * and metrics, is followed by the consumer slots and the data buffer, each at
+ * a fixed offset from the header. The whole queue is one allocation in the
+ * shared memory segment, found with a single lookup when it is opened.
+ *
+ * The queue object still references its slots, buffer and doorbell through
+ * offset pointers, as queues in heap memory allocate them separately, and
+ * each process caches local pointers to the buffer. The stored offsets are
+ * used to validate the layout rather than to locate the parts of the queue.
+ *
+ * A process opening the queue recomputes the layout from the stored capacity
+ * and consumer count and checks it matches, so producers and consumers built
+ * with different layouts are detected when the queue is opened.
+ *
+ * The block is still allocated and found by name in a managed shared memory
+ * segment, so the book-keeping of the segment remains in front of it.
+ */
+struct alignas (CACHE_LINE_SIZE) QueueLayout
+{
+  uint64_t magic        = { 0 };
+
+  uint16_t version      = { 0 };
+
+  uint8_t  maxConsumers = { 0 };
+
+  uint8_t  state        = { 0 };
+  /*
+   * Size of the message headers, or values, stored in the queue
+   */
+  uint32_t elementSize  = { 0 };
+
+  uint64_t capacity     = { 0 };
+  /*
+   * Size of the queue object
+   */
+  uint64_t queueSize    = { 0 };
+  /*
+   * Offsets from the start of the header
+   */
+  uint64_t queueOffset  = { 0 };
+
+  uint64_t slotOffset   = { 0 };
+
+  uint64_t dataOffset   = { 0 };
+  /*
+   * Size of the block from the header to the end of the data buffer
+   */
+  uint64_t size         = { 0 };
+};
+
+static_assert (sizeof (QueueLayout) == CACHE_LINE_SIZE,
+               "QueueLayout must occupy a single cache line");
+
+/*
+ * Return the layout of a queue of type QueueType with a capacity, a maximum
+ * number of NoDrop consumers and elements of elementSize bytes
+ */
+template <class QueueType>
+QueueLayout queue_layout (size_t capacity, uint8_t maxConsumers,
+                          size_t elementSize);
+
+/*
+ * Return the size of shared memory required by a queue block, excluding the
+ * book-keeping of the shared memory segment
+ */
+template <class QueueType>
+size_t queue_block_size (size_t capacity, uint8_t maxConsumers,
+                         size_t elementSize);
+
+/*
+ * Find a queue block, or construct the queue in a new block if not present.
+ *
+ * Sets found to true if the queue already existed. Finding and constructing is
+ * atomic with respect to other processes. A block whose construction was not
+ * completed is discarded and the queue constructed again.
+ */
+template <class QueueType>
+QueueType *find_or_construct_queue (
+  boost::interprocess::managed_shared_memory &memory,
+  const std::string &name,
+  size_t             capacity,
+  uint8_t            maxConsumers,
+  size_t             elementSize,
+  bool              &found);
+
+/*
+ * Find a queue constructed using find_or_construct_queue () and validate its
+ * layout.
+ *
+ * Returns nullptr if the queue is not present, throws if the layout differs
+ * or the queue has not been constructed.
+ */
+template <class QueueType>
+QueueType *find_queue (boost::interprocess::managed_shared_memory &memory,
+                       const std::string &name,
+                       size_t             elementSize);
+
+/*
+ * Find a queue in memory opened read-only, without taking the lock of the
+ * memory segment
+ */
+template <class QueueType>
+QueueType *find_queue_read_only (
+  boost::interprocess::managed_shared_memory &memory,
+  const std::string &name,
+  size_t             elementSize);
+
+} // namespace detail {
+} // namespace olive {
+
+#include "detail/QueueLayout.inl"
+
+#endif // OLIVE_DETAIL_QUEUE_LAYOUT_H
@@ -0,0 +1,241 @@
+#include "Assert.h"
+#include "detail/SharedMemoryObject.h"
+
+#include <boost/log/trivial.hpp>
+
+#include <atomic>
+#include <new>
+
+namespace olive {
+namespace detail {
+
+namespace {
+
+/*
+ * Round an offset up to a multiple of alignment, a power of two
+ */
+constexpr size_t align_offset (size_t offset, size_t alignment)
+{
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+/*
+ * Return true if a block found in shared memory was left by a producer which
+ * stopped before completing the construction of the queue. The block is zero
+ * filled before the header is written, and a header written by a build with a
+ * different layout is left for open_queue () to reject.
+ */
+inline bool queue_incomplete (uint8_t *bytes, size_t size)
+{
+  if (size < sizeof (QueueLayout) + alignof (QueueLayout))
+  {
+    return false;
+  }
+
+  QueueLayout *layout = align_object<QueueLayout> (bytes, size);
+
+  if (layout->magic == 0)
+  {
+    return true;
+  }
+
+  return layout->magic   == QUEUE_LAYOUT_MAGIC   &&
+         layout->version == QUEUE_LAYOUT_VERSION &&
+         layout->state   != QUEUE_CONSTRUCTED;
+}
+
+/*
+ * Return the queue in a block found in shared memory, validating the layout of
+ * the block against the layout expected by this build
+ */
+template <class QueueType>
+QueueType *open_queue (uint8_t *bytes, size_t size, const std::string &name,
+                       size_t elementSize)
+{
+  CHECK_SS (size >= sizeof (QueueLayout) + alignof (QueueLayout),
+            "Shared memory object is not a queue: " << name);
+
+  QueueLayout *layout = align_object<QueueLayout> (bytes, size);
+
+  CHECK_SS (layout->magic == QUEUE_LAYOUT_MAGIC,
+            "Shared memory object is not a queue: " << name);
+
+  CHECK_SS (layout->version == QUEUE_LAYOUT_VERSION,
+            "Queue " << name << " has layout version " << layout->version
+              << ", expected version " << QUEUE_LAYOUT_VERSION);
+
+  CHECK_SS (layout->state == QUEUE_CONSTRUCTED,
+            "Queue " << name << " has not been constructed");
+  /*
+   * Pairs with the release fence before the queue is marked constructed
+   */
+  std::atomic_thread_fence (std::memory_order_acquire);
+
+  CHECK_SS (layout->elementSize == elementSize,
+            "Queue " << name << " stores elements of " << layout->elementSize
+              << " bytes, expected " << elementSize << " bytes");
+
+  QueueLayout expected = queue_layout<QueueType> (layout->capacity,
+                                                  layout->maxConsumers,
+                                                  elementSize);
+
+  CHECK_SS (layout->queueSize   == expected.queueSize   &&
+            layout->queueOffset == expected.queueOffset &&
+            layout->slotOffset  == expected.slotOffset  &&
+            layout->dataOffset  == expected.dataOffset  &&
+            layout->size        == expected.size        &&
+            layout->size + alignof (QueueLayout) <= size,
+            "Queue " << name << " was created with a different queue layout");
+
+  return reinterpret_cast<QueueType*> (reinterpret_cast<uint8_t*> (layout)
+                                         + layout->queueOffset);
+}
+
+} // namespace {
+
+template <class QueueType>
+QueueLayout queue_layout (size_t capacity, uint8_t maxConsumers,
+                          size_t elementSize)
+{
+  QueueLayout layout;
+
+  layout.magic        = QUEUE_LAYOUT_MAGIC;
+  layout.version      = QUEUE_LAYOUT_VERSION;
+  layout.elementSize  = elementSize;
+  layout.capacity     = capacity;
+  layout.maxConsumers = maxConsumers;
+  layout.state        = QUEUE_CONSTRUCTING;
+  layout.queueSize    = sizeof (QueueType);
+
+  layout.queueOffset  = align_offset (sizeof (QueueLayout),
+                                      alignof (QueueType));
+
+  layout.slotOffset   = align_offset (layout.queueOffset + sizeof (QueueType),
+                                      CACHE_LINE_SIZE);
+  /*
+   * The slots are placed on a cache line boundary, so the allowance for
+   * aligning them included in the slot memory size is not needed
+   */
+  layout.dataOffset   = layout.slotOffset
+                      + QueueType::BackPressureType::slot_memory_size (
+                                                                maxConsumers)
+                      - CACHE_LINE_SIZE;
+
+  layout.size         = layout.dataOffset + QueueType::buffer_size (capacity);
+
+  return layout;
+}
+
+template <class QueueType>
+size_t queue_block_size (size_t capacity, uint8_t maxConsumers,
+                         size_t elementSize)
+{
+  /*
+   * Named blocks are only aligned to the memory algorithm alignment, so allow
+   * for placing the header on a cache line boundary
+   */
+  return queue_layout<QueueType> (capacity, maxConsumers, elementSize).size
+       + alignof (QueueLayout);
+}
+
+template <class QueueType>
+QueueType *find_or_construct_queue (
+  boost::interprocess::managed_shared_memory &memory,
+  const std::string &name,
+  size_t             capacity,
+  uint8_t            maxConsumers,
+  size_t             elementSize,
+  bool              &found)
+{
+  QueueType *queue = nullptr;
+
+  found = false;
+
+  auto findOrConstruct = [&] () {
+
+    auto block = memory.find<uint8_t> (name.c_str ());
+
+    if (block.first != nullptr)
+    {
+      if (!queue_incomplete (block.first, block.second))
+      {
+        queue = open_queue<QueueType> (block.first, block.second, name,
+                                       elementSize);
+        found = true;
+
+        return;
+      }
+
+      BOOST_LOG_TRIVIAL(warning) << "Constructing queue " << name
+        << " again, the producer constructing it stopped before completing";
+
+      memory.destroy<uint8_t> (name.c_str ());
+    }
+
+    QueueLayout layout = queue_layout<QueueType> (capacity, maxConsumers,
+                                                  elementSize);
+
+    size_t size = queue_block_size<QueueType> (capacity, maxConsumers,
+                                               elementSize);
+
+    uint8_t *bytes = memory.construct<uint8_t> (name.c_str ())[size] (0);
+
+    uint8_t *base = reinterpret_cast<uint8_t*> (
+                                    align_object<QueueLayout> (bytes, size));
+
+    QueueLayout *header = new (base) QueueLayout (layout);
+
+    SharedMemory::Allocator allocator (memory.get_segment_manager ());
+
+    queue = new (base + layout.queueOffset) QueueType (capacity, allocator,
+                                      maxConsumers, base + layout.slotOffset,
+                                      base + layout.dataOffset);
+    /*
+     * Publish the constructed queue to consumers opening the block without
+     * the lock of the segment
+     */
+    std::atomic_thread_fence (std::memory_order_release);
+
+    header->state = QUEUE_CONSTRUCTED;
+  };
+  /*
+   * Prevent another process from constructing the same queue concurrently
+   */
+  memory.atomic_func (findOrConstruct);
+
+  return queue;
+}
+
+template <class QueueType>
+QueueType *find_queue (boost::interprocess::managed_shared_memory &memory,
+                       const std::string &name,
+                       size_t             elementSize)
+{
+  auto block = memory.find<uint8_t> (name.c_str ());
+
+  if (block.first == nullptr)
+  {
+    return nullptr;
+  }
+
+  return open_queue<QueueType> (block.first, block.second, name, elementSize);
+}
+
+template <class QueueType>
+QueueType *find_queue_read_only (
+  boost::interprocess::managed_shared_memory &memory,
+  const std::string &name,
+  size_t             elementSize)
+{
+  auto block = memory.find_no_lock<uint8_t> (name.c_str ());
+
+  if (block.first == nullptr)
+  {
+    return nullptr;
+  }
+
+  return open_queue<QueueType> (block.first, block.second, name, elementSize);
+}
+
+} // namespace detail {
+} // namespace olive {
@@ -1,12 +1,166 @@
 #ifndef OLIVE_DETAIL_SPMC_BACK_PRESSURE_H
 #define OLIVE_DETAIL_SPMC_BACK_PRESSURE_H
 
+#include "Chrono.h"
+#include "detail/Doorbell.h"
 #include "detail/SharedMemory.h"
+#include "detail/Utils.h"
+
+#include <boost/interprocess/offset_ptr.hpp>
 
 #include <array>
 #include <atomic>
+#include <bitset>
+#include <limits>
+#include <vector>
 
 namespace olive {
+
+/*
+ * A NoDrop consumer exerts back-pressure on the producer so that it never drops
+ * messages. The number of NoDrop consumers is limited.
+ *
+ * A Drop consumer exerts no back-pressure. If the producer overwrites data
+ * before a Drop consumer reads it, the consumer skips ahead to the latest data
+ * and counts the dropped messages. The number of Drop consumers is unlimited.
+ */
+enum class ConsumerMode
+{
+  NoDrop,
+  Drop
+};
+
+/*
+ * A bitmap of message types, indexed by Header.type
+ */
+using TypeFilter = std::bitset<std::numeric_limits<uint8_t>::max () + 1>;
+
+/*
+ * Return a filter accepting all message types which carry consumer data
+ */
+inline
+TypeFilter all_message_types ()
+{
+  TypeFilter filter;
+
+  filter.set ();
+  filter.reset (WARMUP_MESSAGE_TYPE);
+  filter.reset (PADDING_MESSAGE_TYPE);
+
+  return filter;
+}
+
+/*
+ * Position in the queue from which a consumer starts reading when it registers
+ */
+struct StartPosition
+{
+  enum Origin
+  {
+    /*
+     * Start at the latest data pushed to the queue
+     */
+    Head,
+    /*
+     * Start at the oldest message still retained in the queue
+     */
+    Oldest,
+    /*
+     * Start at the first retained message with a sequence number of at least
+     * seqNum, or at the latest data if there is none
+     */
+    SequenceNumber
+  };
+
+  Origin   origin = { Head };
+
+  uint64_t seqNum = { 0 };
+};
+
+/*
+ * Limits on how far NoDrop consumers may hold back the producer. A consumer
+ * which exceeds a limit loses its back-pressure slot and continues as a Drop
+ * consumer. A zero limit is not applied.
+ */
+struct LagPolicy
+{
+  /*
+   * Maximum number of bytes a NoDrop consumer may lag behind the producer
+   */
+  uint64_t    maxLag = { 0 };
+  /*
+   * Maximum time for which the producer may be unable to claim space before
+   * the NoDrop consumers blocking it are demoted
+   */
+  Nanoseconds maxBlocked = { Nanoseconds (0) };
+};
+
+/*
+ * A snapshot of the metrics maintained by a queue, read without registering as
+ * a consumer
+ */
+struct QueueMetrics
+{
+  /*
+   * Progress of a NoDrop consumer
+   */
+  struct Consumer
+  {
+    uint8_t  index    = { 0 };
+    /*
+     * Process id of the consumer
+     */
+    int32_t  pid      = { 0 };
+    /*
+     * Cursor published by the consumer
+     */
+    size_t   cursor        = { 0 };
+    /*
+     * Messages consumed since the consumer registered
+     */
+    uint64_t consumed      = { 0 };
+    /*
+     * Bytes consumed since the consumer registered, including the messages
+     * skipped by its type filter
+     */
+    uint64_t consumedBytes = { 0 };
+    /*
+     * Bytes published by the producer and not yet consumed
+     */
+    uint64_t lag           = { 0 };
+  };
+  /*
+   * Cursor of the data published by the producer
+   */
+  size_t   committedCursor = { 0 };
+  /*
+   * Total bytes published by the producer
+   */
+  uint64_t committed = { 0 };
+  /*
+   * Number of messages published by the producer
+   */
+  uint64_t published = { 0 };
+  /*
+   * Number of times the producer found the queue full, counted once until it
+   * next claims space
+   */
+  uint64_t stalls    = { 0 };
+  /*
+   * Number of messages dropped by Drop consumers
+   */
+  uint64_t dropped   = { 0 };
+  /*
+   * Number of NoDrop consumers evicted by the producer
+   */
+  uint64_t evictions = { 0 };
+  /*
+   * NoDrop consumers holding a back-pressure slot. Drop consumers hold no slot
+   * and are only reported by the count of messages dropped.
+   */
+  std::vector<Consumer> consumers;
+};
+
 namespace detail {
 /*
  * Class to track how much data has been consumed by a consumer process
@@ -55,6 +209,64 @@ public:
   };
 
 public:
+  ConsumerState () = default;
+
+  explicit ConsumerState (ConsumerMode mode) : m_mode (mode) { }
+  /*
+   * Return true if the consumer may drop messages
+   */
+  ConsumerMode mode () const { return m_mode; }
+  /*
+   * Return the position from which the consumer starts reading on registration
+   */
+  const StartPosition &start () const { return m_start; }
+  /*
+   * Set the position from which the consumer starts reading on registration
+   */
+  void start (const StartPosition &start) { m_start = start; }
+  /*
+   * Return true while a NoDrop consumer which was moved behind its
+   * back-pressure slot replays the messages retained in the queue.
+   *
+   * Retained messages are not protected by back-pressure, so they are read and
+   * validated as by a Drop consumer until the consumer reaches the position of
+   * its slot.
+   */
+  bool replaying () const { return m_replayEnd > 0; }
+  /*
+   * Return the position at which replaying ends
+   */
+  uint64_t replay_end () const { return m_replayEnd; }
+  /*
+   * Read as a Drop consumer up to the position of the back-pressure slot
+   */
+  void replay (uint64_t end)
+  {
+    m_replayEnd = end;
+    m_mode      = ConsumerMode::Drop;
+  }
+  /*
+   * Resume reading as a NoDrop consumer
+   */
+  void end_replay ()
+  {
+    m_replayEnd = 0;
+    m_mode      = ConsumerMode::NoDrop;
+  }
+  /*
+   * Return true if the producer evicted the consumer from its back-pressure
+   * slot, after which it reads as a Drop consumer
+   */
+  bool evicted () const { return m_evicted; }
+  /*
+   * Continue reading as a Drop consumer after losing the back-pressure slot
+   */
+  void evict ()
+  {
+    m_evicted   = true;
+    m_replayEnd = 0;
+    m_mode      = ConsumerMode::Drop;
+  }
   /*
    * Pointer to the raw shared queue data
    */
@@ -69,7 +281,11 @@ public:
   /*
    * Return true if the ConsumerState object has been registered with a producer
    */
-  bool registered () const { return (m_index != Index::UnInitialised); }
+  bool registered () const
+  {
+    return (m_mode == ConsumerMode::NoDrop) ? (m_index != Index::UnInitialised)
+                                            : is_valid_cursor (m_cursor);
+  }
   /*
    * Each registered consumer has a different index value
    */
@@ -78,6 +294,15 @@ public:
    * Set the cursor to the currently read queue index value
    */
   void index (uint8_t index) { m_index = index; }
+  /*
+   * Return the registration number stored in the back-pressure slot of a
+   * NoDrop consumer, which identifies the consumer owning the slot
+   */
+  uint64_t registration () const { return m_registration; }
+  /*
+   * Set the registration number of the consumer
+   */
+  void registration (uint64_t registration) { m_registration = registration; }
   /*
    * Return the value of consumer queue cursor
    */
@@ -86,6 +311,108 @@ public:
    * Set the cursor to the currently read queue index value
    */
   void cursor (size_t cursor) { m_cursor = cursor; }
+  /*
+   * Return the total number of bytes produced up to the start of the current
+   * data range. Used by Drop consumers to detect data being overwritten.
+   */
+  uint64_t position () const { return m_position; }
+  /*
+   * Set the total number of bytes produced up to the start of the data range
+   */
+  void position (uint64_t position) { m_position = position; }
+  /*
+   * Return the number of messages dropped by a Drop consumer
+   */
+  uint64_t dropped () const { return m_dropped; }
+  /*
+   * Update the count of dropped messages from the sequence number of the latest
+   * message consumed. Returns the number of messages dropped before it.
+   */
+  uint64_t sequence_number (uint64_t seqNum)
+  {
+    uint64_t dropped = 0;
+
+    if (SPMC_EXPECT_FALSE (seqNum > m_seqNum + 1 && m_seqNum > 0))
+    {
+      dropped = seqNum - m_seqNum - 1;
+
+      m_dropped += dropped;
+    }
+
+    m_seqNum = seqNum;
+
+    return dropped;
+  }
+  /*
+   * Record the sequence number of the latest message consumed by a NoDrop
+   * consumer, from which the messages it misses are counted if it is evicted
+   */
+  void consumed_sequence_number (uint64_t seqNum)
+  {
+    m_seqNum = seqNum;
+
+    ++m_unpublishedMessages;
+  }
+  /*
+   * Return the number of messages consumed since the consumer last published
+   * its progress, and reset it
+   */
+  uint64_t publish_messages ()
+  {
+    uint64_t messages = m_unpublishedMessages;
+
+    m_unpublishedMessages = 0;
+
+    return messages;
+  }
+  /*
+   * Return the sequence number nearest to the last one extended by the
+   * consumer which has the low 32 bits of seqNum. Used to restore sequence
+   * numbers truncated by compact message headers.
+   */
+  uint64_t extend_sequence_number (uint32_t seqNum)
+  {
+    m_extendedSeqNum += static_cast<int32_t> (
+                          seqNum - static_cast<uint32_t> (m_extendedSeqNum));
+
+    return m_extendedSeqNum;
+  }
+  /*
+   * Extend the sequence numbers of compact message headers relative to seqNum,
+   * a sequence number recently published by the producer
+   */
+  void sequence_number_base (uint64_t seqNum) { m_extendedSeqNum = seqNum; }
+  /*
+   * Forget the sequence numbers of messages consumed, for example after the
+   * producer restarts its sequence
+   */
+  void reset_sequence_number ()
+  {
+    m_seqNum         = 0;
+    m_extendedSeqNum = 0;
+  }
+  /*
+   * Return the producer epoch in which the consumer was registered
+   */
+  uint64_t epoch () const { return m_epoch; }
+  /*
+   * Set the producer epoch in which the consumer was registered
+   */
+  void epoch (uint64_t epoch) { m_epoch = epoch; }
+  /*
+   * Set the message types passed to the consumer. Messages of other types are
+   * skipped without reading their payload.
+   *
+   * Warmup and padding messages are never passed to the consumer.
+   */
+  void type_filter (const TypeFilter &filter)
+  {
+    m_typeFilter = filter & all_message_types ();
+  }
+  /*
+   * Return true if messages of a type are passed to the consumer
+   */
+  bool accepts (uint8_t type) const { return m_typeFilter[type]; }
   /*
    * Return the data range object defining the currently consumable data range
    */
@@ -94,6 +421,11 @@ public:
    * Return a read-only data defining the currently consumable data range
    */
   const ConsumerState::DataRange &data_range () const { return m_dataRange; }
+  /*
+   * Buffer used to make data which wraps around the end of the queue
+   * contiguous when reading data in place
+   */
+  std::vector<uint8_t> &wrap_buffer () { return m_wrapBuffer; }
 
 private:
   /*
@@ -110,35 +442,249 @@ private:
    * the produced data has been consumed
    */
   size_t m_cursor = Cursor::UnInitialised;
+  /*
+   * Registration number of a NoDrop consumer, unique to each registration
+   */
+  uint64_t m_registration = 0;
 
   DataRange m_dataRange;
+  /*
+   * Total bytes produced up to the current data range
+   */
+  uint64_t m_position = 0;
+  /*
+   * Sequence number of the latest message consumed
+   */
+  uint64_t m_seqNum = 0;
+  /*
+   * Last sequence number restored from a compact message header
+   */
+  uint64_t m_extendedSeqNum = 0;
+  /*
+   * Number of messages dropped by a Drop consumer
+   */
+  uint64_t m_dropped = 0;
+  /*
+   * Number of messages consumed by a NoDrop consumer and not yet published to
+   * the counters of its slot
+   */
+  uint64_t m_unpublishedMessages = 0;
+  /*
+   * Producer epoch in which the consumer was registered
+   */
+  uint64_t m_epoch = 0;
+
+  ConsumerMode m_mode = ConsumerMode::NoDrop;
+  /*
+   * Position from which the consumer starts reading on registration
+   */
+  StartPosition m_start;
+  /*
+   * Position of the back-pressure slot of a replaying NoDrop consumer, zero if
+   * the consumer is not replaying
+   */
+  uint64_t m_replayEnd = 0;
+  /*
+   * True if the producer evicted the consumer from its back-pressure slot
+   */
+  bool m_evicted = false;
+  /*
+   * Message types passed to the consumer
+   */
+  TypeFilter m_typeFilter = all_message_types ();
+
+  std::vector<uint8_t> m_wrapBuffer;
 };
 
+/*
+ * Number of NoDrop consumers summarised by each consumer group cursor
+ */
+static constexpr uint8_t CONSUMER_GROUP_SIZE = 8;
+
+/*
+ * Number of 64 bit words in the bitmap of occupied consumer slots
+ */
+static constexpr size_t CONSUMER_BITMAP_WORDS = 4;
+
+/*
+ * Minimum interval between checks of the liveness of the NoDrop consumers
+ * which block the producer
+ */
+static constexpr Milliseconds CONSUMER_LIVENESS_INTERVAL = Milliseconds (1);
+
 /*
  * SPMCBackPressure manages the registration and unregistration of consumer
  * threads or processes with the queue.
  *
  * It exerts back pressure on the producer if required.
+ *
+ * The maximum number of NoDrop consumers is set at runtime and stored with
+ * the queue, MaxNoDropConsumers is the default. If there are more consumers
+ * than CONSUMER_GROUP_SIZE then the producer keeps the cursor of the slowest
+ * consumer of each group, and only rescans the consumers of a group when that
+ * cursor leaves too little space. Consumers only ever write their own slot.
+ *
+ * NoDrop consumers register and unregister without a lock. A consumer claims a
+ * slot by setting its bit in a bitmap of occupied slots, and the producer only
+ * scans the cursors of the occupied slots. A consumer which dies while holding
+ * a slot never blocks the registration of other consumers.
+ *
+ * A NoDrop consumer which blocks the producer is evicted from its slot if its
+ * process has exited, or if a consumer lease is set and the consumer does not
+ * advance within the lease. A lag policy also demotes consumers which advance,
+ * but too slowly. An evicted consumer continues as a Drop consumer.
+ *
+ * If PowerOf2Capacity is true the capacity must be a power of two. Cursors are
+ * then free running byte counters which are masked to get an offset in the
+ * queue buffer, so advancing cursors and computing available space need no
+ * wrap around branches.
  */
-template<class Mutex, uint8_t MaxNoDropConsumers = MAX_NO_DROP_CONSUMERS_DEFAULT>
+template<uint8_t MaxNoDropConsumers = MAX_NO_DROP_CONSUMERS_DEFAULT,
+         bool PowerOf2Capacity = false>
 class SPMCBackPressure
 {
 public:
-  SPMCBackPressure (size_t capacity);
   /*
-   * If a consumer registers successful then back-pressure is exerted on the
-   * producer by all registered consumers so that message dropping is prevented.
+   * Construct the back pressure state for up to maxConsumers NoDrop consumers.
+   *
+   * The consumer slots are constructed in slotMemory which must be at least
+   * slot_memory_size (maxConsumers) bytes.
+   */
+  SPMCBackPressure (size_t capacity,
+                    uint8_t maxConsumers,
+                    uint8_t *slotMemory);
+  /*
+   * Return the size of memory required for the consumer slots
+   */
+  static size_t slot_memory_size (uint8_t maxConsumers);
+  /*
+   * Return the maximum number of NoDrop consumers
+   */
+  uint8_t consumer_capacity () const { return m_consumerCapacity; }
+  /*
+   * If a NoDrop consumer registers successful then back-pressure is exerted on
+   * the producer by all registered consumers so that message dropping is
+   * prevented.
    *
    * The consumer object passed is registered as one of the consumers in use and
    * is set to the index of the latest data pushed to the queue.
    *
+   * A Drop consumer does not use a consumer slot and is set to the latest data
+   * pushed to the queue.
+   *
    * Throws if registration fails.
    */
   void register_consumer (ConsumerState &consumer);
+  /*
+   * Move a consumer with an empty data range back to position, the total
+   * number of bytes produced before a message still retained in the queue.
+   *
+   * A NoDrop consumer replays the retained data as a Drop consumer, while its
+   * back-pressure slot stays at the position from which it was moved.
+   */
+  void rewind (ConsumerState &consumer, uint64_t position) const;
+  /*
+   * Return the total number of bytes produced up to the start of the data
+   * range of a consumer
+   */
+  uint64_t consumer_position (const ConsumerState &consumer) const;
   /*
    * Unregister a consumer
    */
   void unregister_consumer (const ConsumerState &consumer);
+  /*
+   * Set the time for which a NoDrop consumer may block the producer without
+   * advancing before it is evicted. A zero lease, the default, only evicts
+   * consumers whose process has exited.
+   *
+   * Set the lease well above the longest time a consumer takes to process the
+   * messages it reads in one data range. A consumer evicted while reading a
+   * data range is not protected from the producer overwriting that range.
+   */
+  void consumer_lease (Nanoseconds lease)
+  {
+    m_lease.store (lease.count (), std::memory_order_relaxed);
+  }
+  /*
+   * Return the consumer lease
+   */
+  Nanoseconds consumer_lease () const
+  {
+    return Nanoseconds (m_lease.load (std::memory_order_relaxed));
+  }
+  /*
+   * Set the limits beyond which a lagging NoDrop consumer is demoted to a Drop
+   * consumer, so that the latency of the producer is bounded by the policy
+   * rather than by the slowest consumer.
+   *
+   * The lag in bytes is checked when the producer rescans the consumer cursors
+   * and the blocked time while the queue is full. As with the consumer lease,
+   * a consumer demoted while reading a data range is not protected from the
+   * producer overwriting that range, so set the limits well above the lag of
+   * a consumer keeping up.
+   */
+  void lag_policy (const LagPolicy &policy)
+  {
+    m_maxLag.store (policy.maxLag, std::memory_order_relaxed);
+    m_maxBlocked.store (policy.maxBlocked.count (), std::memory_order_relaxed);
+  }
+  /*
+   * Return the lag policy
+   */
+  LagPolicy lag_policy () const
+  {
+    LagPolicy policy;
+
+    policy.maxLag     = m_maxLag.load (std::memory_order_relaxed);
+    policy.maxBlocked = Nanoseconds (m_maxBlocked.load (
+                                     std::memory_order_relaxed));
+    return policy;
+  }
+  /*
+   * Return the number of NoDrop consumers evicted by the producer
+   */
+  uint64_t evictions () const
+  {
+    return m_evictions.load (std::memory_order_relaxed);
+  }
+  /*
+   * Count messages published by the producer
+   */
+  void published (uint64_t count) { increment (m_metrics.published, count); }
+  /*
+   * Count messages dropped by a Drop consumer
+   */
+  void dropped (uint64_t count)
+  {
+    m_metrics.dropped.fetch_add (count, std::memory_order_relaxed);
+  }
+  /*
+   * Read a snapshot of the queue metrics.
+   *
+   * Only loads from the shared state, so may be called from a process which
+   * maps the queue read-only.
+   */
+  void metrics (QueueMetrics &metrics) const;
+  /*
+   * Return the producer epoch, incremented each time a producer restarts using
+   * an existing queue
+   */
+  uint64_t epoch () const { return m_epoch.load (std::memory_order_acquire); }
+  /*
+   * Start a new producer epoch at the latest committed data. Space claimed but
+   * not committed by the previous producer is discarded.
+   *
+   * Called by a producer which has opened an existing queue.
+   */
+  void restart_producer ();
+  /*
+   * Move a consumer registered in an earlier producer epoch to the first data
+   * of the current epoch, keeping the back-pressure slot of a NoDrop consumer.
+   *
+   * The slot of a NoDrop consumer is never ahead of the start of the epoch, so
+   * the data of the epoch is protected by back-pressure until it is read.
+   */
+  void restart_consumer (ConsumerState &consumer);
   /*
    * Return the max size used in cursor index computations
    */
@@ -177,44 +723,233 @@ public:
    * all of the consumers
    */
   size_t write_available ();
+  /*
+   * Return the minimum size of queue data which is writable, rescanning only
+   * the consumer groups which leave less than size bytes writable
+   */
+  size_t write_available (size_t size);
+  /*
+   * Return true if the producer may have overwritten data at a position, where
+   * position is the total number of bytes produced before the data.
+   *
+   * Call after reading data to validate it.
+   */
+  bool overwritten (uint64_t position) const;
+  /*
+   * Return true if the producer may have overwritten data read in place by a
+   * NoDrop consumer, which is only possible once it has evicted the consumer.
+   *
+   * Call after reading data to validate it.
+   */
+  bool overwritten (const ConsumerState &consumer, uint64_t position) const;
+  /*
+   * Skip a Drop consumer forward to the latest data in the queue
+   */
+  void resync (ConsumerState &consumer) const;
   /*
    * Return the index of the committed data cursor
    */
   size_t committed_cursor () const;
+  /*
+   * Return the total number of bytes claimed by the producer. Only valid in
+   * the producer.
+   */
+  uint64_t claimed_total () const;
+  /*
+   * Return the cursor referencing a position, the total number of bytes
+   * produced before it
+   */
+  size_t cursor_at (uint64_t position) const;
   /*
    * Return the value of a cursor advanced a number of bytes along a circular
    * buffer
    */
   size_t advance_cursor (size_t cursor, size_t advance) const;
+  /*
+   * Return the offset in the queue buffer referenced by a cursor
+   */
+  size_t index (size_t cursor) const;
+  /*
+   * Return the doorbell rung by the producer when data is published
+   */
+  Doorbell &doorbell () { return *m_ringDoorbell; }
+  /*
+   * Ring a doorbell in the same shared memory as the queue in place of the
+   * doorbell of the queue, so that consumers of several queues are woken by a
+   * single ring. Call before consumers open the queue.
+   */
+  void share_doorbell (Doorbell &doorbell) { m_ringDoorbell = &doorbell; }
 
 private:
   SPMCBackPressure ();
 
+  /*
+   * State published by a NoDrop consumer to the producer.
+   *
+   * Each slot occupies its own cache line so that a consumer publishing its
+   * cursor does not invalidate the cache line of any other consumer. Space
+   * remaining in the cache line is available for per-consumer counters.
+   *
+   * The stall fields are only written by the producer while the consumer
+   * blocks it.
+   */
+  struct alignas (CACHE_LINE_SIZE) ConsumerSlot
+  {
+    std::atomic<size_t>   cursor = { Cursor::UnInitialised };
+    /*
+     * Registration number of the consumer owning the slot, zero if none.
+     *
+     * The slot is freed by exchanging the owner for zero, which only one of
+     * the consumer unregistering, the producer evicting it or a consumer
+     * reclaiming the slot of an exited process succeeds in doing.
+     */
+    std::atomic<uint64_t> owner = { 0 };
+    /*
+     * Process id of the consumer owning the slot
+     */
+    std::atomic<int32_t>  pid = { 0 };
+    /*
+     * Cursor of the consumer when it was first found blocking the producer
+     */
+    std::atomic<size_t>   stalledCursor = { Cursor::UnInitialised };
+    /*
+     * Time in nanoseconds since the clock epoch at which the consumer was first
+     * found blocking the producer at stalledCursor
+     */
+    std::atomic<int64_t>  stalledSince = { 0 };
+    /*
+     * Messages and bytes consumed since the consumer registered, written only
+     * by the consumer when it publishes its cursor
+     */
+    std::atomic<uint64_t> consumedMessages = { 0 };
+
+    std::atomic<uint64_t> consumedBytes = { 0 };
+  };
+
+  static_assert (sizeof (ConsumerSlot) == CACHE_LINE_SIZE,
+                 "ConsumerSlot must occupy a single cache line");
+
   /*
    * Return the size of queue data which is writable for given reader and writer
    * cursors
    */
   size_t write_available (size_t readerCursor, size_t writerCursor) const;
+  /*
+   * Return the size of queue data which is readable for given reader and writer
+   * cursors
+   */
+  size_t read_available (size_t readerCursor, size_t writerCursor) const;
+  /*
+   * Return the minimum size of queue data which is writable taking into account
+   * the cursors of the occupied consumer slots
+   */
+  size_t slowest_consumer_write_available () const;
+  /*
+   * Call function (index) for each occupied consumer slot
+   */
+  template <class Function>
+  void for_each_consumer (Function &&function) const;
+  /*
+   * Return the number of occupied consumer slots
+   */
+  size_t consumer_count () const;
+  /*
+   * Claim a free consumer slot in the slot bitmap.
+   *
+   * Returns false if every slot is occupied.
+   */
+  bool claim_slot (uint8_t &index);
+  /*
+   * Free a slot owned by the consumer with registration number owner.
+   *
+   * Returns false if the slot has already been freed.
+   */
+  bool release_slot (uint8_t index, uint64_t owner);
+  /*
+   * Free the slots held by consumers whose process has exited, called when a
+   * consumer registering finds no free slot.
+   *
+   * Returns true if a slot was freed.
+   */
+  bool reclaim_slots ();
+  /*
+   * Return the cursor of the slowest consumer in a consumer group, scanning the
+   * occupied slots of the group
+   */
+  size_t slowest_group_cursor (size_t group) const;
+  /*
+   * Return the total number of bytes published by the producer
+   */
+  uint64_t committed_total () const;
+  /*
+   * Evict the NoDrop consumers which prevent size bytes being acquired and are
+   * no longer alive. Called by the producer while the queue is full, now is
+   * the current time in nanoseconds since the clock epoch.
+   *
+   * Returns true if a consumer was evicted.
+   */
+  bool evict_stalled_consumers (size_t size, int64_t now);
+  /*
+   * Demote the NoDrop consumers lagging the producer by more than maxLag bytes.
+   *
+   * Returns true if a consumer was demoted.
+   */
+  bool demote_lagging_consumers (uint64_t maxLag);
+  /*
+   * Evict the consumer in a slot if its cursor has not moved from cursor
+   */
+  bool evict_consumer (uint8_t index, size_t cursor, const char *reason);
+  /*
+   * Switch a NoDrop consumer evicted by the producer to reading as a Drop
+   * consumer from its current position
+   */
+  void demote (ConsumerState &consumer) const;
+  /*
+   * Return true if a NoDrop consumer no longer owns its back-pressure slot
+   */
+  bool lost_slot (const ConsumerState &consumer) const;
+  /*
+   * Add to a counter which has a single writer, without a locked
+   * read-modify-write instruction
+   */
+  static void increment (std::atomic<uint64_t> &counter, uint64_t count)
+  {
+    counter.store (counter.load (std::memory_order_relaxed) + count,
+                   std::memory_order_relaxed);
+  }
 
 private:
   /*
-   * Index used to implement fair servicing of the ConsumerArray
-   * TODO: make use of this variable!!
+   * Maximum number of NoDrop consumers
+   */
+  const uint8_t m_consumerCapacity = { 0 };
+  /*
+   * Number of consumer groups, zero if consumers are not grouped
    */
-  uint8_t m_consumerIndex = { 0 };
+  const uint8_t m_groupCount = { 0 };
+  /*
+   * Time in nanoseconds for which a consumer may block the producer without
+   * advancing, zero to only evict consumers whose process has exited
+   */
+  std::atomic<int64_t> m_lease = { 0 };
+  /*
+   * Lag policy limits, zero if not applied
+   */
+  std::atomic<uint64_t> m_maxLag = { 0 };
+
+  std::atomic<int64_t>  m_maxBlocked = { 0 };
   /*
-   * Current maximum value of consumer indexes
-   * Used during consumer registration
+   * Number of words of the slot bitmap covering the consumer slots
    */
-  uint8_t m_maxConsumerIndex = { 0 };
+  const uint8_t m_bitmapWords = { 0 };
   /*
-   * Current number of consumers
-   * Should be atomic or is the mutex synchronise adequate??
+   * Bitmap of the occupied consumer slots, set by consumers registering and
+   * read by the producer when it scans the consumer cursors
    */
   alignas (CACHE_LINE_SIZE)
-  std::atomic<uint8_t> m_maxConsumers = { 0 };
+  std::array<std::atomic<uint64_t>, CONSUMER_BITMAP_WORDS> m_slotBitmap;
   /*
-   * Queue capacity + 1
+   * Queue capacity + 1, or the queue capacity if PowerOf2Capacity is true
    */
   const size_t m_maxSize = { 0 };
   /*
@@ -225,20 +960,99 @@ private:
    */
   alignas (CACHE_LINE_SIZE)
   size_t m_claimed = { 0 };
+  /*
+   * Space known to be writable by the producer from the last scan of the
+   * consumer cursors, less the space claimed since
+   */
+  size_t m_writeBudget = { 0 };
+  /*
+   * Time in nanoseconds since the clock epoch after which the producer next
+   * checks the liveness of the consumers blocking it
+   */
+  int64_t m_nextLivenessCheck = { 0 };
+  /*
+   * Time in nanoseconds since the clock epoch at which the producer was first
+   * unable to claim space, zero while it is not blocked
+   */
+  int64_t m_blockedSince = { 0 };
+  /*
+   * Total number of bytes claimed by the producer.
+   *
+   * Drop consumers use this counter to check if the producer has begun
+   * overwriting data which the consumer has just read.
+   */
+  std::atomic<uint64_t> m_claimedTotal = { 0 };
   /*
    * Counter used by the producer to publish a data range
    */
   alignas (CACHE_LINE_SIZE)
   std::atomic<size_t> m_committed = { 0 };
   /*
-   * Array holding the bytes consumed for each non message dropping consumer
+   * Total number of bytes published by the producer.
+   *
+   * Not used if PowerOf2Capacity is true as m_committed is also a total.
+   */
+  std::atomic<uint64_t> m_committedTotal = { 0 };
+  /*
+   * Producer epoch, on the cache line consumers load when requesting data
+   */
+  std::atomic<uint64_t> m_epoch = { 0 };
+  /*
+   * Total number of bytes published before the current producer epoch
+   */
+  std::atomic<uint64_t> m_epochPosition = { 0 };
+  /*
+   * Array holding the bytes consumed for each non message dropping consumer.
+   *
+   * Offset pointers are valid in every process mapping the shared memory.
    */
   alignas (CACHE_LINE_SIZE)
-  std::array<size_t, MaxNoDropConsumers> m_consumerIndexes;
+  boost::interprocess::offset_ptr<ConsumerSlot> m_consumerSlots;
+  /*
+   * Array holding the cursor of the slowest consumer in each consumer group
+   * when the producer last scanned the group. Only the producer reads and
+   * writes the group slots, and as consumers only advance a group cursor never
+   * overstates the space freed by the group.
+   */
+  boost::interprocess::offset_ptr<ConsumerSlot> m_groupSlots;
+  /*
+   * Doorbell rung when data is published, m_doorbell unless it is shared with
+   * other queues
+   */
+  boost::interprocess::offset_ptr<Doorbell> m_ringDoorbell;
   /*
-   * Mutex used to register and unregister consumer threads
+   * Doorbell waking consumers which block while the queue is empty
    */
-  Mutex m_mutex;
+  Doorbell m_doorbell;
+  /*
+   * Number of consumers registered, used to number registrations
+   */
+  std::atomic<uint64_t> m_registrations = { 0 };
+  /*
+   * Number of consumers evicted by the producer
+   */
+  std::atomic<uint64_t> m_evictions = { 0 };
+  /*
+   * Counters read by monitoring tools, on cache lines apart from the cursors
+   * so that updating them does not disturb the producer or the consumers
+   */
+  struct Metrics
+  {
+    /*
+     * Written by the producer only
+     */
+    alignas (CACHE_LINE_SIZE)
+    std::atomic<uint64_t> published = { 0 };
+
+    std::atomic<uint64_t> stalls = { 0 };
+    /*
+     * Written by Drop consumers when they find a gap in the messages
+     */
+    alignas (CACHE_LINE_SIZE)
+    std::atomic<uint64_t> dropped = { 0 };
+  };
+
+  Metrics m_metrics;
 };
 
 } // namespace detail {
@@ -3,81 +3,136 @@
 
 #include <boost/log/trivial.hpp>
 
-#include <mutex>
+#include <cerrno>
+
+#include <signal.h>
+#include <unistd.h>
 
 namespace olive {
 namespace detail {
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-SPMCBackPressure<Mutex, MaxNoDropConsumers>::SPMCBackPressure (size_t capacity)
-: m_maxSize (capacity + 1)
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  SPMCBackPressure (size_t capacity, uint8_t maxConsumers, uint8_t *slotMemory)
+: m_consumerCapacity (maxConsumers)
+, m_groupCount ((maxConsumers > CONSUMER_GROUP_SIZE)
+              ? (maxConsumers + CONSUMER_GROUP_SIZE - 1) / CONSUMER_GROUP_SIZE
+              : 0)
+, m_bitmapWords ((maxConsumers + 63) / 64)
+, m_maxSize (PowerOf2Capacity ? capacity : capacity + 1)
 {
   CHECK_SS (capacity < (std::numeric_limits<size_t>::max ()),
             "Requested queue capacity too large");
 
-  std::lock_guard<Mutex> g (m_mutex);
+  CHECK_SS (!PowerOf2Capacity ||
+            (capacity > 0 && MODULUS_POWER_OF_2 (capacity, capacity) == 0),
+            "Queue capacity must be a power of two: " << capacity);
+
+  CHECK_SS (maxConsumers > 0 && maxConsumers < Index::UnInitialised,
+            "Invalid maximum consumer count: "
+              << static_cast<size_t> (maxConsumers));
 
-  for (size_t i = 0; i < MaxNoDropConsumers; ++i)
+  CHECK (slotMemory != nullptr, "Invalid consumer slot memory");
+
+  for (auto &word : m_slotBitmap)
   {
-    m_consumerIndexes[i] = Cursor::UnInitialised;
+    word.store (0, std::memory_order_relaxed);
   }
+  /*
+   * Consumer slots are followed by the group slots, if any
+   */
+  void  *ptr   = slotMemory;
+  size_t space = slot_memory_size (maxConsumers);
+
+  ConsumerSlot *slots = reinterpret_cast<ConsumerSlot*> (
+    std::align (alignof (ConsumerSlot),
+                sizeof (ConsumerSlot) * (m_consumerCapacity + m_groupCount),
+                ptr, space));
+
+  for (size_t i = 0; i < (m_consumerCapacity + m_groupCount); ++i)
+  {
+    new (slots + i) ConsumerSlot ();
+  }
+
+  m_consumerSlots = slots;
+  m_groupSlots    = slots + m_consumerCapacity;
+
+  m_ringDoorbell  = &m_doorbell;
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-void SPMCBackPressure<Mutex, MaxNoDropConsumers>::register_consumer (
-  ConsumerState &consumer)
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  slot_memory_size (uint8_t maxConsumers)
 {
-  std::lock_guard<Mutex> g (m_mutex);
+  size_t groups = (maxConsumers > CONSUMER_GROUP_SIZE)
+                ? (maxConsumers + CONSUMER_GROUP_SIZE - 1) / CONSUMER_GROUP_SIZE
+                : 0;
+
+  return sizeof (ConsumerSlot) * (maxConsumers + groups) + alignof (ConsumerSlot);
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  register_consumer (ConsumerState &consumer)
+{
+  consumer.epoch (epoch ());
+
+  if (consumer.mode () == ConsumerMode::Drop)
+  {
+    resync (consumer);
+
+    BOOST_LOG_TRIVIAL (info) << "Registered message dropping consumer";
+
+    return;
+  }
 
   BOOST_LOG_TRIVIAL (info) << "Register consumer";
+  /*
+   * Slots are claimed without a lock, so a consumer which dies while
+   * registering cannot block other consumers. The slots of consumers whose
+   * process has exited are reclaimed when every slot is occupied.
+   */
+  uint8_t index = 0;
 
-  CHECK_SS (m_maxConsumers < std::numeric_limits<uint8_t>::max (),
-            "Too many consumers requested, max: "
-              << std::numeric_limits<uint8_t>::max ());
+  bool claimed = claim_slot (index) || (reclaim_slots () && claim_slot (index));
   /*
    * SPMCBackPressure supports a limited number of consumer threads
    */
-  CHECK_SS (m_maxConsumers < MaxNoDropConsumers,
+  CHECK_SS (claimed,
             "Failed to register a new consumer. Maximum consumer count is "
-              << static_cast<size_t> (MaxNoDropConsumers));
+              << static_cast<size_t> (m_consumerCapacity));
   /*
-   * Intialisation of consumers is serialised to be one at a time
+   * Identify the consumer and its process so that the producer can evict it if
+   * it stops reading
    */
-  bool registered = false;
-  uint8_t index = 0;
+  auto &slot = m_consumerSlots[index];
+
+  consumer.registration (m_registrations.fetch_add (1,
+                                              std::memory_order_relaxed) + 1);
+
+  slot.owner.store (consumer.registration (), std::memory_order_relaxed);
+  slot.pid.store (::getpid (), std::memory_order_relaxed);
+  slot.stalledSince.store (0, std::memory_order_relaxed);
+  slot.consumedMessages.store (0, std::memory_order_relaxed);
+  slot.consumedBytes.store (0, std::memory_order_relaxed);
+
+  consumer.publish_messages ();
   /*
-   * Re-use spare slots for new comsumers if there are any available
+   * Start at the latest data. Record its position so that the consumer can be
+   * rewound to retained data.
    */
-  for (uint8_t i = 0; i < m_maxConsumerIndex; ++i)
-  {
-    if (m_consumerIndexes[i] == Cursor::UnInitialised)
-    {
-      m_consumerIndexes[i] = m_committed;
-      index          = i;
-      registered     = true;
-      break;
-    }
-    BOOST_LOG_TRIVIAL (debug)
-      << "Consumer index not available: m_consumerIndexes[" << static_cast<size_t> (i)
-      << "]=" << cursor_to_string (m_consumerIndexes[i]);
-  }
+  uint64_t position  = committed_total ();
+  size_t   committed = cursor_at (position);
   /*
-   * If there are no unused slots, use a new slot if one is available
+   * Publishing the cursor exerts back pressure on the producer
    */
-  if (!registered)
-  {
-    m_consumerIndexes[m_maxConsumerIndex] = m_committed;
-
-    index = m_maxConsumerIndex;
-
-    ++m_maxConsumerIndex;
-  }
-
-  ++m_maxConsumers;
+  slot.cursor.store (committed, std::memory_order_release);
   /*
    * Initialise the consumer cursor to start at the current latest data
    */
-  consumer.cursor (m_consumerIndexes[index]);
+  consumer.cursor (committed);
+
+  consumer.position (position);
   /*
    * Set the index used by the producer to exert back pressure
    */
@@ -85,45 +140,193 @@ void SPMCBackPressure<Mutex, MaxNoDropConsumers>::register_consumer (
 
   BOOST_LOG_TRIVIAL (info) << "Registered consumer index="
                            << std::to_string (index)
-                           << " consumer count="
-                           << static_cast<size_t> (m_maxConsumers);
+                           << " consumer count=" << consumer_count ();
 
   BOOST_LOG_TRIVIAL (debug)
-    << "max consumer index=" << static_cast<size_t> (m_maxConsumerIndex)
-    << "|cursor=" << cursor_to_string (consumer.cursor ())
+    << "cursor=" << cursor_to_string (consumer.cursor ())
     << "|write available=" << write_available (consumer.cursor (), m_claimed);
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-void SPMCBackPressure<Mutex, MaxNoDropConsumers>::unregister_consumer (
-  const ConsumerState &consumer)
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  rewind (ConsumerState &consumer, uint64_t position) const
 {
-  std::lock_guard<Mutex> g (m_mutex);
+  uint64_t head = consumer_position (consumer);
+  /*
+   * The retained data may have moved past the consumer
+   */
+  if (position >= head)
+  {
+    return;
+  }
+
+  if (consumer.mode () == ConsumerMode::NoDrop)
+  {
+    consumer.replay (head);
+  }
+
+  consumer.position (position);
+
+  consumer.cursor (cursor_at (position));
+
+  consumer.data_range ().read_available (0);
+
+  BOOST_LOG_TRIVIAL (info) << "Consumer rewound " << (head - position)
+                           << " bytes to retained data";
+}
 
-  if (is_valid_cursor (consumer.cursor ()))
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+uint64_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  consumer_position (const ConsumerState &consumer) const
+{
+  if (consumer.mode () == ConsumerMode::Drop)
   {
-    m_consumerIndexes[consumer.index ()] = Cursor::UnInitialised;
+    return consumer.position ();
+  }
+  /*
+   * The cursor of a NoDrop consumer is behind the committed data, so its
+   * position is found from the distance between them
+   */
+  uint64_t committed = committed_total ();
 
-    --m_maxConsumers;
+  return committed - read_available (consumer.cursor (), cursor_at (committed));
+}
 
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  unregister_consumer (const ConsumerState &consumer)
+{
+  if (consumer.mode () == ConsumerMode::Drop && !consumer.replaying ())
+  {
+    return;
+  }
+
+  /*
+   * The slot of an evicted consumer may have been reused by another consumer,
+   * in which case it is no longer owned by this registration
+   */
+  if (consumer.registration () != 0 &&
+      release_slot (consumer.index (), consumer.registration ()))
+  {
     BOOST_LOG_TRIVIAL (debug) << "Unregistered consumer (index="
                               << index_to_string (consumer.index ()) << ")";
-    BOOST_LOG_TRIVIAL (debug) << "Consumer count: " << std::to_string (m_maxConsumers);
+    BOOST_LOG_TRIVIAL (debug) << "Consumer count: " << consumer_count ();
+  }
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  restart_producer ()
+{
+  /*
+   * Discard any claim left by a producer which stopped while pushing data
+   */
+  m_claimed = m_committed.load (std::memory_order_acquire);
+
+  m_claimedTotal.store (committed_total (), std::memory_order_relaxed);
+
+  m_writeBudget = 0;
+
+  m_epochPosition.store (committed_total (), std::memory_order_relaxed);
+  /*
+   * Publish the new epoch once the producer state has been reset
+   */
+  uint64_t epoch = m_epoch.fetch_add (1, std::memory_order_acq_rel) + 1;
+
+  BOOST_LOG_TRIVIAL (info) << "Producer restarted, epoch=" << epoch;
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  restart_consumer (ConsumerState &consumer)
+{
+  /*
+   * Load the epoch before the position at which it starts
+   */
+  consumer.epoch (epoch ());
+
+  uint64_t position = m_epochPosition.load (std::memory_order_relaxed);
+  /*
+   * The slot of a NoDrop consumer references the position it last published,
+   * where a replaying consumer returns to
+   */
+  size_t expected = cursor_at (consumer.replaying () ? consumer.replay_end ()
+                                                     : consumer.position ());
+
+  consumer.reset_sequence_number ();
+
+  if (consumer.replaying ())
+  {
+    consumer.end_replay ();
+  }
+
+  if (consumer.mode () == ConsumerMode::NoDrop && lost_slot (consumer))
+  {
+    consumer.evict ();
+  }
+
+  size_t cursor = cursor_at (position);
+
+  consumer.cursor (cursor);
+
+  consumer.position (position);
+
+  consumer.data_range ().read_available (0);
+
+  if (consumer.mode () == ConsumerMode::Drop)
+  {
+    return;
+  }
+  /*
+   * The producer may evict the consumer while it moves
+   */
+  if (!m_consumerSlots[consumer.index ()].cursor.compare_exchange_strong (
+                                    expected, cursor, std::memory_order_release,
+                                    std::memory_order_relaxed))
+  {
+    consumer.evict ();
+
+    return;
   }
+
+  BOOST_LOG_TRIVIAL (info) << "Consumer index="
+                           << std::to_string (consumer.index ())
+                           << " moved to the start of epoch="
+                           << consumer.epoch ();
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-size_t SPMCBackPressure<Mutex, MaxNoDropConsumers>::committed_cursor () const
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  committed_cursor () const
 {
   return m_committed.load (std::memory_order_release);
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-size_t SPMCBackPressure<Mutex, MaxNoDropConsumers>::advance_cursor (
-  size_t cursor, size_t advance) const
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+uint64_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  claimed_total () const
+{
+  return m_claimedTotal.load (std::memory_order_relaxed);
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  cursor_at (uint64_t position) const
+{
+  return PowerOf2Capacity ? position : position % m_maxSize;
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  advance_cursor (size_t cursor, size_t advance) const
 {
   cursor += advance;
 
+  if (PowerOf2Capacity)
+  {
+    return cursor;
+  }
+
   if (cursor < m_maxSize)
   {
     return cursor;
@@ -136,14 +339,85 @@ size_t SPMCBackPressure<Mutex, MaxNoDropConsumers>::advance_cursor (
   return 0;
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-bool SPMCBackPressure<Mutex, MaxNoDropConsumers>::acquire_space (size_t size)
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::index (
+  size_t cursor) const
 {
-  size_t space = write_available ();
+  if (PowerOf2Capacity)
+  {
+    return MODULUS_POWER_OF_2 (cursor, m_maxSize);
+  }
+
+  return cursor;
+}
 
-  if (space >= size)
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  acquire_space (size_t size)
+{
+  /*
+   * Consumers only ever free space, so space found free by the last scan of
+   * the consumer cursors remains free. Only rescan the cursors, pulling their
+   * cache lines to the producer, when the cached space is too small.
+   */
+  if (m_writeBudget < size)
   {
+    m_writeBudget = write_available (size);
+    /*
+     * A consumer lagging by more than the lag policy allows leaves less than
+     * capacity - maxLag bytes writable
+     */
+    uint64_t maxLag = m_maxLag.load (std::memory_order_relaxed);
+
+    if (SPMC_EXPECT_FALSE (maxLag > 0) &&
+        m_writeBudget + maxLag < write_available (m_claimed, m_claimed) &&
+        demote_lagging_consumers (maxLag))
+    {
+      m_writeBudget = write_available (size);
+    }
+    /*
+     * A consumer which is no longer alive must not block the producer forever
+     */
+    if (SPMC_EXPECT_FALSE (m_writeBudget < size))
+    {
+      int64_t now = nanoseconds_since_epoch (Clock::now ());
+
+      if (m_blockedSince == 0)
+      {
+        m_blockedSince = now;
+
+        increment (m_metrics.stalls, 1);
+      }
+
+      if (evict_stalled_consumers (size, now))
+      {
+        m_writeBudget = write_available (size);
+      }
+    }
+  }
+
+  if (m_writeBudget >= size)
+  {
+    m_writeBudget -= size;
+
+    m_blockedSince = 0;
+
     m_claimed = advance_cursor (m_claimed, size);
+    /*
+     * Publish the claim before the data is written so that a Drop consumer
+     * reading the same bytes can detect they were overwritten
+     */
+    if (PowerOf2Capacity)
+    {
+      m_claimedTotal.store (m_claimed, std::memory_order_relaxed);
+    }
+    else
+    {
+      m_claimedTotal.store (m_claimedTotal.load (std::memory_order_relaxed)
+                              + size, std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence (std::memory_order_release);
 
     return true;
   }
@@ -151,18 +425,104 @@ bool SPMCBackPressure<Mutex, MaxNoDropConsumers>::acquire_space (size_t size)
   return false;
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-void SPMCBackPressure<Mutex, MaxNoDropConsumers>::release_space ()
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  release_space ()
 {
+  if (!PowerOf2Capacity)
+  {
+    m_committedTotal.store (m_claimedTotal.load (std::memory_order_relaxed),
+                            std::memory_order_release);
+  }
+
   m_committed.store (m_claimed, std::memory_order_release);
+
+  m_ringDoorbell->ring ();
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-size_t SPMCBackPressure<Mutex, MaxNoDropConsumers>::read_available (
-  const ConsumerState &consumer) const
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+uint64_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  committed_total () const
 {
-  size_t readerCursor = consumer.cursor ();
-  size_t writerCursor = m_committed.load (std::memory_order_acquire);
+  if (PowerOf2Capacity)
+  {
+    return m_committed.load (std::memory_order_acquire);
+  }
+
+  return m_committedTotal.load (std::memory_order_acquire);
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  overwritten (uint64_t position) const
+{
+  /*
+   * Order the preceding data reads before loading the claimed total
+   */
+  std::atomic_thread_fence (std::memory_order_acquire);
+
+  return (m_claimedTotal.load (std::memory_order_relaxed)
+            > position + m_maxSize);
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::overwritten (
+  const ConsumerState &consumer, uint64_t position) const
+{
+  /*
+   * The producer releases the slot of a consumer it evicts before claiming the
+   * space the consumer held, so only the consumer's own slot is read unless it
+   * was evicted
+   */
+  std::atomic_thread_fence (std::memory_order_acquire);
+
+  return (lost_slot (consumer) &&
+          m_claimedTotal.load (std::memory_order_relaxed)
+            > position + m_maxSize);
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::resync (
+  ConsumerState &consumer) const
+{
+  /*
+   * A replaying consumer skips to the position of its back-pressure slot, from
+   * where its data is protected by back-pressure
+   */
+  uint64_t position = consumer.replaying () ? consumer.replay_end ()
+                                            : committed_total ();
+
+  consumer.position (position);
+
+  consumer.cursor (cursor_at (position));
+
+  consumer.data_range ().read_available (0);
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  read_available (const ConsumerState &consumer) const
+{
+  if (consumer.mode () == ConsumerMode::Drop)
+  {
+    uint64_t end = consumer.replaying () ? consumer.replay_end ()
+                                         : committed_total ();
+
+    return end - consumer.position ();
+  }
+
+  return read_available (consumer.cursor (),
+                         m_committed.load (std::memory_order_acquire));
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  read_available (size_t readerCursor, size_t writerCursor) const
+{
+  if (PowerOf2Capacity)
+  {
+    return writerCursor - readerCursor;
+  }
 
   if (is_valid_cursor (writerCursor))
   {
@@ -177,10 +537,15 @@ size_t SPMCBackPressure<Mutex, MaxNoDropConsumers>::read_available (
   return 0;
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-size_t SPMCBackPressure<Mutex, MaxNoDropConsumers>::write_available (
-  size_t readerCursor, size_t writerCursor) const
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  write_available (size_t readerCursor, size_t writerCursor) const
 {
+  if (PowerOf2Capacity)
+  {
+    return m_maxSize - (writerCursor - readerCursor);
+  }
+
   size_t available = readerCursor - writerCursor - 1;
 
   if (writerCursor >= readerCursor)
@@ -191,66 +556,517 @@ size_t SPMCBackPressure<Mutex, MaxNoDropConsumers>::write_available (
   return available;
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-size_t SPMCBackPressure<Mutex, MaxNoDropConsumers>::write_available ()
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  write_available ()
+{
+  /*
+   * Rescan every consumer group
+   */
+  return write_available (std::numeric_limits<size_t>::max ());
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  write_available (size_t size)
 {
-  uint8_t maxConsumers = m_maxConsumers.load (std::memory_order_relaxed);
+  if (m_groupCount == 0)
+  {
+    return slowest_consumer_write_available ();
+  }
 
-  if (SPMC_EXPECT_TRUE (maxConsumers > 0))
+  size_t minAvailable = PowerOf2Capacity ? m_maxSize : m_maxSize - 1;
+  /*
+   * With many consumers only rescan the groups whose slowest consumer, when
+   * last scanned, leaves less than size bytes. A group without a consumer when
+   * last scanned is rescanned as a consumer may since have joined it.
+   */
+  for (size_t group = 0; group < m_groupCount; ++group)
   {
+    auto &slot = m_groupSlots[group];
+
+    size_t cursor = slot.cursor.load (std::memory_order_relaxed);
+
+    if (!is_valid_cursor (cursor) || write_available (cursor, m_claimed) < size)
+    {
+      cursor = slowest_group_cursor (group);
+
+      slot.cursor.store (cursor, std::memory_order_relaxed);
+    }
+
+    if (is_valid_cursor (cursor))
+    {
+      minAvailable = std::min (minAvailable,
+                               write_available (cursor, m_claimed));
+    }
+  }
+
+  return minAvailable;
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  slowest_consumer_write_available () const
+{
+  size_t minAvailable = PowerOf2Capacity ? m_maxSize : m_maxSize - 1;
+
+  for_each_consumer ([this, &minAvailable] (uint8_t index) {
+
+    size_t cursor = m_consumerSlots[index].cursor.load (
+                                                  std::memory_order_acquire);
     /*
-     * Get the bytes consumed by the slowest consumer.
+     * A slot is claimed before its consumer publishes a cursor
      */
-    uint8_t consumerCount = 0;
+    if (is_valid_cursor (cursor))
+    {
+      minAvailable = std::min (minAvailable,
+                               write_available (cursor, m_claimed));
+    }
+  });
+
+  return minAvailable;
+}
 
-    size_t minAvailable = Cursor::UnInitialised;
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+template <class Function>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  for_each_consumer (Function &&function) const
+{
+  for (size_t word = 0; word < m_bitmapWords; ++word)
+  {
+    uint64_t bits = m_slotBitmap[word].load (std::memory_order_acquire);
 
-    for (uint8_t i = m_consumerIndex; consumerCount < MaxNoDropConsumers; ++i)
+    while (bits != 0)
     {
+      function (static_cast<uint8_t> (word * 64 + __builtin_ctzll (bits)));
       /*
-       * Rotate the order of the client first served data for improved fairness
+       * Clear the lowest set bit
        */
-      size_t consumerCursor = m_consumerIndexes[MODULUS (i, MaxNoDropConsumers)];
+      bits &= bits - 1;
+    }
+  }
+}
 
-      if (is_valid_cursor (consumerCursor))
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  consumer_count () const
+{
+  size_t count = 0;
+
+  for (size_t word = 0; word < m_bitmapWords; ++word)
+  {
+    count += __builtin_popcountll (m_slotBitmap[word].load (
+                                                  std::memory_order_relaxed));
+  }
+
+  return count;
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  claim_slot (uint8_t &index)
+{
+  for (size_t word = 0; word < m_bitmapWords; ++word)
+  {
+    /*
+     * Bits of the word which map to consumer slots
+     */
+    size_t   slots = m_consumerCapacity - word * 64;
+    uint64_t mask  = (slots >= 64) ? ~uint64_t (0) : (uint64_t (1) << slots) - 1;
+
+    uint64_t bits = m_slotBitmap[word].load (std::memory_order_relaxed);
+
+    uint64_t free = ~bits & mask;
+    /*
+     * Each failed attempt finds another bit set, so the loop is bounded by the
+     * number of slots in the word
+     */
+    while (free != 0)
+    {
+      uint64_t bit = free & (~free + 1);
+
+      bits = m_slotBitmap[word].fetch_or (bit, std::memory_order_acq_rel);
+
+      if ((bits & bit) == 0)
       {
-        minAvailable = std::min (minAvailable,
-                                 write_available (consumerCursor, m_claimed));
+        index = static_cast<uint8_t> (word * 64 + __builtin_ctzll (bit));
+
+        return true;
+      }
+
+      free = ~bits & mask;
+    }
+  }
+
+  return false;
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  release_slot (uint8_t index, uint64_t owner)
+{
+  auto &slot = m_consumerSlots[index];
+
+  if (!slot.owner.compare_exchange_strong (owner, 0, std::memory_order_acq_rel,
+                                           std::memory_order_relaxed))
+  {
+    return false;
+  }
+
+  slot.cursor.store (Cursor::UnInitialised, std::memory_order_release);
+  slot.pid.store (0, std::memory_order_relaxed);
+  slot.stalledSince.store (0, std::memory_order_relaxed);
+  /*
+   * The slot may be claimed again once its bit is cleared
+   */
+  m_slotBitmap[index / 64].fetch_and (~(uint64_t (1) << (index % 64)),
+                                      std::memory_order_release);
+  return true;
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  reclaim_slots ()
+{
+  bool reclaimed = false;
+
+  for_each_consumer ([this, &reclaimed] (uint8_t index) {
+
+    auto &slot = m_consumerSlots[index];
+
+    uint64_t owner = slot.owner.load (std::memory_order_acquire);
+    int32_t  pid   = slot.pid.load (std::memory_order_relaxed);
+
+    if (owner != 0 && pid > 0 && ::kill (pid, 0) != 0 && errno == ESRCH &&
+        release_slot (index, owner))
+    {
+      BOOST_LOG_TRIVIAL (warning) << "Reclaimed consumer index="
+                                  << std::to_string (index) << " pid=" << pid
+                                  << ": process has exited";
+      reclaimed = true;
+    }
+  });
+  /*
+   * A consumer which exited while sleeping also leaves the doorbell armed
+   */
+  if (reclaimed)
+  {
+    m_ringDoorbell->reclaim ();
+  }
+
+  return reclaimed;
+}
 
-        if (minAvailable != Cursor::UnInitialised)
-        {
-          ++consumerCount;
-        }
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+size_t SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  slowest_group_cursor (size_t group) const
+{
+  const size_t first = group * CONSUMER_GROUP_SIZE;
+  const size_t count = std::min<size_t> (CONSUMER_GROUP_SIZE,
+                                         m_consumerCapacity - first);
+  /*
+   * Groups do not straddle the words of the slot bitmap
+   */
+  static_assert (64 % CONSUMER_GROUP_SIZE == 0,
+                 "Consumer groups must not straddle bitmap words");
+
+  uint64_t mask = ((uint64_t (1) << count) - 1) << (first % 64);
+
+  uint64_t bits = m_slotBitmap[first / 64].load (std::memory_order_acquire)
+                & mask;
+
+  size_t slowest      = Cursor::UnInitialised;
+  size_t minAvailable = 0;
+
+  while (bits != 0)
+  {
+    size_t index = (first / 64) * 64 + __builtin_ctzll (bits);
+
+    size_t cursor = m_consumerSlots[index].cursor.load (
+                                                  std::memory_order_acquire);
+    /*
+     * A slot is claimed before its consumer publishes a cursor
+     */
+    if (is_valid_cursor (cursor))
+    {
+      size_t available = write_available (cursor, m_claimed);
+
+      if (!is_valid_cursor (slowest) || available < minAvailable)
+      {
+        slowest      = cursor;
+        minAvailable = available;
       }
+    }
+
+    bits &= bits - 1;
+  }
+
+  return slowest;
+}
 
-      if (consumerCount == maxConsumers ||
-          m_maxConsumers.load (std::memory_order_relaxed) == 0)
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  update_consumer_state (ConsumerState &consumer)
+{
+  if (consumer.mode () == ConsumerMode::Drop)
+  {
+    /*
+     * The cursor of a Drop consumer is advanced as data is consumed
+     */
+    consumer.position (consumer.position ()
+                       + consumer.data_range ().consumed ());
+    /*
+     * A replaying consumer which has caught up continues from its back-pressure
+     * slot, which references the same position
+     */
+    if (SPMC_EXPECT_FALSE (consumer.replaying ())
+        && consumer.position () >= consumer.replay_end ())
+    {
+      consumer.end_replay ();
+      /*
+       * The producer may have evicted the consumer while it was replaying
+       */
+      if (lost_slot (consumer))
       {
-        break;
+        consumer.evict ();
       }
     }
+
+    return;
+  }
+
+  auto &slot = m_consumerSlots[consumer.index ()];
+  /*
+   * The slot is local to the consumer unless the producer has evicted it
+   */
+  if (SPMC_EXPECT_FALSE (lost_slot (consumer)))
+  {
+    demote (consumer);
+
+    return;
+  }
+  /*
+   * Avoid invalidating the producer's copy of the slot if nothing was consumed
+   */
+  if (consumer.data_range ().consumed () == 0)
+  {
+    return;
+  }
+  /*
+   * Release the consumed data to the producer once it has been read. The
+   * exchange fails if the producer evicts the consumer concurrently.
+   */
+  size_t expected = cursor_at (consumer.position ());
+
+  size_t cursor = advance_cursor (expected, consumer.data_range ().consumed ());
+
+  if (SPMC_EXPECT_FALSE (!slot.cursor.compare_exchange_strong (expected,
+                            cursor, std::memory_order_release,
+                            std::memory_order_relaxed)))
+  {
+    demote (consumer);
+
+    return;
+  }
+
+  consumer.cursor (cursor);
+
+  consumer.position (consumer.position () + consumer.data_range ().consumed ());
+  /*
+   * Only the consumer owning the slot writes its counters
+   */
+  slot.consumedMessages.store (slot.consumedMessages.load (
+                                  std::memory_order_relaxed)
+                                + consumer.publish_messages (),
+                               std::memory_order_relaxed);
+
+  slot.consumedBytes.store (slot.consumedBytes.load (std::memory_order_relaxed)
+                             + consumer.data_range ().consumed (),
+                            std::memory_order_relaxed);
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  metrics (QueueMetrics &metrics) const
+{
+  metrics.committed       = committed_total ();
+  metrics.committedCursor = cursor_at (metrics.committed);
+  metrics.published       = m_metrics.published.load (std::memory_order_relaxed);
+  metrics.stalls          = m_metrics.stalls.load (std::memory_order_relaxed);
+  metrics.dropped         = m_metrics.dropped.load (std::memory_order_relaxed);
+  metrics.evictions       = m_evictions.load (std::memory_order_relaxed);
+
+  metrics.consumers.clear ();
+
+  for_each_consumer ([this, &metrics] (uint8_t i) {
+
+    auto &slot = m_consumerSlots[i];
+
+    size_t cursor = slot.cursor.load (std::memory_order_acquire);
+
+    if (!is_valid_cursor (cursor))
+    {
+      return;
+    }
     /*
-     * Update consumer servicing order after each data push
+     * The cursor of a NoDrop consumer is never more than the capacity behind
+     * the committed data loaded after it
      */
-    m_consumerIndex = ((m_consumerIndex + 1)
-                          < m_maxConsumers.load (std::memory_order_relaxed))
-                    ? m_consumerIndex + 1 : 0;
+    uint64_t committed = committed_total ();
+
+    QueueMetrics::Consumer consumer;
+    consumer.index         = i;
+    consumer.pid           = slot.pid.load (std::memory_order_relaxed);
+    consumer.cursor        = cursor;
+    consumer.consumed      = slot.consumedMessages.load (
+                                                  std::memory_order_relaxed);
+    consumer.consumedBytes = slot.consumedBytes.load (std::memory_order_relaxed);
+    consumer.lag           = read_available (cursor, cursor_at (committed));
+
+    metrics.consumers.push_back (consumer);
+  });
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  lost_slot (const ConsumerState &consumer) const
+{
+  return (m_consumerSlots[consumer.index ()].owner.load (
+                          std::memory_order_relaxed) != consumer.registration ());
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+void SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  demote (ConsumerState &consumer) const
+{
+  uint64_t position = consumer.position () + consumer.data_range ().consumed ();
+
+  consumer.evict ();
+
+  consumer.position (position);
 
-    return minAvailable;
+  consumer.cursor (cursor_at (position));
+
+  consumer.data_range ().read_available (0);
+
+  BOOST_LOG_TRIVIAL (warning) << "Consumer index="
+                              << std::to_string (consumer.index ())
+                              << " was evicted by the producer and continues "
+                              << "as a message dropping consumer";
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  evict_stalled_consumers (size_t size, int64_t now)
+{
+  if (now < m_nextLivenessCheck)
+  {
+    return false;
   }
 
-  return m_maxSize - 1;
+  m_nextLivenessCheck = now + Nanoseconds (CONSUMER_LIVENESS_INTERVAL).count ();
+
+  const int64_t lease = m_lease.load (std::memory_order_relaxed);
+
+  const int64_t maxBlocked = m_maxBlocked.load (std::memory_order_relaxed);
+
+  bool evicted = false;
+
+  for_each_consumer ([&] (uint8_t i) {
+
+    auto &slot = m_consumerSlots[i];
+
+    size_t cursor = slot.cursor.load (std::memory_order_acquire);
+    /*
+     * Only consumers which block the producer are checked
+     */
+    if (!is_valid_cursor (cursor) || write_available (cursor, m_claimed) >= size)
+    {
+      return;
+    }
+
+    int32_t pid = slot.pid.load (std::memory_order_relaxed);
+
+    if (pid > 0 && ::kill (pid, 0) != 0 && errno == ESRCH)
+    {
+      evicted |= evict_consumer (i, cursor, "process has exited");
+
+      m_ringDoorbell->reclaim ();
+    }
+    else if (maxBlocked > 0 && now - m_blockedSince > maxBlocked)
+    {
+      evicted |= evict_consumer (i, cursor, "producer blocked beyond lag policy");
+    }
+    else if (lease > 0)
+    {
+      if (slot.stalledCursor.load (std::memory_order_relaxed) != cursor ||
+          slot.stalledSince.load (std::memory_order_relaxed) == 0)
+      {
+        slot.stalledCursor.store (cursor, std::memory_order_relaxed);
+        slot.stalledSince.store (now, std::memory_order_relaxed);
+      }
+      else if (now - slot.stalledSince.load (std::memory_order_relaxed) > lease)
+      {
+        evicted |= evict_consumer (i, cursor, "consumer lease expired");
+      }
+    }
+  });
+
+  return evicted;
 }
 
-template<class Mutex, uint8_t MaxNoDropConsumers>
-void SPMCBackPressure<Mutex, MaxNoDropConsumers>::update_consumer_state (
-  ConsumerState &consumer)
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  demote_lagging_consumers (uint64_t maxLag)
 {
-  auto &cursor = m_consumerIndexes[consumer.index ()];
+  bool demoted = false;
 
-  cursor = advance_cursor (cursor, consumer.data_range ().consumed ());
+  for_each_consumer ([this, &demoted, maxLag] (uint8_t i) {
 
-  consumer.cursor (cursor);
+    size_t cursor = m_consumerSlots[i].cursor.load (std::memory_order_acquire);
+
+    if (is_valid_cursor (cursor) && read_available (cursor, m_claimed) > maxLag)
+    {
+      demoted |= evict_consumer (i, cursor, "lag exceeded lag policy");
+    }
+  });
+
+  return demoted;
+}
+
+template<uint8_t MaxNoDropConsumers, bool PowerOf2Capacity>
+bool SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>::
+  evict_consumer (uint8_t index, size_t cursor, const char *reason)
+{
+  auto &slot = m_consumerSlots[index];
+
+  uint64_t owner = slot.owner.load (std::memory_order_acquire);
+  int32_t  pid   = slot.pid.load (std::memory_order_relaxed);
+  /*
+   * The consumer may have advanced or unregistered since its cursor was loaded.
+   * Once the exchange succeeds the consumer can no longer publish its cursor.
+   */
+  if (owner == 0 ||
+      !slot.cursor.compare_exchange_strong (cursor, Cursor::UnInitialised,
+                                            std::memory_order_acq_rel))
+  {
+    return false;
+  }
+  /*
+   * The consumer may be unregistering concurrently
+   */
+  if (!release_slot (index, owner))
+  {
+    return false;
+  }
+
+  uint64_t evictions = m_evictions.fetch_add (1, std::memory_order_relaxed) + 1;
+
+  BOOST_LOG_TRIVIAL (warning) << "Evicted consumer index="
+                              << std::to_string (index) << " pid=" << pid
+                              << ": " << reason << " (evictions="
+                              << evictions << ")";
+  return true;
 }
 
 } // namespace detail {
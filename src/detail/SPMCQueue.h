@@ -1,15 +1,16 @@
 #ifndef OLIVE_DETAIL_SPMC_QUEUE_H
 #define OLIVE_DETAIL_SPMC_QUEUE_H
 
+#include "Chrono.h"
 #include "Logger.h"
+#include "detail/Pages.h"
 #include "detail/SharedMemory.h"
 #include "detail/SPMCBackPressure.h"
 
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
 
+#include <array>
 #include <atomic>
-#include <mutex>
 #include <type_traits>
 #include <vector>
 
@@ -48,7 +49,8 @@ namespace detail {
  * a producer and multiple consumers.
  */
 template <typename Allocator,
-          uint8_t MaxNoDropConsumers = MAX_NO_DROP_CONSUMERS_DEFAULT>
+          uint8_t MaxNoDropConsumers = MAX_NO_DROP_CONSUMERS_DEFAULT,
+          bool PowerOf2Capacity = false>
 class SPMCQueue : private Allocator
 {
 private:
@@ -56,26 +58,29 @@ private:
   SPMCQueue () = delete;
   SPMCQueue (const SPMCQueue &) = delete;
 
-  typedef SPMCBackPressure<std::mutex, MaxNoDropConsumers>
-          InprocessBackPressure;
-
-  typedef SPMCBackPressure<SharedMemoryMutex, MaxNoDropConsumers>
-          MultiProcessBackPressure;
-
 public:
+  /*
+   * Number of messages between entries of the sequence number index, which
+   * must be a power of two
+   */
+  static constexpr uint64_t INDEX_INTERVAL = 64;
+  /*
+   * Number of entries in the sequence number index, which must be a power of
+   * two
+   */
+  static constexpr size_t INDEX_ENTRIES = 64;
 
-  typedef typename std::conditional<
-    std::is_same<std::allocator<typename Allocator::value_type>,
-                                Allocator>::value,
-          InprocessBackPressure,
-          MultiProcessBackPressure>::type BackPressureType;
+  typedef SPMCBackPressure<MaxNoDropConsumers, PowerOf2Capacity>
+          BackPressureType;
 
-public:
   /*
    * Construct an SPMCQueue for use in-process by a single producer thread and
    * multiple consumer threads.
+   *
+   * The page options are applied to the queue buffer before it is initialised.
    */
-  SPMCQueue (size_t capacity);
+  SPMCQueue (size_t capacity, uint8_t maxConsumers = MaxNoDropConsumers,
+             const PageOptions &pages = PageOptions ());
 
   /*
    * Construct an SPMCQueue for use with a single producer and multiple
@@ -84,11 +89,28 @@ public:
    * Use one of two allocator types, either the SharedMemory::Allocator if
    * communicating between processes or the std::allocator for communicating
    * between threads.
+   *
+   * Up to maxConsumers NoDrop consumers can be registered with the queue.
    */
-  SPMCQueue (size_t capacity, const Allocator &allocator);
+  SPMCQueue (size_t capacity, const Allocator &allocator,
+             uint8_t maxConsumers = MaxNoDropConsumers);
+
+  /*
+   * Construct an SPMCQueue whose consumer slots and buffer are placed by the
+   * caller, at the offsets given by the QueueLayout of a shared memory block.
+   *
+   * The queue does not own the memory and must not be destroyed.
+   */
+  SPMCQueue (size_t capacity, const Allocator &allocator, uint8_t maxConsumers,
+             uint8_t *slotMemory, uint8_t *buffer);
 
   ~SPMCQueue ();
 
+  /*
+   * Return the size of the buffer of a queue with a capacity in bytes
+   */
+  static size_t buffer_size (size_t capacity);
+
   /*
    * Return a pointer to the internal buffer shared between either processes
    * or threads
@@ -108,6 +130,54 @@ public:
    */
   size_t capacity () const;
 
+  /*
+   * Return the timestamp base, in nanoseconds since the clock epoch, near which
+   * the truncated timestamps of compact headers are restored
+   */
+  int64_t timestamp_base () const
+  {
+    return m_timestampBase.load (std::memory_order_relaxed);
+  }
+
+  /*
+   * Move the timestamp base to a timestamp pushed by the producer
+   */
+  void timestamp_base (int64_t timestamp)
+  {
+    m_timestampBase.store (timestamp, std::memory_order_relaxed);
+  }
+
+  /*
+   * Return the position of the oldest message retained in the queue, the total
+   * number of bytes produced before it
+   */
+  uint64_t oldest_position () const;
+
+  /*
+   * Record the position of a message pushed to the queue in the sequence
+   * number index, if its sequence number is a multiple of INDEX_INTERVAL.
+   *
+   * Called by the producer after the message is published.
+   */
+  void index (uint64_t seqNum, uint64_t position);
+
+  /*
+   * Return in position the position recorded in the index for the message with
+   * the sequence number seqNum rounded down to a multiple of INDEX_INTERVAL.
+   *
+   * Returns false if there is no entry. An entry may have been replaced by a
+   * later message or reference data which has been overwritten, so it must be
+   * validated against the message header.
+   */
+  bool indexed_position (uint64_t seqNum, uint64_t &position) const;
+
+  /*
+   * Return the sequence number of the latest message recorded in the sequence
+   * number index, from which consumers restore the sequence numbers truncated
+   * by compact headers
+   */
+  uint64_t sequence_number_base () const;
+
 private:
   /*
    * Copy a POD type to the end of the queue.
@@ -136,7 +206,8 @@ public:
 
   BackPressureType &back_pressure () { return m_backPressure; }
   /*
-   * Push one or more data items to the queue. The data is published for
+   * Push a message of one or more data items to the queue, framed by a header
+   * of type HeaderType which is the first item. The data is published for
    * consuming once all the data items have been copied to the queue.
    *
    * Space is acquired/released once for all head..tail objects.
@@ -144,9 +215,29 @@ public:
    * Currently supports POD types and classes with methods data () and size ()
    * in bytes, for example std::vector<uint8_t>
    */
-  template<typename Head, typename...Tail>
+  template<typename HeaderType, typename Head, typename...Tail>
   bool push_variadic (const Head &head, const Tail&...tail);
 
+  /*
+   * Push count header and data pairs to the queue back to back.
+   *
+   * Space is acquired once for the whole batch and the batch is published to
+   * the consumers with a single release. If the batch does not fit in the
+   * queue nothing is pushed and false is returned.
+   */
+  template<typename Header, typename Data>
+  bool push_batch (const Header *headers, const Data *data, size_t count);
+
+  /*
+   * Acquire space for size bytes of messages framed by headers of type
+   * HeaderType, then advance the oldest retained message past the messages
+   * which the space overwrites.
+   *
+   * Returns false if the queue is full, in which case no message is retired.
+   */
+  template <typename HeaderType>
+  bool acquire_space (size_t size);
+
   /*
    * Copy a POD type to the end of the queue.
    *
@@ -170,6 +261,31 @@ public:
              AcquireRelease acquire_release = AcquireRelease::Yes,
              size_t offset = 0);
 
+  /*
+   * Reserve a contiguous region of size bytes in the queue which the producer
+   * can write to directly, avoiding a copy from an intermediate buffer.
+   *
+   * A region is never split over the end of the queue. If there is not enough
+   * space before the end of the queue a padding record is written up to the end
+   * and the region starts after it. Consumers skip padding records so reserve ()
+   * is only suitable for queues of header framed messages.
+   *
+   * The size of a region must be no larger than half the queue capacity.
+   *
+   * Returns nullptr if there is not enough space in the queue. Make the data
+   * written to the region available to consumers by calling commit ().
+   *
+   * HeaderType is the message header format of the queue, used to write the
+   * padding record.
+   */
+  template <typename HeaderType>
+  uint8_t *reserve (size_t size);
+
+  /*
+   * Publish the data written to a region returned by reserve ()
+   */
+  void commit ();
+
   /*
    * Pop a POD type from the queue
    */
@@ -182,11 +298,53 @@ public:
   bool pop (uint8_t *data, size_t size, ConsumerState &consumer);
 
   /*
-   * Return true if the producer has restarted
+   * Copy a POD type from the queue without advancing the consumer
+   */
+  template<typename POD>
+  void peek (POD &pod, const ConsumerState &consumer) const;
+
+  /*
+   * Return a pointer to size bytes of data which start offset bytes after the
+   * consumer cursor, without advancing the consumer.
+   *
+   * The pointer references the queue memory unless the data wraps around the
+   * end of the queue, in which case the data is copied to a buffer local to
+   * the consumer.
+   */
+  const uint8_t *read_pointer (size_t offset, size_t size,
+                               ConsumerState &consumer) const;
+
+  /*
+   * Advance the consumer cursor without copying any data
+   */
+  void skip (size_t size, ConsumerState &consumer) const;
+
+  /*
+   * Return true if the producer has restarted since the consumer registered
    */
   bool producer_restarted (const ConsumerState &consumer) const;
 
+  /*
+   * Start a new producer epoch. Called by a producer which has opened an
+   * existing queue, for example after the producer process restarts.
+   *
+   * Messages retained from the previous epoch are no longer available to
+   * consumers starting from retained data, and consumers registered in an
+   * earlier epoch move to the latest data when they next request data.
+   */
+  void restart_producer ();
+
 private:
+  /*
+   * Advance the oldest retained message past the messages which the size bytes
+   * last acquired overwrite. Called after acquiring space for messages framed
+   * by headers of type HeaderType and before writing to it.
+   *
+   * Only the headers about to be overwritten are read, so the producer does no
+   * work until the queue has wrapped.
+   */
+  template <typename HeaderType>
+  void retire (size_t size);
   /*
    * Copy producer data to the internal queue
    */
@@ -195,9 +353,19 @@ private:
   /*
    * Copy consumer data from the internal queue to a data buffer
    */
-  size_t copy_from_queue (uint8_t *to, size_t size, ConsumerState &consumer);
+  size_t copy_from_queue (uint8_t *to, size_t size,
+                          const ConsumerState &consumer) const;
 
 private:
+  /*
+   * Definition of a pointer to data accessed by either multiple threads or
+   * mulitple processes
+   */
+  typedef typename Allocator::pointer Pointer;
+  /*
+   * Memory holding the consumer slots of the back pressure structure
+   */
+  Pointer m_slotMemory = { nullptr };
   /*
    * Structure used by consumers exert back pressure on the producer
    */
@@ -212,10 +380,10 @@ private:
    */
   const size_t m_capacity = { 0 };
   /*
-   * Definition of a pointer to data accessed by either multiple threads or
-   * mulitple processes
+   * Timestamp base of compact headers, set when the producer starts and moved
+   * by the producer when it pushes a timestamp far from the base
    */
-  typedef typename Allocator::pointer Pointer;
+  std::atomic<int64_t> m_timestampBase = { 0 };
   /*
    * A buffer held in shared or heap memory used by the producer to pass data
    * to the consumers
@@ -235,6 +403,21 @@ private:
    * with shared memory
    */
   LocalPointer m_bufferProducer = { nullptr };
+  /*
+   * Position of the oldest message retained in the queue, read by consumers
+   * starting from retained data
+   */
+  std::atomic<uint64_t> m_oldest = { 0 };
+  /*
+   * Sequence number of the latest message recorded in the index
+   */
+  std::atomic<uint64_t> m_sequenceBase = { 0 };
+  /*
+   * Ring of the positions of every INDEX_INTERVAL-th message, plus one so that
+   * zero marks an empty entry
+   */
+  alignas (CACHE_LINE_SIZE)
+  std::array<std::atomic<uint64_t>, INDEX_ENTRIES> m_index;
 };
 
 } // namespace detail {
@@ -8,27 +8,45 @@
 namespace olive {
 namespace detail {
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-SPMCQueue<Allocator, MaxNoDropConsumers>::SPMCQueue (size_t capacity)
-: m_backPressure (capacity)
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  SPMCQueue (size_t capacity, uint8_t maxConsumers, const PageOptions &pages)
+: m_slotMemory (Allocator::allocate (
+                              BackPressureType::slot_memory_size (maxConsumers)))
+, m_backPressure (capacity, maxConsumers, &*m_slotMemory)
 , m_maxSize (m_backPressure.max_size ())
 , m_capacity (capacity)
+, m_timestampBase (nanoseconds_since_epoch (Clock::now ()))
 , m_buffer (Allocator::allocate (m_maxSize))
 , m_bufferProducer (buffer ())
 {
   CHECK (m_capacity > 0, "Invalid capacity");
   CHECK (m_buffer != nullptr, "Invalid buffer");
+  /*
+   * Huge pages must be requested before the buffer is first touched
+   */
+  prepare_pages (m_bufferProducer, m_maxSize, pages);
 
   std::fill (m_bufferProducer, m_bufferProducer + m_capacity, 0);
+
+  for (auto &entry : m_index)
+  {
+    entry.store (0, std::memory_order_relaxed);
+  }
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-SPMCQueue<Allocator, MaxNoDropConsumers>::SPMCQueue (
-  size_t capacity, const Allocator &allocator)
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::SPMCQueue (
+  size_t capacity, const Allocator &allocator, uint8_t maxConsumers)
 : Allocator  (allocator)
-, m_backPressure (capacity)
+, m_slotMemory (Allocator::allocate (
+                              BackPressureType::slot_memory_size (maxConsumers)))
+, m_backPressure (capacity, maxConsumers, &*m_slotMemory)
 , m_maxSize (m_backPressure.max_size ())
 , m_capacity (capacity)
+, m_timestampBase (nanoseconds_since_epoch (Clock::now ()))
 , m_buffer (Allocator::allocate (m_maxSize))
 , m_bufferProducer (buffer ())
 {
@@ -36,10 +54,41 @@ SPMCQueue<Allocator, MaxNoDropConsumers>::SPMCQueue (
   CHECK (m_buffer != nullptr, "Invalid buffer");
 
   std::fill (m_bufferProducer, m_bufferProducer + m_capacity, 0);
+
+  for (auto &entry : m_index)
+  {
+    entry.store (0, std::memory_order_relaxed);
+  }
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::SPMCQueue (
+  size_t capacity, const Allocator &allocator, uint8_t maxConsumers,
+  uint8_t *slotMemory, uint8_t *buffer)
+: Allocator  (allocator)
+, m_slotMemory (slotMemory)
+, m_backPressure (capacity, maxConsumers, slotMemory)
+, m_maxSize (m_backPressure.max_size ())
+, m_capacity (capacity)
+, m_timestampBase (nanoseconds_since_epoch (Clock::now ()))
+, m_buffer (buffer)
+, m_bufferProducer (buffer)
+{
+  CHECK (m_capacity > 0, "Invalid capacity");
+  CHECK (m_buffer != nullptr, "Invalid buffer");
+
+  std::fill (m_bufferProducer, m_bufferProducer + m_capacity, 0);
+
+  for (auto &entry : m_index)
+  {
+    entry.store (0, std::memory_order_relaxed);
+  }
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-SPMCQueue<Allocator, MaxNoDropConsumers>::~SPMCQueue ()
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::~SPMCQueue ()
 {
   /*
    * This destructor is only invoked by the single process multi-threaded queue
@@ -48,11 +97,27 @@ SPMCQueue<Allocator, MaxNoDropConsumers>::~SPMCQueue ()
    * removed.
    */
   Allocator::deallocate (m_buffer, m_maxSize);
+
+  Allocator::deallocate (m_slotMemory, BackPressureType::slot_memory_size (
+                                        m_backPressure.consumer_capacity ()));
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  buffer_size (size_t capacity)
+{
+  /*
+   * One byte more than the capacity distinguishes a full queue from an empty
+   * one, unless the cursors are free running
+   */
+  return PowerOf2Capacity ? capacity : capacity + 1;
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-void SPMCQueue<Allocator, MaxNoDropConsumers>::register_consumer (
-  ConsumerState &consumer)
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  register_consumer (ConsumerState &consumer)
 {
   /*
    * Register the consumer with a producer
@@ -69,41 +134,108 @@ void SPMCQueue<Allocator, MaxNoDropConsumers>::register_consumer (
     if (consumer.index () == Index::UnInitialised)
     {
       m_backPressure.register_consumer (consumer);
+      /*
+       * Sequence numbers of messages published before the consumer registered
+       * may have passed 2^32, so extend them relative to the producer
+       */
+      consumer.sequence_number_base (sequence_number_base ());
+
+      if (consumer.start ().origin == StartPosition::Oldest)
+      {
+        m_backPressure.rewind (consumer, oldest_position ());
+      }
     }
   }
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-void SPMCQueue<Allocator, MaxNoDropConsumers>::unregister_consumer (
-  const ConsumerState &consumer)
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  unregister_consumer (const ConsumerState &consumer)
 {
   m_backPressure.unregister_consumer (consumer);
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-uint8_t *SPMCQueue<Allocator, MaxNoDropConsumers>::buffer () const
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+uint8_t *SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  buffer () const
 {
   return reinterpret_cast<uint8_t*> (&*m_buffer);
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-size_t SPMCQueue<Allocator, MaxNoDropConsumers>::capacity () const
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  capacity () const
 {
   return m_capacity;
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-size_t SPMCQueue<Allocator, MaxNoDropConsumers>::read_available (
-  const ConsumerState &consumer) const
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+uint64_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  oldest_position () const
+{
+  return m_oldest.load (std::memory_order_acquire);
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::index (
+  uint64_t seqNum, uint64_t position)
+{
+  if (SPMC_EXPECT_TRUE (MODULUS_POWER_OF_2 (seqNum, INDEX_INTERVAL) != 0))
+  {
+    return;
+  }
+
+  m_index[MODULUS_POWER_OF_2 (seqNum / INDEX_INTERVAL, INDEX_ENTRIES)].store (
+                                      position + 1, std::memory_order_release);
+
+  m_sequenceBase.store (seqNum, std::memory_order_relaxed);
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  indexed_position (uint64_t seqNum, uint64_t &position) const
+{
+  uint64_t entry = m_index[MODULUS_POWER_OF_2 (seqNum / INDEX_INTERVAL,
+                                               INDEX_ENTRIES)].load (
+                                                  std::memory_order_acquire);
+  if (entry == 0)
+  {
+    return false;
+  }
+
+  position = entry - 1;
+
+  return true;
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+uint64_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  sequence_number_base () const
+{
+  return m_sequenceBase.load (std::memory_order_relaxed);
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  read_available (const ConsumerState &consumer) const
 {
   return m_backPressure.read_available (consumer);
 }
 
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
 template <typename T>
-constexpr size_t SPMCQueue<Allocator, MaxNoDropConsumers>::push_variadic_item (
-  const T &pod,
+constexpr size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  push_variadic_item (const T &pod,
   size_t offset)
 {
   static_assert (std::is_trivially_copyable<T>::value,
@@ -113,22 +245,29 @@ constexpr size_t SPMCQueue<Allocator, MaxNoDropConsumers>::push_variadic_item (
                AcquireRelease::No, offset);
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-size_t SPMCQueue<Allocator, MaxNoDropConsumers>::push_variadic_item (
-  const std::vector<uint8_t> &data,
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  push_variadic_item (const std::vector<uint8_t> &data,
   size_t offset)
 {
   return push (data.data (), data.size (), AcquireRelease::No, offset);
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-template<typename Head, typename...Tail>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::push_variadic (
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+template<typename HeaderType, typename Head, typename...Tail>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::push_variadic (
   const Head &head, const Tail&...tail)
 {
-  if (m_backPressure.acquire_space (get_size (head, tail...)))
+  if (acquire_space<HeaderType> (get_size (head, tail...)))
   {
-    push_variadic_item (tail..., push_variadic_item (head));
+    /*
+     * The offset past the last item is not read
+     */
+    [[maybe_unused]] size_t offset = push_variadic_item (head);
+
+    ((offset += push_variadic_item (tail, offset)), ...);
 
     m_backPressure.release_space ();
 
@@ -138,9 +277,108 @@ bool SPMCQueue<Allocator, MaxNoDropConsumers>::push_variadic (
   return false;
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+template<typename Header, typename Data>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::push_batch (
+  const Header *headers, const Data *data, size_t count)
+{
+  size_t size = 0;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    size += get_size (headers[i], data[i]);
+  }
+
+  if (!acquire_space<Header> (size))
+  {
+    return false;
+  }
+
+  size_t offset = 0;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    offset += push_variadic_item (headers[i], offset);
+    offset += push_variadic_item (data[i], offset);
+  }
+
+  m_backPressure.release_space ();
+
+  return true;
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+template <typename HeaderType>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  acquire_space (size_t size)
+{
+  if (!m_backPressure.acquire_space (size))
+  {
+    return false;
+  }
+
+  retire<HeaderType> (size);
+
+  return true;
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+template <typename HeaderType>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::retire (
+  size_t size)
+{
+  /*
+   * Total claimed before the space just acquired, up to which messages have
+   * been written
+   */
+  uint64_t claimed = m_backPressure.claimed_total () - size;
+  uint64_t oldest  = m_oldest.load (std::memory_order_relaxed);
+  /*
+   * A byte at a position is overwritten once more than m_maxSize bytes after
+   * it have been claimed
+   */
+  if (SPMC_EXPECT_TRUE (claimed + size <= oldest + m_maxSize))
+  {
+    return;
+  }
+
+  HeaderType header;
+
+  uint8_t *to = reinterpret_cast<uint8_t*> (&header);
+
+  while (oldest < claimed && claimed + size > oldest + m_maxSize)
+  {
+    size_t readerCursor = m_backPressure.index (
+                                          m_backPressure.cursor_at (oldest));
+
+    size_t spaceToEnd = m_maxSize - readerCursor;
+
+    if (SPMC_EXPECT_TRUE (sizeof (HeaderType) <= spaceToEnd))
+    {
+      std::memcpy (to, m_bufferProducer + readerCursor, sizeof (HeaderType));
+    }
+    else
+    {
+      std::memcpy (to, m_bufferProducer + readerCursor, spaceToEnd);
+      std::memcpy (to + spaceToEnd, m_bufferProducer,
+                   sizeof (HeaderType) - spaceToEnd);
+    }
+
+    oldest += sizeof (HeaderType) + header.size;
+  }
+  /*
+   * Publish the new oldest message before its predecessors are overwritten
+   */
+  m_oldest.store (std::min (oldest, claimed), std::memory_order_release);
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
 template <typename POD>
-size_t SPMCQueue<Allocator, MaxNoDropConsumers>::push (
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::push (
   const POD &pod,
   AcquireRelease acquire_release,
   size_t offset)
@@ -152,8 +390,9 @@ size_t SPMCQueue<Allocator, MaxNoDropConsumers>::push (
                acquire_release, offset);
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-size_t SPMCQueue<Allocator, MaxNoDropConsumers>::push (
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::push (
   const uint8_t *data,
   size_t size,
   AcquireRelease acquire_release,
@@ -189,16 +428,75 @@ size_t SPMCQueue<Allocator, MaxNoDropConsumers>::push (
   return size;
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+template <typename HeaderType>
+uint8_t *SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  reserve (size_t size)
+{
+  /*
+   * Padding may consume up to size - 1 bytes, so a region larger than half of
+   * the queue could never be acquired
+   */
+  assert (size <= (m_maxSize / 2));
+
+  size_t writerCursor = m_backPressure.index (
+                                            m_backPressure.committed_cursor ());
+
+  size_t spaceToEnd = m_maxSize - writerCursor;
+
+  if (SPMC_EXPECT_TRUE (size <= spaceToEnd))
+  {
+    if (!acquire_space<HeaderType> (size))
+    {
+      return nullptr;
+    }
+
+    return m_bufferProducer + writerCursor;
+  }
+  /*
+   * Pad the queue up to the end of the buffer. If there is less space than a
+   * header before the end of the buffer the padding header wraps and the
+   * reserved region starts directly after it.
+   */
+  size_t padding = std::max (spaceToEnd, sizeof (HeaderType));
+
+  if (!acquire_space<HeaderType> (padding + size))
+  {
+    return nullptr;
+  }
+
+  HeaderType header;
+  header.type = PADDING_MESSAGE_TYPE;
+  header.size = padding - sizeof (HeaderType);
+
+  copy_to_queue (reinterpret_cast<const uint8_t*> (&header), m_bufferProducer,
+                 sizeof (HeaderType));
+
+  writerCursor = m_backPressure.advance_cursor (writerCursor, padding);
+
+  return m_bufferProducer + m_backPressure.index (writerCursor);
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::commit ()
+{
+  m_backPressure.release_space ();
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
 template <typename POD>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::pop (
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::pop (
   POD &pod, ConsumerState &consumer)
 {
   return pop (reinterpret_cast<uint8_t*> (&pod), sizeof (POD), consumer);
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-bool SPMCQueue<Allocator, MaxNoDropConsumers>::pop (
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::pop (
   uint8_t* to, size_t size, ConsumerState &consumer)
 {
   /*
@@ -211,8 +509,91 @@ bool SPMCQueue<Allocator, MaxNoDropConsumers>::pop (
   return (size == copied);
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-void SPMCQueue<Allocator, MaxNoDropConsumers>::copy_to_queue (
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+template <typename POD>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::peek (
+  POD &pod, const ConsumerState &consumer) const
+{
+  copy_from_queue (reinterpret_cast<uint8_t*> (&pod), sizeof (POD), consumer);
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+const uint8_t *SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  read_pointer (size_t offset, size_t size, ConsumerState &consumer) const
+{
+  size_t readerCursor = m_backPressure.advance_cursor (consumer.cursor (),
+                                                       offset);
+
+  readerCursor = m_backPressure.index (readerCursor);
+
+  if (SPMC_EXPECT_TRUE (readerCursor + size <= m_maxSize))
+  {
+    return consumer.queue_ptr () + readerCursor;
+  }
+  /*
+   * Data which wraps around the end of the queue is copied to be contiguous
+   */
+  const size_t spaceToEnd = m_maxSize - readerCursor;
+
+  auto &buffer = consumer.wrap_buffer ();
+
+  buffer.resize (size);
+
+  std::memcpy (buffer.data (), consumer.queue_ptr () + readerCursor, spaceToEnd);
+  std::memcpy (buffer.data () + spaceToEnd, consumer.queue_ptr (),
+               size - spaceToEnd);
+
+  return buffer.data ();
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::skip (
+  size_t size, ConsumerState &consumer) const
+{
+  consumer.cursor (m_backPressure.advance_cursor (consumer.cursor (), size));
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+bool SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  producer_restarted (const ConsumerState &consumer) const
+{
+  return (consumer.epoch () != m_backPressure.epoch ());
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  restart_producer ()
+{
+  /*
+   * The shared memory may be mapped at a different address in the new producer
+   */
+  m_bufferProducer = buffer ();
+  /*
+   * Sequence numbers restart with the producer, so retained messages and the
+   * sequence number index of the previous epoch are discarded
+   */
+  for (auto &entry : m_index)
+  {
+    entry.store (0, std::memory_order_relaxed);
+  }
+
+  m_sequenceBase.store (0, std::memory_order_relaxed);
+
+  timestamp_base (nanoseconds_since_epoch (Clock::now ()));
+
+  m_backPressure.restart_producer ();
+
+  m_oldest.store (m_backPressure.claimed_total (), std::memory_order_release);
+}
+
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+void SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::copy_to_queue (
   const uint8_t* from, uint8_t* to, size_t size, size_t offset)
 {
   // TODO hoist out of copy_to_queue method?
@@ -223,6 +604,8 @@ void SPMCQueue<Allocator, MaxNoDropConsumers>::copy_to_queue (
     writerCursor = m_backPressure.advance_cursor (writerCursor, offset);
   }
 
+  writerCursor = m_backPressure.index (writerCursor);
+
   if ((writerCursor + size) < m_maxSize)
   {
     std::memcpy (to + writerCursor, from, size);
@@ -239,14 +622,16 @@ void SPMCQueue<Allocator, MaxNoDropConsumers>::copy_to_queue (
   }
 }
 
-template <typename Allocator, uint8_t MaxNoDropConsumers>
-size_t SPMCQueue<Allocator, MaxNoDropConsumers>::copy_from_queue (
-  uint8_t* to, size_t size, ConsumerState &consumer)
+template <typename Allocator, uint8_t MaxNoDropConsumers,
+          bool PowerOf2Capacity>
+size_t SPMCQueue<Allocator, MaxNoDropConsumers, PowerOf2Capacity>::
+  copy_from_queue (
+    uint8_t* to, size_t size, const ConsumerState &consumer) const
 {
   /*
    * Data availability check must be checked before calling this method
    */
-  size_t readerCursor = consumer.cursor ();
+  size_t readerCursor = m_backPressure.index (consumer.cursor ());
 
   const uint8_t* from = consumer.queue_ptr ();
 
@@ -0,0 +1,204 @@
+#ifndef OLIVE_DETAIL_SPMC_SLOT_QUEUE_H
+#define OLIVE_DETAIL_SPMC_SLOT_QUEUE_H
+
+#include "detail/Pages.h"
+#include "detail/SharedMemory.h"
+#include "detail/SPMCBackPressure.h"
+
+#include <boost/interprocess/offset_ptr.hpp>
+
+#include <atomic>
+#include <type_traits>
+
+namespace olive {
+namespace detail {
+
+/*
+ * A single producer / multiple consumer queue of fixed size slots, each holding
+ * one value of a trivially copyable type T.
+ *
+ * Each slot occupies whole cache lines and holds a sequence stamp written by
+ * the producer. Consumers read the stamp of the slot at their cursor to find
+ * if a value is available, rather than loading the committed cursor of the
+ * producer.
+ *
+ * Back pressure is exerted by NoDrop consumers using SPMCBackPressure with
+ * cursors counting slots. Drop consumers detect a slot being overwritten from
+ * its stamp and skip to the latest value.
+ *
+ * The capacity is the number of slots, which must be a power of two.
+ */
+template <typename T, typename Allocator,
+          uint8_t MaxNoDropConsumers = MAX_NO_DROP_CONSUMERS_DEFAULT>
+class SPMCSlotQueue : private Allocator
+{
+private:
+
+  SPMCSlotQueue () = delete;
+  SPMCSlotQueue (const SPMCSlotQueue &) = delete;
+
+  static_assert (std::is_trivially_copyable<T>::value,
+                 "Slot type must be trivially copyable");
+
+public:
+
+  typedef SPMCBackPressure<MaxNoDropConsumers, true> BackPressureType;
+
+private:
+
+  /*
+   * A cache line aligned slot. The stamp of a slot is odd while the producer
+   * writes the value and even once the value is published.
+   */
+  struct alignas (CACHE_LINE_SIZE) Slot
+  {
+    std::atomic<uint64_t> stamp = { 0 };
+
+    T value;
+  };
+
+public:
+  /*
+   * Construct a slot queue for use in-process by a single producer thread and
+   * multiple consumer threads. The page options are applied to the slots.
+   */
+  SPMCSlotQueue (size_t capacity, uint8_t maxConsumers = MaxNoDropConsumers,
+                 const PageOptions &pages = PageOptions ());
+
+  /*
+   * Construct a slot queue using the allocator, either the
+   * SharedMemory::Allocator or the std::allocator
+   */
+  SPMCSlotQueue (size_t capacity, const Allocator &allocator,
+                 uint8_t maxConsumers = MaxNoDropConsumers);
+
+  /*
+   * Construct a slot queue whose consumer slots and value slots are placed by
+   * the caller, at the offsets given by the QueueLayout of a shared memory
+   * block.
+   *
+   * The queue does not own the memory and must not be destroyed.
+   */
+  SPMCSlotQueue (size_t capacity, const Allocator &allocator,
+                 uint8_t maxConsumers, uint8_t *consumerMemory,
+                 uint8_t *slotMemory);
+
+  ~SPMCSlotQueue ();
+
+  /*
+   * Return the size of memory required for the slots of a queue
+   */
+  static size_t buffer_size (size_t capacity);
+
+  /*
+   * Return the number of slots in the queue
+   */
+  size_t capacity () const { return m_capacity; }
+
+  /*
+   * Register a consumer thread / process
+   */
+  void register_consumer (ConsumerState &consumer);
+
+  /*
+   * Unregister a consumer thread / process
+   */
+  void unregister_consumer (ConsumerState &consumer);
+
+  /*
+   * Copy a value to the next slot and publish it. Returns false if the slot is
+   * still to be consumed by a NoDrop consumer.
+   */
+  bool push (const T &value);
+
+  /*
+   * Copy the value from the slot at the consumer cursor if it is published.
+   *
+   * A NoDrop consumer publishes its progress to the producer in batches, and
+   * whenever it finds the queue empty. A NoDrop consumer overtaken after being
+   * evicted continues as a Drop consumer. A Drop consumer which has been
+   * overtaken by the producer skips to the latest value and returns false.
+   */
+  bool pop (T &value, ConsumerState &consumer);
+
+  /*
+   * Return the number of values available to a consumer
+   */
+  size_t read_available (const ConsumerState &consumer) const;
+
+  BackPressureType &back_pressure () { return m_backPressure; }
+
+private:
+  /*
+   * Construct the slots in the slot memory, applying the page options
+   */
+  void construct_slots (const PageOptions &pages);
+
+  /*
+   * Return the stamp of a slot once the value at a position is published
+   */
+  static constexpr uint64_t published_stamp (uint64_t position)
+  {
+    return 2 * position + 2;
+  }
+
+  /*
+   * Return the position of the next value for a consumer
+   */
+  uint64_t position (const ConsumerState &consumer) const;
+
+  /*
+   * Publish the slots consumed by a NoDrop consumer to the producer
+   */
+  void release_slots (ConsumerState &consumer);
+
+  /*
+   * Pop a value for a Drop consumer
+   */
+  bool pop_drop (T &value, ConsumerState &consumer);
+
+  /*
+   * Demote a NoDrop consumer overtaken by the producer, which can only happen
+   * once the producer has evicted it, and pop a value as a Drop consumer
+   */
+  bool pop_overtaken (T &value, ConsumerState &consumer);
+
+private:
+
+  typedef typename Allocator::pointer Pointer;
+  /*
+   * Memory holding the consumer slots of the back pressure structure
+   */
+  Pointer m_consumerMemory = { nullptr };
+  /*
+   * Structure used by NoDrop consumers to exert back pressure on the producer
+   */
+  alignas (CACHE_LINE_SIZE)
+  BackPressureType m_backPressure;
+  /*
+   * The number of slots in the queue
+   */
+  const size_t m_capacity = { 0 };
+  /*
+   * Number of slots a NoDrop consumer reads before releasing them to the
+   * producer
+   */
+  const size_t m_releaseBatch = { 0 };
+  /*
+   * Memory holding the slots
+   */
+  Pointer m_slotMemory = { nullptr };
+  /*
+   * The cache line aligned slots within the slot memory.
+   *
+   * Offset pointers are valid in every process mapping the shared memory.
+   */
+  boost::interprocess::offset_ptr<Slot> m_slots;
+};
+
+} // namespace detail {
+} // namespace olive {
+
+#include "detail/SPMCSlotQueue.inl"
+
+#endif // OLIVE_DETAIL_SPMC_SLOT_QUEUE_H
@@ -0,0 +1,319 @@
+#include "Assert.h"
+#include "Utils.h"
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <memory>
+
+namespace olive {
+namespace detail {
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  SPMCSlotQueue (size_t capacity, uint8_t maxConsumers,
+                 const PageOptions &pages)
+: m_consumerMemory (Allocator::allocate (
+                              BackPressureType::slot_memory_size (maxConsumers)))
+, m_backPressure (capacity, maxConsumers, &*m_consumerMemory)
+, m_capacity (capacity)
+, m_releaseBatch (std::max<size_t> (capacity / 4, 1))
+, m_slotMemory (Allocator::allocate (buffer_size (capacity)))
+{
+  construct_slots (pages);
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  SPMCSlotQueue (size_t capacity, const Allocator &allocator,
+                 uint8_t maxConsumers)
+: Allocator (allocator)
+, m_consumerMemory (Allocator::allocate (
+                              BackPressureType::slot_memory_size (maxConsumers)))
+, m_backPressure (capacity, maxConsumers, &*m_consumerMemory)
+, m_capacity (capacity)
+, m_releaseBatch (std::max<size_t> (capacity / 4, 1))
+, m_slotMemory (Allocator::allocate (buffer_size (capacity)))
+{
+  construct_slots (PageOptions ());
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  SPMCSlotQueue (size_t capacity, const Allocator &allocator,
+                 uint8_t maxConsumers, uint8_t *consumerMemory,
+                 uint8_t *slotMemory)
+: Allocator (allocator)
+, m_consumerMemory (consumerMemory)
+, m_backPressure (capacity, maxConsumers, consumerMemory)
+, m_capacity (capacity)
+, m_releaseBatch (std::max<size_t> (capacity / 4, 1))
+, m_slotMemory (slotMemory)
+{
+  construct_slots (PageOptions ());
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::~SPMCSlotQueue ()
+{
+  /*
+   * Only invoked by the single process multi-threaded queue, the interprocess
+   * queue is deallocated when the named shared memory is removed.
+   */
+  Allocator::deallocate (m_slotMemory, buffer_size (m_capacity));
+
+  Allocator::deallocate (m_consumerMemory,
+    BackPressureType::slot_memory_size (m_backPressure.consumer_capacity ()));
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+void SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  construct_slots (const PageOptions &pages)
+{
+  CHECK (m_capacity > 0, "Invalid capacity");
+  CHECK (m_slotMemory != nullptr, "Invalid slot memory");
+
+  void  *ptr   = &*m_slotMemory;
+  size_t space = buffer_size (m_capacity);
+
+  Slot *slots = reinterpret_cast<Slot*> (
+    std::align (alignof (Slot), sizeof (Slot) * m_capacity, ptr, space));
+  /*
+   * Huge pages must be requested before the slots are first touched
+   */
+  prepare_pages (slots, sizeof (Slot) * m_capacity, pages);
+
+  for (size_t i = 0; i < m_capacity; ++i)
+  {
+    new (slots + i) Slot ();
+  }
+
+  m_slots = slots;
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+size_t SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  buffer_size (size_t capacity)
+{
+  return sizeof (Slot) * capacity + alignof (Slot);
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+void SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  register_consumer (ConsumerState &consumer)
+{
+  if (consumer.registered ())
+  {
+    return;
+  }
+
+  m_backPressure.register_consumer (consumer);
+  /*
+   * Slots consumed by a NoDrop consumer are counted by the data range until
+   * they are released to the producer
+   */
+  consumer.data_range ().read_available (m_capacity);
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+void SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  unregister_consumer (ConsumerState &consumer)
+{
+  m_backPressure.unregister_consumer (consumer);
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+bool SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::push (const T &value)
+{
+  if (!m_backPressure.acquire_space (1))
+  {
+    return false;
+  }
+  /*
+   * There is a single producer so the committed cursor is the position of the
+   * value being pushed
+   */
+  uint64_t position = m_backPressure.committed_cursor ();
+
+  Slot &slot = m_slots[m_backPressure.index (position)];
+  /*
+   * Mark the slot as being written before overwriting the value, so that a
+   * Drop consumer reading the previous value can detect the overwrite
+   */
+  slot.stamp.store (published_stamp (position) - 1, std::memory_order_relaxed);
+
+  std::atomic_thread_fence (std::memory_order_release);
+
+  slot.value = value;
+
+  slot.stamp.store (published_stamp (position), std::memory_order_release);
+  /*
+   * Publish the committed cursor, used to register consumers, and wake any
+   * blocked consumers
+   */
+  m_backPressure.release_space ();
+
+  m_backPressure.published (1);
+
+  return true;
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+bool SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::pop (
+  T &value, ConsumerState &consumer)
+{
+  if (consumer.mode () == ConsumerMode::Drop)
+  {
+    return pop_drop (value, consumer);
+  }
+
+  uint64_t position = this->position (consumer);
+
+  const Slot &slot = m_slots[m_backPressure.index (position)];
+
+  uint64_t stamp = slot.stamp.load (std::memory_order_acquire);
+
+  if (stamp != published_stamp (position))
+  {
+    if (SPMC_EXPECT_FALSE (stamp > published_stamp (position)))
+    {
+      return pop_overtaken (value, consumer);
+    }
+    /*
+     * Release the slots read so far while the queue is empty, so the producer
+     * is never blocked by slots which have been consumed
+     */
+    release_slots (consumer);
+
+    return false;
+  }
+
+  value = slot.value;
+  /*
+   * The producer may overwrite the slot of an evicted consumer while it is
+   * being copied
+   */
+  std::atomic_thread_fence (std::memory_order_acquire);
+
+  if (SPMC_EXPECT_FALSE (slot.stamp.load (std::memory_order_relaxed) != stamp))
+  {
+    return pop_overtaken (value, consumer);
+  }
+
+  consumer.data_range ().consumed (1);
+  /*
+   * Values missed if the consumer is later evicted are counted from the last
+   * value consumed
+   */
+  consumer.consumed_sequence_number (position + 1);
+
+  if (SPMC_EXPECT_FALSE (consumer.data_range ().consumed () >= m_releaseBatch))
+  {
+    release_slots (consumer);
+  }
+
+  return true;
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+bool SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::pop_drop (
+  T &value, ConsumerState &consumer)
+{
+  uint64_t position = consumer.cursor ();
+
+  const Slot &slot = m_slots[m_backPressure.index (position)];
+
+  uint64_t stamp = slot.stamp.load (std::memory_order_acquire);
+
+  if (stamp < published_stamp (position))
+  {
+    return false;
+  }
+
+  if (SPMC_EXPECT_TRUE (stamp == published_stamp (position)))
+  {
+    value = slot.value;
+    /*
+     * The value is only valid if the producer did not begin overwriting the
+     * slot while it was being copied
+     */
+    std::atomic_thread_fence (std::memory_order_acquire);
+
+    if (SPMC_EXPECT_TRUE (slot.stamp.load (std::memory_order_relaxed) == stamp))
+    {
+      consumer.cursor (position + 1);
+      /*
+       * Values skipped after being overtaken by the producer are counted as
+       * dropped, as by the byte queue
+       */
+      uint64_t dropped = consumer.sequence_number (position + 1);
+
+      if (SPMC_EXPECT_FALSE (dropped > 0))
+      {
+        m_backPressure.dropped (dropped);
+      }
+
+      return true;
+    }
+  }
+  /*
+   * The producer has overtaken the consumer
+   */
+  m_backPressure.resync (consumer);
+
+  return false;
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+bool SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::pop_overtaken (
+  T &value, ConsumerState &consumer)
+{
+  /*
+   * The update demotes a consumer which lost its slot, whether or not it has
+   * consumed values since it last published its progress
+   */
+  m_backPressure.update_consumer_state (consumer);
+
+  if (consumer.mode () != ConsumerMode::Drop)
+  {
+    return false;
+  }
+
+  return pop_drop (value, consumer);
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+size_t SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  read_available (const ConsumerState &consumer) const
+{
+  return m_backPressure.committed_cursor () - position (consumer);
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+uint64_t SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  position (const ConsumerState &consumer) const
+{
+  if (consumer.mode () == ConsumerMode::Drop)
+  {
+    return consumer.cursor ();
+  }
+
+  return consumer.cursor () + consumer.data_range ().consumed ();
+}
+
+template <typename T, typename Allocator, uint8_t MaxNoDropConsumers>
+void SPMCSlotQueue<T, Allocator, MaxNoDropConsumers>::
+  release_slots (ConsumerState &consumer)
+{
+  if (consumer.data_range ().consumed () == 0)
+  {
+    return;
+  }
+
+  m_backPressure.update_consumer_state (consumer);
+
+  consumer.data_range ().read_available (m_capacity);
+}
+
+} // namespace detail {
+} // namespace olive {
@@ -3,7 +3,6 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/thread/tss.hpp>
 
 #include <boost/lockfree/spsc_queue.hpp>
@@ -60,6 +59,12 @@ static constexpr uint8_t HEADER_VERSION = 1;
 
 static constexpr uint8_t STANDARD_MESSAGE_TYPE = 0;
 static constexpr uint8_t WARMUP_MESSAGE_TYPE   = 1;
+/*
+ * Padding records fill the space at the end of the queue which is too small for
+ * a contiguous reserved region. The header size is the number of bytes to skip.
+ */
+static constexpr uint8_t PADDING_MESSAGE_TYPE  =
+                                          std::numeric_limits<uint8_t>::max ();
 
 static constexpr int64_t DEFAULT_TIMESTAMP = std::numeric_limits<int64_t>::min ();
 
@@ -72,6 +77,29 @@ struct Header
   int64_t  timestamp = DEFAULT_TIMESTAMP;
 };
 
+/*
+ * A 16 byte message header, half the size of Header, for queues of small
+ * messages.
+ *
+ * The sequence number holds the low 32 bits of the message sequence number and
+ * the timestamp is a signed 48 bit offset from a base timestamp stored in the
+ * queue. Queues using the compact header convert it to and from a Header when
+ * pushing and popping messages.
+ */
+static constexpr uint8_t COMPACT_HEADER_VERSION = 3;
+
+struct CompactHeader
+{
+  uint8_t  version       = COMPACT_HEADER_VERSION;
+  uint8_t  type          = STANDARD_MESSAGE_TYPE;
+  uint16_t timestampHigh = 0;
+  uint32_t size          = 0;
+  uint32_t seqNum        = 0;
+  uint32_t timestampLow  = 0;
+};
+
+static_assert (sizeof (CompactHeader) == 16, "CompactHeader must be 16 bytes");
+
 /*
  * Reserved index values used by a producer and consumers indicating state
  */
@@ -129,8 +157,6 @@ static constexpr int8_t MAX_NO_DROP_CONSUMERS_DEFAULT = 4;
 
 static constexpr size_t CACHE_LINE_SIZE = BOOST_LOCKFREE_CACHELINE_BYTES;
 
-using SharedMemoryMutex = boost::interprocess::interprocess_mutex;
-
 } // namespace olive
 
 #endif // OLIVE_DETAIL_SHARED_MEMORY_H
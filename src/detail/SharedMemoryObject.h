@@ -0,0 +1,54 @@
+#ifndef OLIVE_DETAIL_SHARED_MEMORY_OBJECT_H
+#define OLIVE_DETAIL_SHARED_MEMORY_OBJECT_H
+
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#include <string>
+
+namespace olive {
+namespace detail {
+
+/*
+ * Named objects constructed by managed_shared_memory are only aligned to the
+ * memory algorithm alignment (8 or 16 bytes) and alignas () specifiers are
+ * ignored. Objects with cache line aligned members may then be accessed using
+ * aligned vector instructions at unaligned addresses, which faults.
+ *
+ * These functions construct a named object inside a byte array which is large
+ * enough to place the object on a boundary satisfying its alignment.
+ */
+
+/*
+ * Find a named object, or construct it from the arguments if not present.
+ *
+ * Finding and constructing is atomic with respect to other processes.
+ */
+template <typename T, typename...Args>
+T *find_or_construct_aligned (boost::interprocess::managed_shared_memory &memory,
+                              const std::string &name,
+                              Args&&...args);
+
+/*
+ * Find a named object constructed using find_or_construct_aligned ().
+ *
+ * Returns nullptr if the object is not present.
+ */
+template <typename T>
+T *find_aligned (boost::interprocess::managed_shared_memory &memory,
+                 const std::string &name);
+
+/*
+ * Return the size of shared memory required by an aligned object
+ */
+template <typename T>
+constexpr size_t aligned_object_size ()
+{
+  return sizeof (T) + alignof (T);
+}
+
+} // namespace detail {
+} // namespace olive {
+
+#include "detail/SharedMemoryObject.inl"
+
+#endif // OLIVE_DETAIL_SHARED_MEMORY_OBJECT_H
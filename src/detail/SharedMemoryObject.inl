@@ -0,0 +1,81 @@
+#include "Assert.h"
+
+#include <memory>
+
+namespace olive {
+namespace detail {
+
+namespace {
+
+/*
+ * Return the address of an object of type T aligned within a byte array.
+ *
+ * Shared memory is mapped on a page boundary in every process so the offset of
+ * the aligned object within the array is the same in every process.
+ */
+template <typename T>
+T *align_object (uint8_t *bytes, size_t size)
+{
+  void  *ptr   = bytes;
+  size_t space = size;
+
+  return reinterpret_cast<T*> (std::align (alignof (T), sizeof (T), ptr, space));
+}
+
+} // namespace {
+
+template <typename T, typename...Args>
+T *find_or_construct_aligned (
+  boost::interprocess::managed_shared_memory &memory,
+  const std::string &name,
+  Args&&...args)
+{
+  T *object = nullptr;
+
+  auto findOrConstruct = [&] () {
+
+    auto found = memory.find<uint8_t> (name.c_str ());
+
+    if (found.first != nullptr)
+    {
+      CHECK_SS (found.second == aligned_object_size<T> (),
+                "Unexpected size of shared memory object: " << name);
+
+      object = align_object<T> (found.first, found.second);
+    }
+    else
+    {
+      uint8_t *bytes = memory.construct<uint8_t> (name.c_str ())
+                                             [aligned_object_size<T> ()] (0);
+
+      object = new (align_object<T> (bytes, aligned_object_size<T> ()))
+                    T (std::forward<Args> (args)...);
+    }
+  };
+  /*
+   * Prevent another process from constructing the same object concurrently
+   */
+  memory.atomic_func (findOrConstruct);
+
+  return object;
+}
+
+template <typename T>
+T *find_aligned (boost::interprocess::managed_shared_memory &memory,
+                 const std::string &name)
+{
+  auto found = memory.find<uint8_t> (name.c_str ());
+
+  if (found.first == nullptr)
+  {
+    return nullptr;
+  }
+
+  CHECK_SS (found.second == aligned_object_size<T> (),
+            "Unexpected size of shared memory object: " << name);
+
+  return align_object<T> (found.first, found.second);
+}
+
+} // namespace detail {
+} // namespace olive {
@@ -0,0 +1,62 @@
+#include "detail/TopicDirectory.h"
+
+#include "Assert.h"
+
+#include <cstring>
+
+namespace olive {
+namespace detail {
+
+void TopicDirectory::add (const std::string &topic)
+{
+  CHECK_SS (!topic.empty () && topic.size () <= MAX_TOPIC_NAME_SIZE,
+            "Invalid topic name size: " << topic.size () << " (maximum: "
+            << MAX_TOPIC_NAME_SIZE << ") topic: " << topic);
+
+  if (contains (topic))
+  {
+    return;
+  }
+
+  size_t count = m_count.load (std::memory_order_relaxed);
+
+  CHECK_SS (count < MAX_TOPICS,
+            "Topic directory is full (" << MAX_TOPICS << " topics)");
+
+  std::strncpy (m_entries[count].name, topic.c_str (), MAX_TOPIC_NAME_SIZE);
+
+  m_count.store (count + 1, std::memory_order_release);
+}
+
+bool TopicDirectory::contains (const std::string &topic) const
+{
+  size_t count = m_count.load (std::memory_order_acquire);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (topic == m_entries[i].name)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::vector<std::string> TopicDirectory::topics () const
+{
+  size_t count = m_count.load (std::memory_order_acquire);
+
+  std::vector<std::string> topics;
+  topics.reserve (count);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    topics.push_back (m_entries[i].name);
+  }
+
+  return topics;
+}
+
+} // namespace detail {
+} // namespace olive {
@@ -0,0 +1,84 @@
+#ifndef OLIVE_DETAIL_TOPIC_DIRECTORY_H
+#define OLIVE_DETAIL_TOPIC_DIRECTORY_H
+
+#include "detail/Doorbell.h"
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace olive {
+namespace detail {
+
+/*
+ * Name of the topic directory object in a shared memory segment
+ */
+static const std::string TOPIC_DIRECTORY_NAME = "topic:directory";
+
+/*
+ * Return the name of the shared memory queue carrying the data for a topic
+ */
+inline
+std::string topic_queue_name (const std::string &topic)
+{
+  return "topic:" + topic + ":queue";
+}
+
+/*
+ * A directory of the topics published to a shared memory segment.
+ *
+ * Each topic has its own SPMC queue in the segment, found by the name returned
+ * from topic_queue_name ().
+ *
+ * Topics are added by a producer and never removed. Consumers may read the
+ * directory while topics are added.
+ */
+class TopicDirectory
+{
+public:
+  static constexpr size_t MAX_TOPICS          = 64;
+  static constexpr size_t MAX_TOPIC_NAME_SIZE = 63;
+
+  /*
+   * Add a topic to the directory, adding an existing topic has no effect.
+   *
+   * Must not be called concurrently with another call to add ().
+   *
+   * Throws if the directory is full or the topic name is invalid.
+   */
+  void add (const std::string &topic);
+  /*
+   * Return true if a topic is in the directory
+   */
+  bool contains (const std::string &topic) const;
+  /*
+   * Return the topics in the order they were added
+   */
+  std::vector<std::string> topics () const;
+  /*
+   * Return the doorbell rung by the producer when data is published to any
+   * topic, shared by the queues of the topics
+   */
+  Doorbell &doorbell () { return m_doorbell; }
+
+private:
+  struct Entry
+  {
+    char name[MAX_TOPIC_NAME_SIZE + 1] = { 0 };
+  };
+
+  /*
+   * Number of valid entries, published after an entry is written
+   */
+  std::atomic<size_t> m_count = { 0 };
+
+  std::array<Entry, MAX_TOPICS> m_entries;
+
+  Doorbell m_doorbell;
+};
+
+} // namespace detail {
+} // namespace olive {
+
+#endif // OLIVE_DETAIL_TOPIC_DIRECTORY_H
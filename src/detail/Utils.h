@@ -11,14 +11,22 @@
     #define SPMC_EXPECT_FALSE(expr)  (SPMC_COND_EXPECT((expr), 0))
 #endif
 
+/*
+ * Hint to the CPU that the caller is in a spin loop
+ */
+#if defined(__x86_64__) || defined(__i386__)
+    #define SPMC_CPU_PAUSE() __builtin_ia32_pause ()
+#else
+    #define SPMC_CPU_PAUSE()
+#endif
+
 /*
  * Macro defining a faster modulus
  */
 #define MODULUS(number, divisor) (number - (divisor * (number / divisor)))
 
 /*
- * Marginally faster if and only if the divisor is a power of 2
- * Probably not worth using as too inflexible
+ * Faster if and only if the divisor is a power of 2
  */
 #define MODULUS_POWER_OF_2(number, divisor) (number & (divisor - 1))
 
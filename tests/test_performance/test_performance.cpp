@@ -4,6 +4,7 @@
 #include "CpuBind.h"
 #include "Logger.h"
 #include "PerformanceStats.h"
+#include "SPMCMultiSource.h"
 #include "SPMCSource.h"
 #include "SPMCSink.h"
 #include "Throttle.h"
@@ -18,6 +19,7 @@
 #include <boost/log/trivial.hpp>
 
 #include <cstdlib>
+#include <ctime>
 #include <deque>
 #include <ext/numeric>
 #include <functional>
@@ -657,7 +659,8 @@ void source_sink_multi_process (
    * Create shared memory in which shared objects can be created
    */
   managed_shared_memory (open_or_create, name.c_str(),
-                         capacity + SharedMemory::BOOK_KEEPING);
+                         SPMCQueue<SharedMemory::Allocator>::memory_size (
+                                                                  capacity));
 
   SPMCSourceProcess source (name, name + ":queue", capacity);
 
@@ -1558,6 +1561,290 @@ BOOST_AUTO_TEST_CASE (PerformanceSPMCQueue)
   BOOST_TEST_MESSAGE (" ");
 }
 
+/*
+ * Producer throughput as the number of NoDrop consumers increases.
+ *
+ * Each consumer exerts back-pressure so the producer must track the slowest
+ * consumer, which should not cost a scan of every consumer cursor per push.
+ */
+BOOST_AUTO_TEST_CASE (ProducerThroughputByConsumerCount)
+{
+  if (getenv ("NOTIMING") != nullptr)
+  {
+    return;
+  }
+
+  BOOST_TEST_MESSAGE ("ProducerThroughputByConsumerCount");
+
+  ScopedLogLevel scoped_log_level (error);
+
+  using QueueType = SPMCQueue<std::allocator<uint8_t>>;
+
+  const size_t capacity = 20480 * sizeof (int64_t);
+
+  for (size_t consumerCount : { 1, 2, 4 })
+  {
+    QueueType queue (capacity);
+
+    std::vector<detail::ConsumerState> consumerStates (consumerCount);
+
+    for (auto &consumerState : consumerStates)
+    {
+      queue.register_consumer (consumerState);
+    }
+
+    std::atomic<bool> stop = { false };
+
+    std::vector<std::thread> consumers;
+
+    for (size_t i = 0; i < consumerCount; ++i)
+    {
+      consumers.emplace_back ([&, i] () {
+
+        bind_to_cpu (static_cast<int> (i + 2));
+
+        Header header;
+        std::vector<uint8_t> data;
+
+        while (!stop)
+        {
+          queue.pop (header, data, consumerStates[i]);
+        }
+      });
+    }
+
+    uint64_t messages_produced = 0;
+
+    Timer timer;
+
+    auto producer = std::thread ([&] () {
+
+      bind_to_cpu (1);
+
+      Header header;
+      header.size = PAYLOAD_SIZE;
+
+      std::vector<uint8_t> payload (PAYLOAD_SIZE);
+      std::iota (std::begin (payload), std::end (payload), 1);
+
+      while (!stop)
+      {
+        header.seqNum = messages_produced + 1;
+
+        if (queue.push (header, payload))
+        {
+          ++messages_produced;
+        }
+      }
+
+      timer.stop ();
+    });
+
+    std::this_thread::sleep_for (get_test_duration ().nanoseconds ());
+
+    stop = true;
+
+    producer.join ();
+
+    for (auto &consumer : consumers)
+    {
+      consumer.join ();
+    }
+
+    for (auto &consumerState : consumerStates)
+    {
+      queue.unregister_consumer (consumerState);
+    }
+
+    BOOST_CHECK (messages_produced > 1e3);
+
+    BOOST_TEST_MESSAGE ("Consumers: " << consumerCount << "\tthroughput: "
+      << throughput_messages_to_pretty (messages_produced, timer.elapsed ()));
+  }
+
+  BOOST_TEST_MESSAGE (" ");
+}
+
+/*
+ * Measure the throughput of a stream published by 1 to 8 producer threads
+ * through a multiple producer source
+ */
+BOOST_AUTO_TEST_CASE (ThroughputByProducerCount)
+{
+  if (getenv ("NOTIMING") != nullptr)
+  {
+    return;
+  }
+
+  BOOST_TEST_MESSAGE ("ThroughputByProducerCount");
+
+  ScopedLogLevel scoped_log_level (error);
+
+  const size_t capacity = 20480 * sizeof (int64_t);
+
+  for (size_t producerCount : { 1, 2, 4, 8 })
+  {
+    SPMCMultiSourceThread source (capacity, producerCount);
+    SPMCSinkThread        sink (source.queue ());
+
+    std::atomic<bool> stop = { false };
+
+    std::vector<std::thread> producers;
+
+    for (size_t p = 0; p < producerCount; ++p)
+    {
+      producers.emplace_back ([&, p] () {
+
+        bind_to_cpu (static_cast<int> (p + 3));
+
+        std::vector<uint8_t> payload (PAYLOAD_SIZE);
+        std::iota (std::begin (payload), std::end (payload), 1);
+
+        while (!stop)
+        {
+          source.next (p, payload);
+        }
+      });
+    }
+
+    uint64_t messages_consumed = 0;
+
+    Timer timer;
+
+    auto consumer = std::thread ([&] () {
+
+      bind_to_cpu (2);
+
+      Header header;
+      std::vector<uint8_t> data;
+
+      while (!stop)
+      {
+        if (sink.next_non_blocking (header, data))
+        {
+          ++messages_consumed;
+        }
+      }
+
+      timer.stop ();
+    });
+
+    std::this_thread::sleep_for (get_test_duration ().nanoseconds ());
+
+    stop = true;
+
+    source.stop ();
+
+    for (auto &producer : producers)
+    {
+      producer.join ();
+    }
+
+    consumer.join ();
+
+    BOOST_CHECK (messages_consumed > 1e3);
+
+    BOOST_TEST_MESSAGE ("Producers: " << producerCount << "\tthroughput: "
+      << throughput_messages_to_pretty (messages_consumed, timer.elapsed ()));
+  }
+
+  BOOST_TEST_MESSAGE (" ");
+}
+
+/*
+ * Measure the wake up latency of a consumer using a wait strategy, receiving
+ * messages at a low rate, and the CPU used by the consumer while waiting
+ */
+template <typename WaitStrategy>
+void wait_strategy_benchmark (const std::string &strategy)
+{
+  using QueueType = SPMCQueue<std::allocator<uint8_t>>;
+
+  SPMCSource<QueueType>             source (20480);
+  SPMCSink<QueueType, WaitStrategy> sink (source.queue ());
+
+  const size_t messages = 1000;
+
+  std::vector<int64_t> latencies;
+  latencies.reserve (messages);
+
+  Nanoseconds cpuTime (0);
+
+  Timer timer;
+
+  std::thread consumer ([&] () {
+
+    bind_to_cpu (2);
+
+    auto thread_cpu_time = [] () {
+      timespec time;
+      clock_gettime (CLOCK_THREAD_CPUTIME_ID, &time);
+      return Seconds (time.tv_sec) + Nanoseconds (time.tv_nsec);
+    };
+
+    auto start = thread_cpu_time ();
+
+    Header header;
+    std::vector<uint8_t> data;
+
+    while (latencies.size () < messages && sink.next (header, data))
+    {
+      latencies.push_back (nanoseconds_since_epoch (Clock::now ())
+                           - header.timestamp);
+    }
+
+    cpuTime = thread_cpu_time () - start;
+  });
+
+  bind_to_cpu (1);
+
+  std::vector<uint8_t> payload (PAYLOAD_SIZE);
+
+  for (size_t i = 0; i < messages; ++i)
+  {
+    std::this_thread::sleep_for (Microseconds (100));
+
+    source.next (payload);
+  }
+
+  consumer.join ();
+
+  timer.stop ();
+
+  BOOST_REQUIRE_EQUAL (latencies.size (), messages);
+
+  std::sort (latencies.begin (), latencies.end ());
+
+  auto elapsed = timer.elapsed ().nanoseconds ();
+
+  auto cpuPercent = 100. * static_cast<double> (cpuTime.count ())
+                  / static_cast<double> (elapsed.count ());
+
+  BOOST_TEST_MESSAGE (std::left << std::setw (15) << strategy
+    << "wake up latency median: " << latencies[messages / 2] << " ns"
+    << "\t99%: " << latencies[messages * 99 / 100] << " ns"
+    << "\tconsumer cpu: " << std::setprecision (3) << cpuPercent << "%");
+}
+
+BOOST_AUTO_TEST_CASE (ConsumerWaitStrategies)
+{
+  if (getenv ("NOTIMING") != nullptr)
+  {
+    return;
+  }
+
+  BOOST_TEST_MESSAGE ("ConsumerWaitStrategies");
+
+  ScopedLogLevel scoped_log_level (error);
+
+  wait_strategy_benchmark<BusySpinWait>  ("BusySpinWait");
+  wait_strategy_benchmark<PauseSpinWait> ("PauseSpinWait");
+  wait_strategy_benchmark<SpinYieldWait> ("SpinYieldWait");
+  wait_strategy_benchmark<BlockingWait>  ("BlockingWait");
+
+  BOOST_TEST_MESSAGE (" ");
+}
+
 BOOST_AUTO_TEST_CASE (SmallCircularBuffer)
 {
   auto duration = get_test_duration ();
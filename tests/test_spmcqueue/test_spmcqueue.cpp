@@ -1,11 +1,16 @@
 #include "Buffer.h"
 #include "Chrono.h"
+#include "CpuTopology.h"
 #include "LatencyStats.h"
 #include "Logger.h"
 #include "PerformanceStats.h"
+#include "SPMCMultiSource.h"
 #include "SPMCQueue.h"
 #include "SPMCSource.h"
 #include "SPMCSink.h"
+#include "SPMCSlotQueue.h"
+#include "SPMCTopicSink.h"
+#include "SPMCTopicSource.h"
 #include "Throttle.h"
 #include "detail/SharedMemory.h"
 
@@ -14,12 +19,18 @@
 #include <boost/scope_exit.hpp>
 
 #include <exception>
+#include <filesystem>
+#include <fstream>
 #include <future>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
+#include <numeric>
 #include <thread>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE SPMCQueueTests
 #include <boost/test/unit_test.hpp>
@@ -290,6 +301,117 @@ BOOST_AUTO_TEST_CASE (SPMCQueueCapacityCheck)
   queue.unregister_consumer (consumer);
 }
 
+BOOST_AUTO_TEST_CASE (SPMCQueuePowerOf2Capacity)
+{
+  ScopedLogLevel log (error);
+
+  using Queue = SPMCQueue<std::allocator<uint8_t>,
+                          MAX_NO_DROP_CONSUMERS_DEFAULT, true>;
+
+  BOOST_CHECK_THROW (Queue (100), std::exception);
+
+  Queue queue (128);
+
+  BOOST_CHECK_EQUAL (queue.capacity (), 128);
+
+  detail::ConsumerState consumer;
+  queue.register_consumer (consumer);
+  /*
+   * The full capacity of the queue is writable
+   */
+  BOOST_CHECK_EQUAL (queue.write_available (), 128);
+
+  Header headerIn, headerOut;
+  std::vector<uint8_t> in (8), out;
+
+  for (size_t i = 0; i < 3; ++i)
+  {
+    headerIn.size = in.size ();
+    BOOST_CHECK (queue.push (headerIn, in));
+  }
+
+  BOOST_CHECK (!queue.push (headerIn, in));
+
+  while (queue.pop (headerOut, out, consumer))
+  { }
+  /*
+   * Vary the payload size so cursors wrap at different offsets in the buffer
+   */
+  for (uint64_t i = 1; i < 1000; ++i)
+  {
+    in.resize (1 + (i % 16));
+    std::iota (std::begin (in), std::end (in), static_cast<uint8_t> (i));
+
+    headerIn.size   = in.size ();
+    headerIn.seqNum = i;
+
+    BOOST_REQUIRE (queue.push (headerIn, in));
+
+    BOOST_REQUIRE (queue.pop (headerOut, out, consumer));
+    BOOST_CHECK_EQUAL (headerOut.seqNum, i);
+    BOOST_CHECK (in == out);
+  }
+
+  BOOST_CHECK (queue.empty (consumer));
+
+  queue.unregister_consumer (consumer);
+}
+
+/*
+ * Queues backed by huge pages, locked memory and bound to a NUMA node behave
+ * as any other queue
+ */
+BOOST_AUTO_TEST_CASE (SPMCQueuePageOptions)
+{
+  using namespace boost::interprocess;
+
+  ScopedLogLevel log (error);
+
+  PageOptions pages;
+  pages.hugePages = true;
+  pages.lockPages = true;
+  pages.numaNode  = 0;
+
+  const size_t capacity = 4*1024*1024;
+
+  std::string name = "SPMCQueuePageOptions:Test";
+
+  struct RemoveSharedMemory
+  {
+    RemoveSharedMemory (const std::string & name) : name (name)
+    { shared_memory_object::remove (name.c_str ()); }
+
+    ~RemoveSharedMemory ()
+    { shared_memory_object::remove (name.c_str ()); }
+
+    std::string name;
+  } cleanup (name);
+
+  SPMCSourceThread  threadSource (capacity, MAX_NO_DROP_CONSUMERS_DEFAULT,
+                                  pages);
+  SPMCSourceProcess processSource (name, name + ":queue", capacity,
+                                   MAX_NO_DROP_CONSUMERS_DEFAULT, pages);
+
+  SPMCSinkThread  threadSink (threadSource.queue ());
+  SPMCSinkProcess processSink (name, name + ":queue", ConsumerMode::NoDrop,
+                               pages);
+
+  Header header;
+  std::vector<uint8_t> data;
+
+  for (uint64_t i = 1; i <= 100; ++i)
+  {
+    threadSource.next (i);
+    processSource.next (i);
+
+    BOOST_REQUIRE (threadSink.next_non_blocking (header, data));
+    BOOST_CHECK_EQUAL (*reinterpret_cast<uint64_t*> (data.data ()), i);
+
+    BOOST_REQUIRE (processSink.next_non_blocking (header, data));
+    BOOST_CHECK_EQUAL (*reinterpret_cast<uint64_t*> (data.data ()), i);
+  }
+}
+
 BOOST_AUTO_TEST_CASE (SPMCQueueBasicTest)
 {
   ScopedLogLevel log (error);
@@ -456,586 +578,2955 @@ BOOST_AUTO_TEST_CASE (SPMCQueuePushVector)
   BOOST_CHECK (payloadIn == payloadOut);
 }
 
-BOOST_AUTO_TEST_CASE (SPSCQueuePushVector)
+BOOST_AUTO_TEST_CASE (SPMCQueueReserveCommit)
 {
   ScopedLogLevel log (error);
 
-  boost::lockfree::spsc_queue<uint8_t> queue (100);
-  size_t payloadSize = 40;
-  const std::vector<uint8_t> empty (payloadSize, 0);
+  SPMCQueue<std::allocator<uint8_t>> queue (200);
 
-  std::vector<uint8_t> payloadIn = empty;
-  std::vector<uint8_t> payloadOut = empty;
-  std::iota (std::begin (payloadIn), std::end (payloadIn), 1);
+  detail::ConsumerState consumer;
 
-  for (uint64_t i = 1; i < 10; ++i)
-  {
-    bool success = queue.push (payloadIn.data (), payloadIn.size ());
-    BOOST_CHECK (success);
+  queue.register_consumer (consumer);
 
-    success = queue.pop (payloadOut.data (), payloadSize);
-    BOOST_CHECK (success);
+  Header headerIn;
+  Header headerOut;
 
-    BOOST_CHECK (payloadIn == payloadOut);
+  std::vector<uint8_t> payloadOut;
+  /*
+   * Vary the payload size so that reserved regions end at every position near
+   * the end of the queue, exercising both wrapped and unwrapped padding headers
+   */
+  for (uint64_t i = 1; i < 500; ++i)
+  {
+    size_t size = 1 + (i % 18);
 
-    payloadOut = empty;
-  }
-}
+    uint8_t *payload = queue.reserve (size);
+    BOOST_REQUIRE (payload != nullptr);
 
+    std::iota (payload, payload + size, static_cast<uint8_t> (i));
 
-#if PREFETCH_FIXED
+    headerIn.size   = size;
+    headerIn.seqNum = i;
 
-BOOST_AUTO_TEST_CASE (ConsumerPrefetchSmallerThanMessageSize)
-{
-  ScopedLogLevel log (error);
+    queue.commit (headerIn);
 
-  SPMCQueue<std::allocator<uint8_t>> queue (1024);
-  queue.register_consumer ();
+    BOOST_CHECK (queue.pop (headerOut, payloadOut, consumer));
+    BOOST_CHECK_EQUAL (headerOut.seqNum, i);
+    BOOST_CHECK_EQUAL (headerOut.type, STANDARD_MESSAGE_TYPE);
+    BOOST_CHECK_EQUAL (payloadOut.size (), size);
 
-  size_t payloadSize = 128;
+    std::vector<uint8_t> expected (size);
+    std::iota (std::begin (expected), std::end (expected),
+               static_cast<uint8_t> (i));
 
-  Header headerIn;
-  headerIn.version = 1;
-  headerIn.type = 2;
-  headerIn.size = payloadSize;
-  headerIn.seqNum = 1;
-  headerIn.timestamp = nanoseconds_since_epoch (Clock::now ());
+    BOOST_CHECK (payloadOut == expected);
+  }
+  /*
+   * Regions cannot be reserved once the queue is full of unconsumed data
+   */
+  BOOST_CHECK (!queue.pop (headerOut, payloadOut, consumer));
 
-  std::vector<uint8_t> payloadIn (payloadSize);
-  std::iota (std::begin (payloadIn), std::end (payloadIn), 1);
+  int reserved = 0;
 
-  BOOST_CHECK (queue.push (headerIn, payloadIn)); ++headerIn.seqNum;
-  bool success = queue.push (headerIn, payloadIn);  ++headerIn.seqNum;
-  BOOST_CHECK (success);
+  while (queue.reserve (8) != nullptr)
+  {
+    headerIn.size = 8;
+    queue.commit (headerIn);
+    ++reserved;
+  }
 
-  Header headerOut;
-  std::vector<uint8_t> payloadOut;
-  success = queue.pop (headerOut, payloadOut);
-  BOOST_CHECK (success);
-  BOOST_CHECK_EQUAL (headerOut.seqNum, 1);
-  BOOST_CHECK (payloadIn == payloadOut);
-  payloadOut.clear ();
+  BOOST_CHECK (reserved >= 3);
+  BOOST_CHECK (reserved <= 5);
 
-  BOOST_CHECK (!queue.cache_enabled ());
-  /*
-   * The next call to pop should fail as the cache size is too small.
-   *
-   * The cache should be disabled at this point and consuming continues without
-   * the use of the cache.
-   */
-  queue.resize_cache (50);
-  BOOST_CHECK (queue.cache_enabled ());
-  success = queue.pop (headerOut, payloadOut);
+  for (int i = 0; i < reserved; ++i)
+  {
+    BOOST_CHECK (queue.pop (headerOut, payloadOut, consumer));
+  }
 
-  BOOST_CHECK (success);
-  BOOST_CHECK (!queue.cache_enabled ());
+  BOOST_CHECK (!queue.pop (headerOut, payloadOut, consumer));
+  BOOST_CHECK (queue.reserve (8) != nullptr);
 
-  BOOST_CHECK_EQUAL (headerOut.seqNum, 2);
-  BOOST_CHECK (payloadIn == payloadOut);
-  payloadOut.clear ();
+  queue.unregister_consumer (consumer);
+}
 
-  BOOST_CHECK (!queue.pop (headerOut, payloadOut));
+BOOST_AUTO_TEST_CASE (SourceSinkReserveCommit)
+{
+  ScopedLogLevel log (error);
 
-  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
-  BOOST_CHECK (success);
+  SPMCSourceThread source (256);
+  SPMCSinkThread   sink (source.queue ());
 
-  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
-  BOOST_CHECK (success);
+  Header header;
+  std::vector<uint8_t> data;
 
-  BOOST_CHECK (queue.pop (headerOut, payloadOut));
-  BOOST_CHECK_EQUAL (headerOut.seqNum, 3);
-  BOOST_CHECK (payloadIn == payloadOut);
+  for (uint64_t i = 1; i < 100; ++i)
+  {
+    uint8_t *payload = source.reserve (sizeof (i));
+    BOOST_REQUIRE (payload != nullptr);
 
-  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
-  BOOST_CHECK (success);
-  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
-  BOOST_CHECK (success);
-  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
-  BOOST_CHECK (success);
+    std::memcpy (payload, &i, sizeof (i));
 
-  success = queue.pop (headerOut, payloadOut);
-  BOOST_CHECK (success);
-  BOOST_CHECK_EQUAL (headerOut.seqNum, 4);
-  BOOST_CHECK (payloadIn == payloadOut);
+    source.commit ();
+
+    BOOST_CHECK (sink.next (header, data));
+    BOOST_CHECK_EQUAL (header.seqNum, i);
+    BOOST_CHECK_EQUAL (header.size, sizeof (i));
+    BOOST_CHECK_EQUAL (*reinterpret_cast<uint64_t*> (data.data ()), i);
+  }
 }
-#endif
 
-BOOST_AUTO_TEST_CASE (SlowConsumerNoMessageDrops)
+BOOST_AUTO_TEST_CASE (SPMCQueuePushBatch)
 {
   ScopedLogLevel log (error);
 
-  SPMCQueue<std::allocator<uint8_t>> queue (150);
+  SPMCQueue<std::allocator<uint8_t>> queue (200);
 
   detail::ConsumerState consumer;
+
   queue.register_consumer (consumer);
 
-  const size_t payloadSize = 8;
+  std::vector<Header> headers (3);
+  std::vector<std::vector<uint8_t>> payloads (3);
 
-  Header headerProducer;
-  headerProducer.version = 1;
-  headerProducer.type = STANDARD_MESSAGE_TYPE;
-  headerProducer.size = payloadSize;
-  headerProducer.seqNum = 1;
-  headerProducer.timestamp = nanoseconds_since_epoch (Clock::now ());
+  for (uint64_t i = 0; i < headers.size (); ++i)
+  {
+    payloads[i].assign (8 + i, static_cast<uint8_t> (i));
 
-  std::vector<uint8_t> payloadProducer (payloadSize, 0);
-  std::iota (std::begin (payloadProducer), std::end (payloadProducer), 1);
+    headers[i].size   = payloads[i].size ();
+    headers[i].seqNum = i + 1;
+  }
+  /*
+   * The whole batch is published at once
+   */
+  BOOST_REQUIRE (queue.push_batch (headers, payloads));
+  BOOST_CHECK_EQUAL (queue.read_available (consumer),
+                     3 * sizeof (Header) + 8 + 9 + 10);
 
   Header header;
-  std::vector<uint8_t> payload;
+  std::vector<uint8_t> data;
+
+  for (uint64_t i = 0; i < headers.size (); ++i)
+  {
+    BOOST_CHECK (queue.pop (header, data, consumer));
+    BOOST_CHECK_EQUAL (header.seqNum, i + 1);
+    BOOST_CHECK (data == payloads[i]);
+  }
+
+  BOOST_CHECK (!queue.pop (header, data, consumer));
   /*
-   * The first call to pop initialises the consumer and ensures it is ready to
-   * start consuming from the next message to arrive
+   * Nothing is pushed if the batch does not fit
    */
-  BOOST_CHECK_EQUAL (queue.pop (header, payload, consumer), false);
+  headers.resize (6, headers.back ());
+  payloads.resize (6, payloads.back ());
 
-  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), true); // commit=40
-  BOOST_CHECK_EQUAL (queue.pop (header, payload, consumer), true); // consumed=40
+  BOOST_CHECK (!queue.push_batch (headers, payloads));
+  BOOST_CHECK (queue.empty (consumer));
 
-  BOOST_CHECK_EQUAL (header.version,    headerProducer.version);
-  BOOST_CHECK_EQUAL (header.type,       headerProducer.type);
-  BOOST_CHECK_EQUAL (header.timestamp,  headerProducer.timestamp);
-  BOOST_CHECK_EQUAL (payload.size (), payloadSize);
-  BOOST_CHECK (payload == payloadProducer);
+  queue.unregister_consumer (consumer);
+}
 
-  // send enough data to wrap the buffer and exert back pressure on the producer
-  ++headerProducer.seqNum;
-  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), true); // commit=80
+BOOST_AUTO_TEST_CASE (SourceSinkPushBatch)
+{
+  ScopedLogLevel log (error);
 
-  ++headerProducer.seqNum;
-  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), true); // commit=120
+  SPMCSourceThread source (1024);
+  SPMCSinkThread   sink (source.queue ());
 
-  ++headerProducer.seqNum;
-  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), false);
+  std::vector<uint64_t> batch (8);
 
-  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), false);
+  Header header;
+  std::vector<uint8_t> data;
 
-  BOOST_CHECK (queue.pop (header, payload, consumer));
-  BOOST_CHECK (payloadProducer == payload);
+  uint64_t seqNum = 0;
 
-  headerProducer.seqNum = 123;
-  BOOST_CHECK (queue.push (headerProducer, payloadProducer));
-  BOOST_CHECK (payloadProducer == payload);
+  for (uint64_t i = 0; i < 20; ++i)
+  {
+    std::iota (std::begin (batch), std::end (batch), seqNum + 1);
 
-  BOOST_CHECK_EQUAL (queue.pop (header, payload, consumer), true);
-  BOOST_CHECK_EQUAL (header.version,    headerProducer.version);
-  BOOST_CHECK_EQUAL (header.type,       headerProducer.type);
-  BOOST_CHECK_EQUAL (header.timestamp,  headerProducer.timestamp);
-  BOOST_CHECK_EQUAL (header.seqNum,     3);
-  BOOST_CHECK (payloadProducer == payload);
+    source.next_batch (batch);
 
-  BOOST_CHECK_EQUAL (queue.pop (header, payload, consumer), true);
-  BOOST_CHECK_EQUAL (header.version,    headerProducer.version);
-  BOOST_CHECK_EQUAL (header.type,       headerProducer.type);
-  BOOST_CHECK_EQUAL (header.timestamp,  headerProducer.timestamp);
-  BOOST_CHECK_EQUAL (header.seqNum,     123);
-  BOOST_CHECK (payloadProducer == payload);
+    for (size_t j = 0; j < batch.size (); ++j)
+    {
+      ++seqNum;
+
+      BOOST_REQUIRE (sink.next (header, data));
+      BOOST_CHECK_EQUAL (header.seqNum, seqNum);
+      BOOST_CHECK_EQUAL (header.size, sizeof (uint64_t));
+      BOOST_CHECK_EQUAL (*reinterpret_cast<uint64_t*> (data.data ()), seqNum);
+    }
+  }
 }
 
-template <class Queue>
-class Server : boost::noncopyable
+BOOST_AUTO_TEST_CASE (SPMCQueueReadView)
 {
-public:
-  Server (Queue &queue, size_t size, uint32_t rate)
-  : m_data (size, 0),
-    m_throttle (rate)
-  {
-    std::iota (std::begin (m_data), std::end (m_data), 1);
+  ScopedLogLevel log (error);
 
-    m_thread = std::thread ([this, &queue]() {
+  SPMCQueue<std::allocator<uint8_t>> queue (200);
 
-      uint64_t seqNum = 0;
+  detail::ConsumerState consumer;
 
-      Header   header;
-      header.size = m_data.size ();
+  queue.register_consumer (consumer);
 
-      m_ready = true;
+  Header headerIn;
+  ReadView view;
+  /*
+   * Vary the payload size so that some payloads wrap around the end of the
+   * queue and are copied, while others are read in place
+   */
+  for (uint64_t i = 1; i < 500; ++i)
+  {
+    std::vector<uint8_t> payloadIn;
 
-      while (!m_stop)
+    for (uint64_t j = 0; j <= i % 18; ++j)
+    {
+      payloadIn.push_back (static_cast<uint8_t> (i + j));
+    }
+
+    headerIn.size   = payloadIn.size ();
+    headerIn.seqNum = i;
+
+    BOOST_REQUIRE (queue.push (headerIn, payloadIn));
+
+    BOOST_REQUIRE (queue.read_view (view, consumer));
+    BOOST_CHECK_EQUAL (view.header.seqNum, i);
+    BOOST_CHECK_EQUAL (view.size, payloadIn.size ());
+    BOOST_CHECK (std::equal (view.data, view.data + view.size,
+                             payloadIn.begin ()));
+    /*
+     * A view is not consumed until it is released
+     */
+    BOOST_CHECK (queue.read_view (view, consumer));
+    BOOST_CHECK_EQUAL (view.header.seqNum, i);
+
+    queue.release (view, consumer);
+  }
+
+  BOOST_CHECK (!queue.read_view (view, consumer));
+  /*
+   * The producer cannot overwrite data referenced by an unreleased view
+   */
+  std::vector<uint8_t> payloadIn (8, 1);
+  headerIn.size = payloadIn.size ();
+
+  BOOST_REQUIRE (queue.push (headerIn, payloadIn));
+  BOOST_REQUIRE (queue.read_view (view, consumer));
+
+  const uint8_t *data = view.data;
+
+  std::fill (payloadIn.begin (), payloadIn.end (), 2);
+
+  while (queue.push (headerIn, payloadIn))
+  { }
+
+  BOOST_CHECK (std::all_of (data, data + view.size,
+                            [] (uint8_t v) { return v == 1; }));
+
+  queue.release (view, consumer);
+
+  queue.unregister_consumer (consumer);
+}
+
+BOOST_AUTO_TEST_CASE (SourceSinkReadView)
+{
+  ScopedLogLevel log (error);
+
+  SPMCSourceThread source (256);
+  SPMCSinkThread   sink (source.queue ());
+
+  ReadView view;
+
+  for (uint64_t i = 1; i < 100; ++i)
+  {
+    source.next (i);
+
+    BOOST_REQUIRE (sink.read_view (view));
+    BOOST_CHECK_EQUAL (view.header.seqNum, i);
+    BOOST_CHECK_EQUAL (view.size, sizeof (i));
+
+    uint64_t value = 0;
+    std::memcpy (&value, view.data, sizeof (value));
+    BOOST_CHECK_EQUAL (value, i);
+
+    sink.release (view);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (SourceSinkDrain)
+{
+  ScopedLogLevel log (error);
+
+  SPMCSourceThread source (512);
+  SPMCSinkThread   sink (source.queue ());
+
+  uint64_t seqNum = 0;
+
+  auto check = [&seqNum] (const Header &header, const uint8_t *data,
+                          size_t size) {
+    ++seqNum;
+
+    BOOST_CHECK_EQUAL (header.seqNum, seqNum);
+    BOOST_CHECK_EQUAL (size, sizeof (uint64_t));
+    BOOST_CHECK_EQUAL (*reinterpret_cast<const uint64_t*> (data), seqNum);
+  };
+
+  for (uint64_t i = 1; i <= 10; ++i)
+  {
+    source.next (i);
+  }
+
+  BOOST_CHECK_EQUAL (sink.drain (check, 4), 4);
+  BOOST_CHECK_EQUAL (sink.drain (check), 6);
+  BOOST_CHECK_EQUAL (sink.drain (check), 0);
+  /*
+   * Drained data is released to the producer, so the queue can be refilled
+   */
+  for (uint64_t i = 11; i <= 20; ++i)
+  {
+    source.next (i);
+  }
+
+  SPMCSinkThread::DrainCallback callback = check;
+
+  BOOST_CHECK_EQUAL (sink.drain (callback), 10);
+  BOOST_CHECK_EQUAL (seqNum, 20);
+}
+
+/*
+ * Messages rejected by a consumer type filter are skipped
+ */
+BOOST_AUTO_TEST_CASE (SPMCQueueTypeFilter)
+{
+  ScopedLogLevel log (error);
+
+  SPMCQueue<std::allocator<uint8_t>> queue (1024);
+
+  detail::ConsumerState popConsumer, viewConsumer;
+  detail::ConsumerState dropConsumer (ConsumerMode::Drop);
+
+  queue.register_consumer (popConsumer);
+  queue.register_consumer (viewConsumer);
+  queue.register_consumer (dropConsumer);
+
+  TypeFilter filter;
+  filter.set (20);
+  filter.set (WARMUP_MESSAGE_TYPE);
+
+  popConsumer.type_filter (filter);
+  viewConsumer.type_filter (filter);
+  dropConsumer.type_filter (filter);
+  /*
+   * Warmup messages are never accepted
+   */
+  BOOST_CHECK (!popConsumer.accepts (WARMUP_MESSAGE_TYPE));
+  BOOST_CHECK (popConsumer.accepts (20));
+  BOOST_CHECK (!popConsumer.accepts (10));
+
+  Header header;
+  std::vector<uint8_t> in (16), out;
+
+  for (uint64_t i = 1; i <= 9; ++i)
+  {
+    header.type   = static_cast<uint8_t> (10 * (1 + i % 3));
+    header.seqNum = i;
+    header.size   = in.size ();
+
+    BOOST_REQUIRE (queue.push (header, in));
+  }
+
+  std::vector<uint64_t> popped, viewed, dropped;
+
+  while (queue.pop (header, out, popConsumer))
+  {
+    BOOST_CHECK_EQUAL (header.type, 20);
+    popped.push_back (header.seqNum);
+  }
+
+  ReadView view;
+
+  while (queue.read_view (view, viewConsumer))
+  {
+    BOOST_CHECK_EQUAL (view.header.type, 20);
+    viewed.push_back (view.header.seqNum);
+    queue.release (view, viewConsumer);
+  }
+
+  while (queue.pop (header, out, dropConsumer))
+  {
+    dropped.push_back (header.seqNum);
+  }
+
+  std::vector<uint64_t> expected { 1, 4, 7 };
+
+  BOOST_CHECK (popped  == expected);
+  BOOST_CHECK (viewed  == expected);
+  BOOST_CHECK (dropped == expected);
+
+  queue.unregister_consumer (popConsumer);
+  queue.unregister_consumer (viewConsumer);
+  queue.unregister_consumer (dropConsumer);
+}
+
+/*
+ * Messages pushed to a queue using compact headers are restored to Headers
+ * when popped, using 16 bytes of queue space per header
+ */
+BOOST_AUTO_TEST_CASE (SPMCQueueCompactHeader)
+{
+  ScopedLogLevel log (error);
+
+  using Queue = SPMCQueue<std::allocator<uint8_t>,
+                          MAX_NO_DROP_CONSUMERS_DEFAULT, false, CompactHeader>;
+
+  BOOST_CHECK_EQUAL (sizeof (Queue::HeaderType), 16);
+
+  Queue queue (256);
+
+  detail::ConsumerState consumer;
+
+  queue.register_consumer (consumer);
+
+  int64_t now  = nanoseconds_since_epoch (Clock::now ());
+  int64_t hour = Nanoseconds (3600s).count ();
+  /*
+   * Sequence numbers crossing 32 bit boundaries and timestamps either side of
+   * the queue timestamp base
+   */
+  std::vector<uint64_t> seqNums    = { 0x7ffffff0, 0xbffffff0, 0xfffffff0,
+                                       0x100000010 };
+  std::vector<int64_t>  timestamps = { now, now - hour, now + 30 * hour,
+                                       DEFAULT_TIMESTAMP };
+  Header headerIn;
+  Header headerOut;
+
+  uint64_t payloadIn = 0;
+
+  std::vector<uint8_t> payloadOut;
+
+  for (size_t i = 0; i < seqNums.size (); ++i)
+  {
+    headerIn.size      = sizeof (payloadIn);
+    headerIn.seqNum    = seqNums[i];
+    headerIn.timestamp = timestamps[i];
+
+    payloadIn = i;
+
+    size_t available = queue.write_available ();
+
+    BOOST_REQUIRE (queue.push (headerIn, payloadIn));
+    BOOST_CHECK_EQUAL (available - queue.write_available (),
+                       sizeof (CompactHeader) + sizeof (payloadIn));
+
+    BOOST_REQUIRE (queue.pop (headerOut, payloadOut, consumer));
+
+    BOOST_CHECK_EQUAL (headerOut.version,   COMPACT_HEADER_VERSION);
+    BOOST_CHECK_EQUAL (headerOut.type,      STANDARD_MESSAGE_TYPE);
+    BOOST_CHECK_EQUAL (headerOut.size,      sizeof (payloadIn));
+    BOOST_CHECK_EQUAL (headerOut.seqNum,    seqNums[i]);
+    BOOST_CHECK_EQUAL (headerOut.timestamp, timestamps[i]);
+
+    BOOST_CHECK_EQUAL (*reinterpret_cast<uint64_t*> (payloadOut.data ()), i);
+  }
+  /*
+   * Sources and sinks use the header format of the queue type, including for
+   * warmup messages and the padding written by reserved regions
+   */
+  SPMCSource<Queue> source (200);
+  SPMCSink<Queue>   sink (source.queue ());
+
+  for (uint64_t i = 1; i < 100; ++i)
+  {
+    source.next_keep_warm ();
+
+    uint8_t *payload = source.reserve (1 + (i % 11));
+    BOOST_REQUIRE (payload != nullptr);
+
+    *payload = static_cast<uint8_t> (i);
+
+    source.commit ();
+
+    BOOST_REQUIRE (sink.next (headerOut, payloadOut));
+    BOOST_CHECK_EQUAL (headerOut.seqNum, i);
+    BOOST_CHECK_EQUAL (payloadOut.size (), 1 + (i % 11));
+    BOOST_CHECK_EQUAL (payloadOut[0], static_cast<uint8_t> (i));
+  }
+
+  BOOST_CHECK (!sink.next_non_blocking (headerOut, payloadOut));
+}
+
+/*
+ * Consumers registering after the sequence numbers have passed 2^32 restore the
+ * full sequence numbers of compact headers
+ */
+BOOST_AUTO_TEST_CASE (SPMCQueueCompactHeaderLateConsumer)
+{
+  ScopedLogLevel log (error);
+
+  using Queue = SPMCQueue<std::allocator<uint8_t>,
+                          MAX_NO_DROP_CONSUMERS_DEFAULT, false, CompactHeader>;
+
+  Queue queue (8192);
+  /*
+   * The low 32 bits of the sequence numbers cross 0x80000000, which a consumer
+   * extending them from zero would restore as sequence numbers below 2^32
+   */
+  uint64_t firstSeqNum = 0x180000000 - 100;
+
+  Header header;
+
+  uint64_t payload = 0;
+
+  std::vector<uint8_t> payloadOut;
+
+  for (uint64_t seqNum = firstSeqNum; seqNum < firstSeqNum + 150; ++seqNum)
+  {
+    header.seqNum = seqNum;
+    header.size   = sizeof (payload);
+
+    BOOST_REQUIRE (queue.push (header, payload));
+  }
+
+  StartPosition oldest;
+  oldest.origin = StartPosition::Oldest;
+
+  detail::ConsumerState consumer;
+  detail::ConsumerState oldestConsumer;
+
+  oldestConsumer.start (oldest);
+
+  queue.register_consumer (consumer);
+  queue.register_consumer (oldestConsumer);
+
+  for (uint64_t seqNum = firstSeqNum + 150; seqNum < firstSeqNum + 200;
+       ++seqNum)
+  {
+    header.seqNum = seqNum;
+
+    BOOST_REQUIRE (queue.push (header, payload));
+
+    BOOST_REQUIRE (queue.pop (header, payloadOut, consumer));
+    BOOST_CHECK_EQUAL (header.seqNum, seqNum);
+  }
+
+  for (uint64_t seqNum = firstSeqNum; seqNum < firstSeqNum + 200; ++seqNum)
+  {
+    BOOST_REQUIRE (queue.pop (header, payloadOut, oldestConsumer));
+    BOOST_CHECK_EQUAL (header.seqNum, seqNum);
+  }
+}
+
+/*
+ * The timestamps of compact headers are restored however far they move from
+ * the timestamp at which the queue was constructed
+ */
+BOOST_AUTO_TEST_CASE (SPMCQueueCompactHeaderTimestampRebase)
+{
+  ScopedLogLevel log (error);
+
+  using Queue = SPMCQueue<std::allocator<uint8_t>,
+                          MAX_NO_DROP_CONSUMERS_DEFAULT, false, CompactHeader>;
+
+  Queue queue (1024);
+
+  detail::ConsumerState consumer;
+
+  queue.register_consumer (consumer);
+
+  int64_t now  = nanoseconds_since_epoch (Clock::now ());
+  int64_t hour = Nanoseconds (3600s).count ();
+
+  Header header;
+  header.size = sizeof (uint64_t);
+
+  uint64_t payload = 0;
+
+  std::vector<uint8_t> payloadOut;
+  /*
+   * Timestamps advance far beyond the 48 bit range of the first timestamp base,
+   * several messages at a time being popped after the base has moved
+   */
+  std::vector<int64_t> timestamps;
+
+  for (int64_t i = 0; i < 60; ++i)
+  {
+    timestamps.push_back (now + i * 5 * hour);
+  }
+
+  for (size_t i = 0; i < timestamps.size (); i += 3)
+  {
+    for (size_t j = i; j < i + 3; ++j)
+    {
+      header.seqNum    = j + 1;
+      header.timestamp = timestamps[j];
+
+      BOOST_REQUIRE (queue.push (header, payload));
+    }
+
+    for (size_t j = i; j < i + 3; ++j)
+    {
+      BOOST_REQUIRE (queue.pop (header, payloadOut, consumer));
+      BOOST_CHECK_EQUAL (header.seqNum, j + 1);
+      BOOST_CHECK_EQUAL (header.timestamp, timestamps[j]);
+    }
+  }
+  /*
+   * A timestamp sharing the low bits of an unset timestamp is restored one
+   * nanosecond later rather than as unset
+   */
+  int64_t unset = static_cast<int64_t> (
+      (static_cast<uint64_t> (now) & ~detail::HeaderCodec<CompactHeader>::
+                                       TIMESTAMP_MASK)
+      | detail::HeaderCodec<CompactHeader>::UNSET_TIMESTAMP);
+
+  header.timestamp = unset;
+
+  BOOST_REQUIRE (queue.push (header, payload));
+  BOOST_REQUIRE (queue.pop (header, payloadOut, consumer));
+  BOOST_CHECK_EQUAL (header.timestamp, unset + 1);
+
+  queue.unregister_consumer (consumer);
+}
+
+/*
+ * Consumers registering after the queue has wrapped start from the latest data,
+ * the oldest retained message or a requested sequence number
+ */
+BOOST_AUTO_TEST_CASE (SPMCQueueLateJoin)
+{
+  ScopedLogLevel log (error);
+
+  auto test = [] (auto &queue) {
+
+    Header header;
+    std::vector<uint8_t> in (40), out;
+
+    auto push = [&queue, &header, &in] (uint64_t first, uint64_t last) {
+      for (uint64_t i = first; i <= last; ++i)
+      {
+        header.seqNum = i;
+        header.size   = in.size ();
+
+        BOOST_REQUIRE (queue.push (header, in));
+      }
+    };
+
+    auto pop = [&queue, &header, &out] (detail::ConsumerState &consumer) {
+      std::vector<uint64_t> seqNums;
+
+      while (queue.pop (header, out, consumer))
+      {
+        seqNums.push_back (header.seqNum);
+      }
+
+      return seqNums;
+    };
+
+    auto range = [] (uint64_t first, uint64_t last) {
+      std::vector<uint64_t> seqNums (last - first + 1);
+
+      std::iota (seqNums.begin (), seqNums.end (), first);
+
+      return seqNums;
+    };
+    /*
+     * Messages are 72 bytes, so the last 14 messages of 100 are retained
+     */
+    push (1, 100);
+
+    StartPosition oldest;
+    oldest.origin = StartPosition::Oldest;
+
+    StartPosition from95;
+    from95.origin = StartPosition::SequenceNumber;
+    from95.seqNum = 95;
+
+    StartPosition from50;
+    from50.origin = StartPosition::SequenceNumber;
+    from50.seqNum = 50;
+
+    detail::ConsumerState head, oldestNoDrop, from95Drop (ConsumerMode::Drop);
+    detail::ConsumerState from50NoDrop, overtaken;
+
+    oldestNoDrop.start (oldest);
+    from95Drop.start (from95);
+    from50NoDrop.start (from50);
+    overtaken.start (oldest);
+
+    queue.register_consumer (head);
+    queue.register_consumer (oldestNoDrop);
+    queue.register_consumer (from95Drop);
+    queue.register_consumer (from50NoDrop);
+    queue.register_consumer (overtaken);
+
+    BOOST_CHECK (!head.replaying ());
+    BOOST_CHECK (oldestNoDrop.replaying ());
+
+    BOOST_CHECK (pop (head).empty ());
+    BOOST_CHECK (pop (oldestNoDrop) == range (87, 100));
+    BOOST_CHECK (pop (from95Drop)   == range (95, 100));
+    BOOST_CHECK (pop (from50NoDrop) == range (87, 100));
+    /*
+     * Messages requested which were no longer retained are counted as dropped
+     */
+    BOOST_CHECK_EQUAL (from50NoDrop.dropped (), 87 - 50);
+    /*
+     * NoDrop consumers exert back-pressure once they have replayed the retained
+     * messages
+     */
+    BOOST_CHECK (!oldestNoDrop.replaying ());
+
+    push (101, 110);
+
+    BOOST_CHECK (pop (head)         == range (101, 110));
+    BOOST_CHECK (pop (oldestNoDrop) == range (101, 110));
+    BOOST_CHECK (pop (from95Drop)   == range (101, 110));
+    BOOST_CHECK (pop (from50NoDrop) == range (101, 110));
+    /*
+     * A consumer overtaken while replaying skips to where it registered
+     */
+    BOOST_CHECK (overtaken.replaying ());
+    BOOST_CHECK (!queue.pop (header, out, overtaken));
+    BOOST_CHECK (pop (overtaken) == range (101, 110));
+    BOOST_CHECK (!overtaken.replaying ());
+
+    queue.unregister_consumer (head);
+    queue.unregister_consumer (oldestNoDrop);
+    queue.unregister_consumer (from95Drop);
+    queue.unregister_consumer (from50NoDrop);
+    queue.unregister_consumer (overtaken);
+  };
+
+  SPMCQueue<std::allocator<uint8_t>> queue (1024);
+  SPMCQueue<std::allocator<uint8_t>, MAX_NO_DROP_CONSUMERS_DEFAULT, true>
+    powerOf2Queue (1024);
+
+  test (queue);
+  test (powerOf2Queue);
+}
+
+/*
+ * A push which fails because the queue is full retires no retained messages
+ */
+BOOST_AUTO_TEST_CASE (SPMCQueueFullRetainsOldest)
+{
+  ScopedLogLevel log (error);
+
+  SPMCQueue<std::allocator<uint8_t>> queue (1024);
+
+  detail::ConsumerState blocking;
+
+  queue.register_consumer (blocking);
+
+  Header header;
+  std::vector<uint8_t> in (40), out;
+  /*
+   * Fill the queue with 72 byte messages until the consumer blocks the producer
+   */
+  uint64_t seqNum = 0;
+
+  do
+  {
+    header.seqNum = ++seqNum;
+    header.size   = in.size ();
+  }
+  while (queue.push (header, in));
+
+  const uint64_t pushed = seqNum - 1;
+
+  BOOST_CHECK_EQUAL (pushed, 14);
+
+  BOOST_CHECK (!queue.push (header, in));
+  BOOST_CHECK (!queue.push (header));
+  BOOST_CHECK (queue.reserve (in.size ()) == nullptr);
+
+  StartPosition oldest;
+  oldest.origin = StartPosition::Oldest;
+
+  detail::ConsumerState late;
+  late.start (oldest);
+
+  queue.register_consumer (late);
+
+  for (uint64_t i = 1; i <= pushed; ++i)
+  {
+    BOOST_REQUIRE (queue.pop (header, out, late));
+    BOOST_CHECK_EQUAL (header.seqNum, i);
+  }
+
+  BOOST_CHECK (!queue.pop (header, out, late));
+
+  queue.unregister_consumer (blocking);
+  queue.unregister_consumer (late);
+}
+
+/*
+ * Consumers seek to retained messages by sequence number to re-read a gap
+ */
+BOOST_AUTO_TEST_CASE (SPMCQueueSeek)
+{
+  ScopedLogLevel log (error);
+
+  using Queue = SPMCQueue<std::allocator<uint8_t>>;
+
+  Queue queue (64 * 1024);
+
+  Header header;
+  std::vector<uint8_t> in (40), out;
+
+  auto push = [&queue, &header, &in] (uint64_t first, uint64_t last) {
+    for (uint64_t i = first; i <= last; ++i)
+    {
+      header.seqNum = i;
+      header.size   = in.size ();
+
+      BOOST_REQUIRE (queue.push (header, in));
+    }
+  };
+
+  detail::ConsumerState noDrop, drop (ConsumerMode::Drop);
+
+  queue.register_consumer (noDrop);
+  queue.register_consumer (drop);
+  /*
+   * Pushing 2000 messages of 72 bytes retains the last 910 messages
+   */
+  for (uint64_t i = 0; i < 4; ++i)
+  {
+    push (500 * i + 1, 500 * (i + 1));
+
+    while (queue.pop (header, out, noDrop))
+    { }
+  }
+
+  BOOST_CHECK_EQUAL (header.seqNum, 2000);
+  /*
+   * Re-read a gap, after which a NoDrop consumer continues where it was
+   */
+  BOOST_CHECK (queue.seek (1500, noDrop));
+  BOOST_CHECK (noDrop.replaying ());
+
+  for (uint64_t i = 1500; i <= 2000; ++i)
+  {
+    BOOST_REQUIRE (queue.pop (header, out, noDrop));
+    BOOST_CHECK_EQUAL (header.seqNum, i);
+  }
+
+  BOOST_CHECK (!queue.pop (header, out, noDrop));
+  BOOST_CHECK (!noDrop.replaying ());
+
+  push (2001, 2010);
+
+  BOOST_REQUIRE (queue.pop (header, out, noDrop));
+  BOOST_CHECK_EQUAL (header.seqNum, 2001);
+  /*
+   * A Drop consumer seeks to an indexed and an unindexed message, and to a
+   * message which is no longer retained
+   */
+  BOOST_CHECK (queue.seek (1920, drop));
+  BOOST_REQUIRE (queue.pop (header, out, drop));
+  BOOST_CHECK_EQUAL (header.seqNum, 1920);
+
+  BOOST_CHECK (queue.seek (1201, drop));
+  BOOST_REQUIRE (queue.pop (header, out, drop));
+  BOOST_CHECK_EQUAL (header.seqNum, 1201);
+
+  BOOST_CHECK (!queue.seek (100, drop));
+  BOOST_REQUIRE (queue.pop (header, out, drop));
+  BOOST_CHECK_EQUAL (header.seqNum, 1101);
+
+  queue.unregister_consumer (noDrop);
+  queue.unregister_consumer (drop);
+}
+
+/*
+ * NoDrop consumers of a slot queue exert back pressure, Drop consumers skip
+ * values which have been overwritten
+ */
+BOOST_AUTO_TEST_CASE (SPMCSlotQueueBackPressure)
+{
+  ScopedLogLevel log (error);
+
+  struct Tick
+  {
+    uint64_t seqNum;
+    double   price;
+  };
+
+  SPMCSlotQueue<Tick, std::allocator<uint8_t>> queue (8);
+
+  BOOST_CHECK_THROW ((SPMCSlotQueue<Tick, std::allocator<uint8_t>> (6)),
+                     std::exception);
+
+  detail::ConsumerState consumer;
+  detail::ConsumerState dropConsumer (ConsumerMode::Drop);
+
+  queue.register_consumer (consumer);
+  queue.register_consumer (dropConsumer);
+
+  Tick tick;
+
+  BOOST_CHECK (!queue.pop (tick, consumer));
+
+  for (uint64_t i = 1; i <= 8; ++i)
+  {
+    BOOST_CHECK (queue.push (Tick { i, i * 0.5 }));
+  }
+
+  BOOST_CHECK (!queue.push (Tick { 9, 4.5 }));
+  BOOST_CHECK_EQUAL (queue.read_available (consumer), 8);
+
+  BOOST_REQUIRE (queue.pop (tick, dropConsumer));
+  BOOST_CHECK_EQUAL (tick.seqNum, 1);
+
+  for (uint64_t i = 1; i <= 8; ++i)
+  {
+    BOOST_REQUIRE (queue.pop (tick, consumer));
+    BOOST_CHECK_EQUAL (tick.seqNum, i);
+    BOOST_CHECK_EQUAL (tick.price,  i * 0.5);
+  }
+  /*
+   * Slots are released to the producer once the consumer finds the queue empty
+   */
+  BOOST_CHECK (!queue.pop (tick, consumer));
+
+  for (uint64_t i = 9; i <= 16; ++i)
+  {
+    BOOST_CHECK (queue.push (Tick { i, i * 0.5 }));
+  }
+  /*
+   * The Drop consumer has been lapped, so skips to the latest value
+   */
+  BOOST_CHECK (!queue.pop (tick, dropConsumer));
+  BOOST_CHECK (!queue.pop (tick, dropConsumer));
+
+  for (uint64_t i = 9; i <= 16; ++i)
+  {
+    BOOST_REQUIRE (queue.pop (tick, consumer));
+    BOOST_CHECK_EQUAL (tick.seqNum, i);
+  }
+
+  BOOST_CHECK (!queue.pop (tick, consumer));
+
+  BOOST_CHECK (queue.push (Tick { 17, 8.5 }));
+
+  BOOST_CHECK (queue.pop (tick, dropConsumer));
+  BOOST_CHECK_EQUAL (tick.seqNum, 17);
+  /*
+   * The values skipped by the Drop consumer are counted in the queue metrics
+   */
+  BOOST_CHECK_EQUAL (dropConsumer.dropped (), 15);
+  BOOST_CHECK_EQUAL (queue.metrics ().dropped, 15);
+  BOOST_CHECK_EQUAL (queue.metrics ().published, 17);
+
+  BOOST_CHECK (queue.pop (tick, consumer));
+  BOOST_CHECK_EQUAL (tick.seqNum, 17);
+
+  queue.unregister_consumer (consumer);
+  queue.unregister_consumer (dropConsumer);
+}
+
+/*
+ * A NoDrop consumer of a slot queue which is evicted before reading anything
+ * continues as a Drop consumer once the producer has overtaken it
+ */
+BOOST_AUTO_TEST_CASE (SPMCSlotQueueEvictStalledConsumer)
+{
+  ScopedLogLevel log (error);
+
+  SPMCSlotQueue<uint64_t, std::allocator<uint8_t>> queue (8);
+
+  queue.consumer_lease (Milliseconds (10));
+
+  detail::ConsumerState stalled, reader;
+
+  queue.register_consumer (stalled);
+  queue.register_consumer (reader);
+
+  uint64_t value = 0;
+
+  for (uint64_t i = 1; i <= 100; ++i)
+  {
+    auto timeout = Clock::now () + Seconds (5);
+
+    while (!queue.push (i))
+    {
+      BOOST_REQUIRE (Clock::now () < timeout);
+    }
+
+    BOOST_REQUIRE (queue.pop (value, reader));
+    BOOST_CHECK_EQUAL (value, i);
+  }
+
+  BOOST_CHECK_EQUAL (queue.evicted_consumers (), 1);
+  BOOST_CHECK (!reader.evicted ());
+  /*
+   * The stalled consumer finds its next slot overwritten and skips to the
+   * latest value
+   */
+  BOOST_CHECK (!queue.pop (value, stalled));
+  BOOST_CHECK (stalled.evicted ());
+  BOOST_CHECK (stalled.mode () == ConsumerMode::Drop);
+
+  BOOST_CHECK (queue.push (101));
+
+  BOOST_REQUIRE (queue.pop (value, stalled));
+  BOOST_CHECK_EQUAL (value, 101);
+
+  queue.unregister_consumer (stalled);
+  queue.unregister_consumer (reader);
+}
+
+/*
+ * Messages from multiple producers are published as one stream, keeping the
+ * order of the messages of each producer
+ */
+BOOST_AUTO_TEST_CASE (MultiSourceOrderedStream)
+{
+  ScopedLogLevel log (error);
+
+  const size_t   producerCount = 4;
+  const uint64_t messageCount  = 1000;
+
+  SPMCMultiSourceThread source (4096, producerCount);
+  SPMCSinkThread        sink (source.queue ());
+
+  BOOST_CHECK_EQUAL (source.producers (), producerCount);
+
+  std::vector<std::thread> producers;
+
+  for (size_t p = 0; p < producerCount; ++p)
+  {
+    producers.emplace_back ([&source, p, messageCount] () {
+
+      for (uint64_t i = 1; i <= messageCount; ++i)
+      {
+        source.next (p, (p << 32) | i);
+      }
+    });
+  }
+
+  Header header;
+  std::vector<uint8_t> data;
+
+  std::vector<uint64_t> last (producerCount, 0);
+
+  uint64_t received = 0;
+  bool     ordered  = true;
+
+  while (received < producerCount * messageCount && sink.next (header, data))
+  {
+    BOOST_REQUIRE_EQUAL (data.size (), sizeof (uint64_t));
+
+    uint64_t value = *reinterpret_cast<uint64_t*> (data.data ());
+    uint64_t p     = value >> 32;
+
+    BOOST_REQUIRE (p < producerCount);
+
+    ordered = ordered && (header.seqNum == ++received)
+                      && ((value & 0xffffffff) == ++last[p]);
+  }
+
+  for (auto &producer : producers)
+  {
+    producer.join ();
+  }
+
+  BOOST_CHECK (ordered);
+  BOOST_CHECK_EQUAL (received, producerCount * messageCount);
+}
+
+/*
+ * A blocking sink sleeps while the queue is empty and is woken by the producer
+ */
+BOOST_AUTO_TEST_CASE (SourceSinkBlockingWait)
+{
+  ScopedLogLevel log (error);
+
+  using Queue = SPMCQueue<std::allocator<uint8_t>>;
+
+  SPMCSource<Queue>             source (512);
+  SPMCSink<Queue, BlockingWait> sink (source.queue ());
+
+  const uint64_t messages = 20;
+
+  uint64_t received = 0;
+
+  std::thread consumer ([&] () {
+
+    Header header;
+    std::vector<uint8_t> data;
+
+    while (received < messages && sink.next (header, data))
+    {
+      ++received;
+
+      BOOST_CHECK_EQUAL (header.seqNum, received);
+    }
+  });
+
+  for (uint64_t i = 1; i <= messages; ++i)
+  {
+    /*
+     * Allow the consumer to spin, arm the doorbell and go to sleep
+     */
+    std::this_thread::sleep_for (Milliseconds (1));
+
+    source.next (i);
+  }
+
+  consumer.join ();
+
+  BOOST_CHECK_EQUAL (received, messages);
+  BOOST_CHECK_EQUAL (source.queue ().doorbell ().waiters (), 0);
+}
+
+/*
+ * The doorbell entry of a consumer process which exits while armed is
+ * reclaimed by the producer
+ */
+BOOST_AUTO_TEST_CASE (DoorbellWaiterExits)
+{
+  using namespace boost::interprocess;
+
+  ScopedLogLevel log (error);
+
+  std::string name = "DoorbellWaiterExits:Test";
+
+  struct RemoveSharedMemory
+  {
+    RemoveSharedMemory (const std::string & name) : name (name)
+    { shared_memory_object::remove (name.c_str ()); }
+
+    ~RemoveSharedMemory ()
+    { shared_memory_object::remove (name.c_str ()); }
+
+    std::string name;
+  } cleanup (name);
+
+  using Queue = SPMCQueue<SharedMemory::Allocator>;
+
+  Queue queue (name, name + ":queue", 1024);
+
+  pid_t pid = ::fork ();
+
+  if (pid == 0)
+  {
+    Queue client (name, name + ":queue");
+
+    int32_t lease = -1;
+
+    client.doorbell ().arm (lease);
+
+    ::_exit (lease >= 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  BOOST_REQUIRE (pid > 0);
+
+  int status = 0;
+
+  BOOST_REQUIRE_EQUAL (::waitpid (pid, &status, 0), pid);
+  BOOST_REQUIRE (WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS);
+
+  BOOST_CHECK_EQUAL (queue.doorbell ().waiters (), 1);
+
+  Header header;
+  std::vector<uint8_t> data (8);
+
+  header.seqNum = 1;
+  header.size   = data.size ();
+
+  BOOST_REQUIRE (queue.push (header, data));
+
+  BOOST_CHECK_EQUAL (queue.doorbell ().waiters (), 0);
+}
+
+BOOST_AUTO_TEST_CASE (SPSCQueuePushVector)
+{
+  ScopedLogLevel log (error);
+
+  boost::lockfree::spsc_queue<uint8_t> queue (100);
+  size_t payloadSize = 40;
+  const std::vector<uint8_t> empty (payloadSize, 0);
+
+  std::vector<uint8_t> payloadIn = empty;
+  std::vector<uint8_t> payloadOut = empty;
+  std::iota (std::begin (payloadIn), std::end (payloadIn), 1);
+
+  for (uint64_t i = 1; i < 10; ++i)
+  {
+    bool success = queue.push (payloadIn.data (), payloadIn.size ());
+    BOOST_CHECK (success);
+
+    success = queue.pop (payloadOut.data (), payloadSize);
+    BOOST_CHECK (success);
+
+    BOOST_CHECK (payloadIn == payloadOut);
+
+    payloadOut = empty;
+  }
+}
+
+
+#if PREFETCH_FIXED
+
+BOOST_AUTO_TEST_CASE (ConsumerPrefetchSmallerThanMessageSize)
+{
+  ScopedLogLevel log (error);
+
+  SPMCQueue<std::allocator<uint8_t>> queue (1024);
+  queue.register_consumer ();
+
+  size_t payloadSize = 128;
+
+  Header headerIn;
+  headerIn.version = 1;
+  headerIn.type = 2;
+  headerIn.size = payloadSize;
+  headerIn.seqNum = 1;
+  headerIn.timestamp = nanoseconds_since_epoch (Clock::now ());
+
+  std::vector<uint8_t> payloadIn (payloadSize);
+  std::iota (std::begin (payloadIn), std::end (payloadIn), 1);
+
+  BOOST_CHECK (queue.push (headerIn, payloadIn)); ++headerIn.seqNum;
+  bool success = queue.push (headerIn, payloadIn);  ++headerIn.seqNum;
+  BOOST_CHECK (success);
+
+  Header headerOut;
+  std::vector<uint8_t> payloadOut;
+  success = queue.pop (headerOut, payloadOut);
+  BOOST_CHECK (success);
+  BOOST_CHECK_EQUAL (headerOut.seqNum, 1);
+  BOOST_CHECK (payloadIn == payloadOut);
+  payloadOut.clear ();
+
+  BOOST_CHECK (!queue.cache_enabled ());
+  /*
+   * The next call to pop should fail as the cache size is too small.
+   *
+   * The cache should be disabled at this point and consuming continues without
+   * the use of the cache.
+   */
+  queue.resize_cache (50);
+  BOOST_CHECK (queue.cache_enabled ());
+  success = queue.pop (headerOut, payloadOut);
+
+  BOOST_CHECK (success);
+  BOOST_CHECK (!queue.cache_enabled ());
+
+  BOOST_CHECK_EQUAL (headerOut.seqNum, 2);
+  BOOST_CHECK (payloadIn == payloadOut);
+  payloadOut.clear ();
+
+  BOOST_CHECK (!queue.pop (headerOut, payloadOut));
+
+  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
+  BOOST_CHECK (success);
+
+  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
+  BOOST_CHECK (success);
+
+  BOOST_CHECK (queue.pop (headerOut, payloadOut));
+  BOOST_CHECK_EQUAL (headerOut.seqNum, 3);
+  BOOST_CHECK (payloadIn == payloadOut);
+
+  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
+  BOOST_CHECK (success);
+  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
+  BOOST_CHECK (success);
+  success = queue.push (headerIn, payloadIn); ++headerIn.seqNum;
+  BOOST_CHECK (success);
+
+  success = queue.pop (headerOut, payloadOut);
+  BOOST_CHECK (success);
+  BOOST_CHECK_EQUAL (headerOut.seqNum, 4);
+  BOOST_CHECK (payloadIn == payloadOut);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE (SlowConsumerNoMessageDrops)
+{
+  ScopedLogLevel log (error);
+
+  SPMCQueue<std::allocator<uint8_t>> queue (150);
+
+  detail::ConsumerState consumer;
+  queue.register_consumer (consumer);
+
+  const size_t payloadSize = 8;
+
+  Header headerProducer;
+  headerProducer.version = 1;
+  headerProducer.type = STANDARD_MESSAGE_TYPE;
+  headerProducer.size = payloadSize;
+  headerProducer.seqNum = 1;
+  headerProducer.timestamp = nanoseconds_since_epoch (Clock::now ());
+
+  std::vector<uint8_t> payloadProducer (payloadSize, 0);
+  std::iota (std::begin (payloadProducer), std::end (payloadProducer), 1);
+
+  Header header;
+  std::vector<uint8_t> payload;
+  /*
+   * The first call to pop initialises the consumer and ensures it is ready to
+   * start consuming from the next message to arrive
+   */
+  BOOST_CHECK_EQUAL (queue.pop (header, payload, consumer), false);
+
+  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), true); // commit=40
+  BOOST_CHECK_EQUAL (queue.pop (header, payload, consumer), true); // consumed=40
+
+  BOOST_CHECK_EQUAL (header.version,    headerProducer.version);
+  BOOST_CHECK_EQUAL (header.type,       headerProducer.type);
+  BOOST_CHECK_EQUAL (header.timestamp,  headerProducer.timestamp);
+  BOOST_CHECK_EQUAL (payload.size (), payloadSize);
+  BOOST_CHECK (payload == payloadProducer);
+
+  // send enough data to wrap the buffer and exert back pressure on the producer
+  ++headerProducer.seqNum;
+  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), true); // commit=80
+
+  ++headerProducer.seqNum;
+  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), true); // commit=120
+
+  ++headerProducer.seqNum;
+  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), false);
+
+  BOOST_CHECK_EQUAL (queue.push (headerProducer, payloadProducer), false);
+
+  BOOST_CHECK (queue.pop (header, payload, consumer));
+  BOOST_CHECK (payloadProducer == payload);
+
+  headerProducer.seqNum = 123;
+  BOOST_CHECK (queue.push (headerProducer, payloadProducer));
+  BOOST_CHECK (payloadProducer == payload);
+
+  BOOST_CHECK_EQUAL (queue.pop (header, payload, consumer), true);
+  BOOST_CHECK_EQUAL (header.version,    headerProducer.version);
+  BOOST_CHECK_EQUAL (header.type,       headerProducer.type);
+  BOOST_CHECK_EQUAL (header.timestamp,  headerProducer.timestamp);
+  BOOST_CHECK_EQUAL (header.seqNum,     3);
+  BOOST_CHECK (payloadProducer == payload);
+
+  BOOST_CHECK_EQUAL (queue.pop (header, payload, consumer), true);
+  BOOST_CHECK_EQUAL (header.version,    headerProducer.version);
+  BOOST_CHECK_EQUAL (header.type,       headerProducer.type);
+  BOOST_CHECK_EQUAL (header.timestamp,  headerProducer.timestamp);
+  BOOST_CHECK_EQUAL (header.seqNum,     123);
+  BOOST_CHECK (payloadProducer == payload);
+}
+
+BOOST_AUTO_TEST_CASE (SlowConsumerMessageDrops)
+{
+  ScopedLogLevel log (error);
+
+  SPMCQueue<std::allocator<uint8_t>> queue (150);
+
+  detail::ConsumerState consumer (ConsumerMode::Drop);
+  queue.register_consumer (consumer);
+
+  Header headerProducer;
+  headerProducer.size   = 8;
+  headerProducer.seqNum = 1;
+
+  std::vector<uint8_t> payloadProducer (headerProducer.size, 1);
+
+  Header header;
+  std::vector<uint8_t> payload;
+
+  BOOST_CHECK (queue.push (headerProducer, payloadProducer));
+  BOOST_CHECK (queue.pop (header, payload, consumer));
+  BOOST_CHECK_EQUAL (header.seqNum, 1);
+  /*
+   * A Drop consumer exerts no back-pressure so the producer can lap it
+   */
+  for (size_t i = 0; i < 10; ++i)
+  {
+    ++headerProducer.seqNum;
+    BOOST_CHECK (queue.push (headerProducer, payloadProducer));
+  }
+  /*
+   * The overwritten data is detected and the consumer skips to the latest data
+   */
+  BOOST_CHECK (!queue.pop (header, payload, consumer));
+
+  ++headerProducer.seqNum;
+  BOOST_CHECK (queue.push (headerProducer, payloadProducer));
+
+  BOOST_CHECK (queue.pop (header, payload, consumer));
+  BOOST_CHECK_EQUAL (header.seqNum, 12);
+  BOOST_CHECK (payload == payloadProducer);
+
+  BOOST_CHECK_EQUAL (consumer.dropped (), 10);
+
+  queue.unregister_consumer (consumer);
+}
+
+BOOST_AUTO_TEST_CASE (ThreadedDropConsumerReadsValidData)
+{
+  ScopedLogLevel log (error);
+
+  SPMCQueue<std::allocator<uint8_t>> queue (256);
+
+  const uint64_t messages = 200000;
+
+  std::atomic<bool> ready = { false };
+  std::atomic<bool> done  = { false };
+
+  uint64_t received = 0;
+  uint64_t dropped  = 0;
+  bool     valid    = true;
+
+  std::thread consumerThread ([&] () {
+
+    detail::ConsumerState consumer (ConsumerMode::Drop);
+    queue.register_consumer (consumer);
+
+    ready = true;
+
+    Header header;
+    std::vector<uint8_t> payload;
+
+    uint64_t seqNum = 0;
+
+    while (!done || !queue.empty (consumer))
+    {
+      if (queue.pop (header, payload, consumer))
+      {
+        /*
+         * Data is never torn, even when the producer overwrites it
+         */
+        valid = valid && (header.seqNum > seqNum) &&
+                std::all_of (payload.begin (), payload.end (),
+                  [&header] (uint8_t v) {
+                    return v == static_cast<uint8_t> (header.seqNum); });
+
+        seqNum = header.seqNum;
+        ++received;
+      }
+      else
+      {
+        std::this_thread::yield ();
+      }
+    }
+
+    dropped = consumer.dropped ();
+
+    queue.unregister_consumer (consumer);
+  });
+
+  while (!ready)
+  { }
+
+  Header header;
+  std::vector<uint8_t> payload (24);
+
+  for (uint64_t i = 1; i <= messages; ++i)
+  {
+    header.size   = payload.size ();
+    header.seqNum = i;
+
+    std::fill (payload.begin (), payload.end (), static_cast<uint8_t> (i));
+
+    BOOST_REQUIRE (queue.push (header, payload));
+    /*
+     * Give the consumer a chance to run on machines with few cores
+     */
+    if (i % 4 == 0)
+    {
+      std::this_thread::yield ();
+    }
+  }
+
+  done = true;
+
+  consumerThread.join ();
+
+  BOOST_CHECK (valid);
+  BOOST_CHECK (received > 0);
+  BOOST_CHECK (received + dropped <= messages);
+}
+
+template <class Queue>
+class Server : boost::noncopyable
+{
+public:
+  Server (Queue &queue, size_t size, uint32_t rate)
+  : m_data (size, 0),
+    m_throttle (rate)
+  {
+    std::iota (std::begin (m_data), std::end (m_data), 1);
+
+    m_thread = std::thread ([this, &queue]() {
+
+      uint64_t seqNum = 0;
+
+      Header   header;
+      header.size = m_data.size ();
+
+      m_ready = true;
+
+      while (!m_stop)
+      {
+        header.seqNum    = ++seqNum;
+        header.timestamp = nanoseconds_since_epoch (Clock::now ());
+
+        while (!queue.push (header, m_data) && !m_stop)
+        { }
+
+        m_throttle.throttle ();
+      }
+    });
+  }
+
+  ~Server ()
+  {
+    m_stop = true;
+
+    m_thread.join ();
+  }
+
+  bool ready () { return m_ready; }
+  void stop ()  { m_stop = true; m_ready   = false; }
+  void pause (bool pause) { m_pause   = pause; }
+  void sendOne ()         { m_sendOne = true;  }
+
+  const std::vector<uint8_t> &data () { return m_data; }
+
+private:
+  std::vector<uint8_t> m_data;
+
+  std::atomic<bool> m_stop  = { false };
+  std::atomic<bool> m_ready = { false };
+  std::atomic<bool> m_pause = { true  };
+  std::atomic<bool> m_sendOne = { false  };
+  Throttle          m_throttle;
+  std::thread       m_thread;
+
+};
+
+template <class Queue>
+class Client : boost::noncopyable
+{
+public:
+  Client (Queue &queue, size_t dataSize)
+  : m_queue (queue)
+  {
+    m_data.resize (dataSize);
+
+    m_thread = std::thread ([this] () {
+
+      try
+      {
+        m_queue.register_consumer (m_consumer);
+
+        auto &throughput =  m_stats.throughput ().summary ();
+        auto &latency    =  m_stats.latency ().summary ();
+
+        Header header;
+
+        m_ready = true;
+
+        while (!m_stop)
+        {
+          if (m_queue.pop (header, m_data, m_consumer))
+          {
+            throughput.next (sizeof (header) + m_data.size (), header.seqNum);
+
+            latency.next ({ Clock::now () -
+                  timepoint_from_nanoseconds_since_epoch (header.timestamp) });
+          }
+        }
+       /*
+        * Notifying the queue of a consumer exiting should occur from the thread
+        * context of the consumer.
+        *
+        * Failure to do this will prevent the consumer slot from being reused.
+        */
+        m_queue.unregister_consumer (m_consumer);
+      }
+      catch (const std::exception &e)
+      {
+        m_stop = true;
+
+        m_exceptions.push_back (std::string (e.what ()));
+      }
+    });
+  }
+
+  ~Client ()
+  {
+    m_stop = true;
+
+    m_thread.join ();
+  }
+
+  bool ready () const { return m_ready; }
+
+  void stop () { m_stop = true; m_ready = false;}
+
+  const std::vector<uint8_t> &data () const { return m_data; }
+
+  const PerformanceStats &stats ()    const { return m_stats;    }
+
+  std::vector<std::string> &exceptions () { return m_exceptions; }
+
+private:
+
+  std::atomic<bool> m_ready = { false };
+
+  Queue &m_queue;
+
+  detail::ConsumerState m_consumer;
+
+  std::vector<uint8_t> m_data;
+
+  std::atomic<bool> m_stop = { false };
+
+  std::thread m_thread;
+
+  PerformanceStats m_stats;
+
+  std::vector<std::string> m_exceptions;
+};
+
+using TestServer = Server<SPMCQueue<std::allocator<uint8_t>>>;
+using TestClient = Client<SPMCQueue<std::allocator<uint8_t>>>;
+
+BOOST_AUTO_TEST_CASE (ThreadedProducerSingleConsumer)
+{
+  ScopedLogLevel log (error);
+
+  SPMCQueue<std::allocator<uint8_t>> queue (1024*1024*100);
+#if CACHE_SIZE_ENABLED // re-enable prefetch functionality
+
+  queue.resize_cache (1024);
+#endif
+
+  size_t   messageSize = 32+sizeof (Header);  // typical BBA message size
+  uint32_t throughput  = 100e3;   // 100K message/sec
+
+  TestServer server (queue, messageSize, throughput);
+
+  while (!server.ready ())
+  {
+    std::this_thread::sleep_for (1ms);
+  }
+
+  TestClient client (queue, messageSize);
+
+  std::this_thread::sleep_for (get_test_duration ().nanoseconds ());
+
+  BOOST_CHECK_EQUAL (client.data ().size (), server.data ().size ());
+  for (size_t i = 0; i < server.data ().size (); ++i)
+  {
+    BOOST_CHECK_EQUAL (client.data ()[i], server.data ()[i]);
+  }
+
+  // test throughput against a relatively conservative value
+  auto &summary = client.stats ().throughput ().summary ();
+  BOOST_CHECK (summary.messages () > 100);
+
+  BOOST_TEST_MESSAGE ("throughput:\t" << summary.to_string ());
+}
+
+
+BOOST_AUTO_TEST_CASE (ThreadedProducerMultiConsumerNoMesssage)
+{
+  ScopedLogLevel log (error);
+
+  SPMCQueue<std::allocator<uint8_t>> queue (1024*1024);
+
+  size_t messageSize = 32;
+  uint32_t throughput = 1e6;
+
+  TestServer server (queue, messageSize, throughput);
+
+  // allow the server to initialise
+  while (!server.ready ())
+  {
+    std::this_thread::sleep_for (1ms);
+  }
+
+  const int clientCount = 2;
+  std::vector<std::unique_ptr<TestClient>> clients;
+
+  for (int i = 0; i < clientCount; ++i)
+  {
+    auto client = std::make_unique<TestClient> (queue, messageSize);
+
+    while (!client->ready ())
+    {
+      std::this_thread::sleep_for (1ms);
+    }
+
+    clients.push_back (std::move (client));
+  }
+
+  BOOST_TEST_MESSAGE ("server throughput:\t" << throughput);
+  BOOST_TEST_MESSAGE ("message size:\t\t"    << messageSize);
+
+  std::this_thread::sleep_for (get_test_duration ().nanoseconds ());
+
+  server.stop ();
+  for (auto &client : clients)
+  {
+    client->stop ();
+  }
+
+  auto print = [] (const PerformanceStats& stats) {
+    BOOST_TEST_MESSAGE (" throughput:\t\t"
+      << stats.throughput ().summary ().to_string ());
+  };
+
+  for (auto &client : clients)
+  {
+    auto &stats = client->stats ();
+
+    // test throughput against a relatively conservative value
+    BOOST_CHECK ((stats.throughput ().summary ()
+                       .messages_per_sec () / 1.0e6) > .8);
+
+    BOOST_TEST_MESSAGE ("client");
+    print (stats);
+  }
+
+  BOOST_TEST_MESSAGE("\nlatency stats for one of the clients");
+
+  auto &latencies = clients.back ()->stats ().latency ().summary ();
+
+  for (auto line : latencies.to_strings ())
+  {
+    BOOST_TEST_MESSAGE (line);
+  }
+}
+
+template <class Queue>
+class Client2 : boost::noncopyable
+{
+public:
+  Client2 (Queue &queue, size_t dataSize)
+  {
+    m_thread = std::thread ([this, dataSize, &queue] () {
+
+      try
+      {
+        SPMCSink<Queue> sink (queue);
+        std::vector<uint8_t> data (dataSize);
+
+        auto &throughput =  m_stats.throughput ().summary ();
+        auto &latency    =  m_stats.latency ().summary ();
+
+        Header header;
+
+        while (!m_stop)
+        {
+          if (sink.next (header, data))
+          {
+            throughput.next (sizeof (header) + data.size (), header.seqNum);
+
+            latency.next ({ Clock::now () -
+                  timepoint_from_nanoseconds_since_epoch (header.timestamp) });
+          }
+        }
+      }
+      catch (const std::exception &e)
+      {
+        m_stop = true;
+
+        m_exceptions.push_back (std::string (e.what ()));
+      }
+    });
+  }
+
+  ~Client2 ()
+  {
+    m_stop = true;
+
+    m_thread.join ();
+  }
+
+  void stop () { m_stop = true; }
+
+  const PerformanceStats &stats () const { return m_stats; }
+
+  std::vector<std::string> &exceptions () { return m_exceptions; }
+
+private:
+
+  std::unique_ptr<SPMCSink<Queue>> m_sink;
+
+  std::atomic<bool> m_stop = { false };
+
+  std::thread m_thread;
+
+  PerformanceStats m_stats;
+
+  std::vector<std::string> m_exceptions;
+};
+
+BOOST_AUTO_TEST_CASE (TooManyConsumers)
+{
+  ScopedLogLevel log (error);
+
+  /*
+   * Set the maximum number of consumers to be two
+   */
+  const size_t maxClients = 2;
+
+  using QueueType  = SPMCQueue<std::allocator<uint8_t>, maxClients>;
+  using ClientType = Client<QueueType>;
+
+  std::vector<std::unique_ptr<ClientType>> clients;
+
+  QueueType queue (1024*1024*10);
+
+  size_t messageSize  = 128;
+  uint32_t throughput = 1e6;
+
+  // Add the maximum number of clients
+  clients.push_back (std::move (std::make_unique<ClientType>(queue, messageSize)));
+  clients.push_back (std::move (std::make_unique<ClientType>(queue, messageSize)));
+
+  Server<QueueType> server (queue, messageSize, throughput);
+
+  BOOST_TEST_MESSAGE ("Expected server throughput:\t" << throughput);
+  BOOST_TEST_MESSAGE ("Expected message size:\t\t"    << messageSize);
+
+  // allow the clients to initialise
+  std::this_thread::sleep_for (Milliseconds (100));
+
+  BOOST_CHECK_EQUAL (clients.size (), 2);
+  {
+    BOOST_TEST_MESSAGE ("Add one client too many");
+    /*
+     * An exception should be thrown when registering more clients than the
+     * queue is configured to accept.
+     *
+     * For the purposes of this test the exception is stored in an exception
+     * pointer stored in the ClientType.
+     */
+
+    ClientType client (queue, messageSize);
+
+    std::this_thread::sleep_for (Seconds (2));
+
+    BOOST_CHECK_MESSAGE (client.exceptions ().size () == 1,
+                         "An expected exception was not thrown");
+
+    client.exceptions ().clear ();
+
+    BOOST_CHECK_EQUAL (clients.size (), 2);
+
+    client.stop ();
+  }
+
+  // stop one of the clients to create room for a new client to be added
+  BOOST_TEST_MESSAGE ("Stop one of the clients, to free space for a new client");
+  clients.resize (clients.size () -1);
+
+  std::this_thread::sleep_for (Milliseconds (10));
+
+  BOOST_TEST_MESSAGE ("Create and add a new client");
+  ClientType client (queue, messageSize);
+
+  std::this_thread::sleep_for (Milliseconds (10));
+
+  BOOST_CHECK (client.exceptions ().empty ());
+
+  std::this_thread::sleep_for (Milliseconds (10));
+
+  BOOST_TEST_MESSAGE ("Stop all clients: " <<  clients.size ());
+
+  for (auto &client : clients)
+  {
+    client->stop ();
+  }
+
+  BOOST_TEST_MESSAGE ("Stop server");
+
+  server.stop ();
+}
+
+/*
+ * The number of NoDrop consumers is set at runtime and may exceed the default
+ */
+BOOST_AUTO_TEST_CASE (RuntimeConsumerCapacity)
+{
+  ScopedLogLevel log (error);
+
+  const uint8_t maxConsumers = 40;
+
+  SPMCQueue<std::allocator<uint8_t>> queue (1024, maxConsumers);
+
+  BOOST_CHECK_EQUAL (queue.consumer_capacity (), maxConsumers);
+
+  std::vector<detail::ConsumerState> consumers (maxConsumers);
+
+  for (auto &consumer : consumers)
+  {
+    queue.register_consumer (consumer);
+  }
+
+  detail::ConsumerState extra;
+  BOOST_CHECK_THROW (queue.register_consumer (extra), std::exception);
+
+  Header headerIn, headerOut;
+  std::vector<uint8_t> in (64), out;
+
+  headerIn.size = in.size ();
+
+  size_t pushed = 0;
+  while (queue.push (headerIn, in))
+  {
+    ++pushed;
+  }
+
+  BOOST_REQUIRE (pushed > 0);
+  /*
+   * All but the last consumer, which is in the last consumer group, catch up.
+   * The producer remains blocked by the slowest consumer.
+   */
+  for (size_t i = 0; i < consumers.size () - 1; ++i)
+  {
+    while (queue.pop (headerOut, out, consumers[i]))
+    { }
+  }
+
+  BOOST_CHECK (!queue.push (headerIn, in));
+
+  while (queue.pop (headerOut, out, consumers.back ()))
+  { }
+
+  BOOST_CHECK (queue.push (headerIn, in));
+
+  for (auto &consumer : consumers)
+  {
+    queue.unregister_consumer (consumer);
+  }
+}
+
+/*
+ * A consumer joining a consumer group which had no consumers when the producer
+ * last scanned it exerts back pressure on the producer
+ */
+BOOST_AUTO_TEST_CASE (ConsumerJoinsEmptyGroup)
+{
+  ScopedLogLevel log (error);
+
+  const uint8_t maxConsumers = 16;
+
+  SPMCQueue<std::allocator<uint8_t>> queue (1024, maxConsumers);
+
+  Header header;
+  std::vector<uint8_t> in (64), out;
+
+  header.size = in.size ();
+
+  detail::ConsumerState reader;
+
+  queue.register_consumer (reader);
+  /*
+   * The producer scans the groups while the second group is empty
+   */
+  uint64_t seqNum = 0;
+
+  for (size_t i = 0; i < 100; ++i)
+  {
+    header.seqNum = ++seqNum;
+
+    BOOST_REQUIRE (queue.push (header, in));
+    BOOST_REQUIRE (queue.pop (header, out, reader));
+  }
+  /*
+   * Fill the first group, so the next consumer joins the second group
+   */
+  std::vector<detail::ConsumerState> others (detail::CONSUMER_GROUP_SIZE);
+
+  for (auto &consumer : others)
+  {
+    queue.register_consumer (consumer);
+  }
+
+  BOOST_REQUIRE_EQUAL (others.back ().index (), detail::CONSUMER_GROUP_SIZE);
+
+  for (size_t i = 0; i < others.size () - 1; ++i)
+  {
+    queue.unregister_consumer (others[i]);
+  }
+
+  auto &joined = others.back ();
+  /*
+   * The producer is blocked by the consumer which joined the second group
+   */
+  uint64_t first = seqNum + 1;
+
+  header.seqNum = ++seqNum;
+
+  while (queue.push (header, in))
+  {
+    BOOST_REQUIRE (queue.pop (header, out, reader));
+
+    header.seqNum = ++seqNum;
+  }
+
+  BOOST_CHECK (seqNum - first > 0);
+  /*
+   * The consumer reads every message pushed since it joined
+   */
+  for (uint64_t expected = first; expected < seqNum; ++expected)
+  {
+    BOOST_REQUIRE (queue.pop (header, out, joined));
+    BOOST_CHECK_EQUAL (header.seqNum, expected);
+  }
+
+  BOOST_CHECK (!queue.pop (header, out, joined));
+
+  queue.unregister_consumer (joined);
+  queue.unregister_consumer (reader);
+}
+
+/*
+ * Restart the client consuming data from a server
+ */
+/*
+ * NoDrop consumers which stop reading are evicted so that the producer is not
+ * blocked forever
+ */
+BOOST_AUTO_TEST_CASE (EvictStalledConsumers)
+{
+  using namespace boost::interprocess;
+
+  ScopedLogLevel log (error);
+
+  Header header;
+  std::vector<uint8_t> in (24), out;
+
+  header.size = in.size ();
+  /*
+   * Push a message, retrying until the producer is no longer blocked
+   */
+  auto push = [&header, &in] (auto &queue) {
+
+    auto timeout = Clock::now () + Seconds (5);
+
+    while (!queue.push (header, in))
+    {
+      BOOST_REQUIRE (Clock::now () < timeout);
+    }
+  };
+  /*
+   * A consumer thread which stops reading for longer than the consumer lease is
+   * evicted and continues as a Drop consumer
+   */
+  {
+    SPMCQueue<std::allocator<uint8_t>> queue (1024);
+
+    queue.consumer_lease (Milliseconds (10));
+
+    detail::ConsumerState stalled, reader;
+
+    queue.register_consumer (stalled);
+    queue.register_consumer (reader);
+
+    for (uint64_t i = 1; i <= 100; ++i)
+    {
+      header.seqNum = i;
+
+      push (queue);
+
+      BOOST_REQUIRE (queue.pop (header, out, reader));
+      BOOST_CHECK_EQUAL (header.seqNum, i);
+    }
+
+    BOOST_CHECK_EQUAL (queue.evicted_consumers (), 1);
+    BOOST_CHECK (!reader.evicted ());
+
+    BOOST_CHECK (!queue.pop (header, out, stalled));
+    BOOST_CHECK (stalled.evicted ());
+    BOOST_CHECK (stalled.mode () == ConsumerMode::Drop);
+
+    header.seqNum = 101;
+
+    push (queue);
+
+    BOOST_REQUIRE (queue.pop (header, out, stalled));
+    BOOST_CHECK_EQUAL (header.seqNum, 101);
+
+    queue.unregister_consumer (stalled);
+    queue.unregister_consumer (reader);
+  }
+  /*
+   * A consumer process which exits without unregistering is evicted without a
+   * consumer lease
+   */
+  {
+    std::string name = "EvictStalledConsumers:Test";
+
+    struct RemoveSharedMemory
+    {
+      RemoveSharedMemory (const std::string & name) : name (name)
+      { shared_memory_object::remove (name.c_str ()); }
+
+      ~RemoveSharedMemory ()
+      { shared_memory_object::remove (name.c_str ()); }
+
+      std::string name;
+    } cleanup (name);
+
+    using Queue = SPMCQueue<SharedMemory::Allocator>;
+
+    Queue queue (name, name + ":queue", 1024);
+
+    pid_t pid = ::fork ();
+
+    if (pid == 0)
+    {
+      Queue client (name, name + ":queue");
+
+      detail::ConsumerState consumer;
+
+      client.register_consumer (consumer);
+
+      ::_exit (EXIT_SUCCESS);
+    }
+
+    BOOST_REQUIRE (pid > 0);
+
+    int status = 0;
+
+    BOOST_REQUIRE (::waitpid (pid, &status, 0) == pid);
+
+    for (uint64_t i = 1; i <= 100; ++i)
+    {
+      header.seqNum = i;
+
+      push (queue);
+    }
+
+    BOOST_CHECK_EQUAL (queue.evicted_consumers (), 1);
+  }
+}
+
+/*
+ * NoDrop consumers which lag beyond the lag policy are demoted to Drop
+ * consumers and report the messages they miss as dropped
+ */
+BOOST_AUTO_TEST_CASE (DemoteLaggingConsumers)
+{
+  ScopedLogLevel log (error);
+
+  Header header;
+  std::vector<uint8_t> in (24), out;
+
+  header.size = in.size ();
+  /*
+   * A consumer lagging by more than maxLag bytes is demoted without the
+   * producer being blocked
+   */
+  {
+    SPMCQueue<std::allocator<uint8_t>> queue (1024);
+
+    LagPolicy policy;
+    policy.maxLag = 256;
+
+    queue.lag_policy (policy);
+
+    detail::ConsumerState lagging, reader;
+
+    queue.register_consumer (lagging);
+    queue.register_consumer (reader);
+
+    for (uint64_t i = 1; i <= 100; ++i)
+    {
+      header.seqNum = i;
+
+      BOOST_REQUIRE (queue.push (header, in));
+      BOOST_REQUIRE (queue.pop (header, out, reader));
+
+      if (i == 1)
       {
-        header.seqNum    = ++seqNum;
-        header.timestamp = nanoseconds_since_epoch (Clock::now ());
+        BOOST_REQUIRE (queue.pop (header, out, lagging));
+      }
+    }
 
-        while (!queue.push (header, m_data) && !m_stop)
-        { }
+    BOOST_CHECK_EQUAL (queue.evicted_consumers (), 1);
+    BOOST_CHECK (!reader.evicted ());
 
-        m_throttle.throttle ();
+    /*
+     * The demoted consumer skips the overwritten messages to the latest data
+     */
+    BOOST_CHECK (!queue.pop (header, out, lagging));
+    BOOST_CHECK (lagging.evicted ());
+    BOOST_CHECK (lagging.mode () == ConsumerMode::Drop);
+
+    header.seqNum = 101;
+
+    BOOST_REQUIRE (queue.push (header, in));
+
+    BOOST_REQUIRE (queue.pop (header, out, lagging));
+    BOOST_CHECK_EQUAL (header.seqNum, 101);
+    BOOST_CHECK_EQUAL (lagging.dropped (), 99);
+
+    queue.unregister_consumer (lagging);
+    queue.unregister_consumer (reader);
+  }
+  /*
+   * The consumers blocking the producer for longer than maxBlocked are demoted
+   */
+  {
+    SPMCQueue<std::allocator<uint8_t>> queue (1024);
+
+    LagPolicy policy;
+    policy.maxBlocked = Milliseconds (5);
+
+    queue.lag_policy (policy);
+
+    detail::ConsumerState stalled;
+
+    queue.register_consumer (stalled);
+
+    auto timeout = Clock::now () + Seconds (5);
+
+    for (uint64_t i = 1; i <= 100; ++i)
+    {
+      header.seqNum = i;
+
+      while (!queue.push (header, in))
+      {
+        BOOST_REQUIRE (Clock::now () < timeout);
       }
-    });
+    }
+
+    BOOST_CHECK_EQUAL (queue.evicted_consumers (), 1);
+
+    queue.unregister_consumer (stalled);
   }
+}
 
-  ~Server ()
+/*
+ * Consumers reading in place detect being demoted by the producer while holding
+ * a view or draining, and continue as Drop consumers reading copies
+ */
+BOOST_AUTO_TEST_CASE (DemoteConsumerReadingInPlace)
+{
+  ScopedLogLevel log (error);
+
+  Header header;
+  std::vector<uint8_t> in (24), out;
+
+  header.size = in.size ();
+
+  LagPolicy policy;
+  policy.maxLag = 256;
+  /*
+   * A view overwritten after the consumer was demoted is not released as valid
+   */
   {
-    m_stop = true;
+    SPMCQueue<std::allocator<uint8_t>> queue (1024);
 
-    m_thread.join ();
+    queue.lag_policy (policy);
+
+    detail::ConsumerState viewer, reader;
+
+    queue.register_consumer (viewer);
+    queue.register_consumer (reader);
+
+    ReadView view;
+
+    header.seqNum = 1;
+
+    BOOST_REQUIRE (queue.push (header, in));
+    BOOST_REQUIRE (queue.pop (header, out, reader));
+
+    BOOST_REQUIRE (queue.read_view (view, viewer));
+    BOOST_CHECK_EQUAL (view.header.seqNum, 1);
+    BOOST_CHECK (!view.copied);
+
+    for (uint64_t i = 2; i <= 100; ++i)
+    {
+      header.seqNum = i;
+
+      BOOST_REQUIRE (queue.push (header, in));
+      BOOST_REQUIRE (queue.pop (header, out, reader));
+    }
+
+    BOOST_CHECK_EQUAL (queue.evicted_consumers (), 1);
+    BOOST_CHECK (!queue.release (view, viewer));
+    /*
+     * The demoted consumer skips the overwritten messages and reads copies
+     */
+    BOOST_CHECK (!queue.read_view (view, viewer));
+    BOOST_CHECK (viewer.mode () == ConsumerMode::Drop);
+
+    header.seqNum = 101;
+
+    BOOST_REQUIRE (queue.push (header, in));
+
+    BOOST_REQUIRE (queue.read_view (view, viewer));
+    BOOST_CHECK_EQUAL (view.header.seqNum, 101);
+    BOOST_CHECK_EQUAL (view.size, in.size ());
+    BOOST_CHECK (view.copied);
+    BOOST_CHECK (queue.release (view, viewer));
+    BOOST_CHECK_EQUAL (viewer.dropped (), 99);
+
+    BOOST_CHECK (!queue.read_view (view, viewer));
+
+    queue.unregister_consumer (viewer);
+    queue.unregister_consumer (reader);
+  }
+  /*
+   * Draining stops after a payload overwritten during the callback
+   */
+  {
+    SPMCQueue<std::allocator<uint8_t>> queue (1024);
+
+    queue.lag_policy (policy);
+
+    detail::ConsumerState drainer, reader;
+
+    queue.register_consumer (drainer);
+    queue.register_consumer (reader);
+
+    for (uint64_t i = 1; i <= 4; ++i)
+    {
+      header.seqNum = i;
+
+      BOOST_REQUIRE (queue.push (header, in));
+      BOOST_REQUIRE (queue.pop (header, out, reader));
+    }
+
+    std::vector<uint64_t> drained;
+
+    auto callback = [&] (const Header &drainedHeader, const uint8_t *, size_t) {
+
+      drained.push_back (drainedHeader.seqNum);
+
+      for (uint64_t i = 5; i <= 100; ++i)
+      {
+        header.seqNum = i;
+
+        BOOST_REQUIRE (queue.push (header, in));
+        BOOST_REQUIRE (queue.pop (header, out, reader));
+      }
+    };
+
+    BOOST_CHECK_EQUAL (queue.drain (callback, 10, drainer), 1);
+    BOOST_CHECK (drained == std::vector<uint64_t> { 1 });
+    BOOST_CHECK (drainer.mode () == ConsumerMode::Drop);
+
+    queue.unregister_consumer (drainer);
+    queue.unregister_consumer (reader);
   }
+}
 
-  bool ready () { return m_ready; }
-  void stop ()  { m_stop = true; m_ready   = false; }
-  void pause (bool pause) { m_pause   = pause; }
-  void sendOne ()         { m_sendOne = true;  }
+/*
+ * Consumers reading in place do not use headers overwritten by the producer
+ * after reading the previous message, when the data range of the consumer
+ * still covers the overwritten messages
+ */
+BOOST_AUTO_TEST_CASE (OverwrittenBetweenReadsInPlace)
+{
+  ScopedLogLevel log (error);
 
-  const std::vector<uint8_t> &data () { return m_data; }
+  enum class Read { Pop, View, Drain };
 
-private:
-  std::vector<uint8_t> m_data;
+  LagPolicy policy;
+  policy.maxLag = 256;
 
-  std::atomic<bool> m_stop  = { false };
-  std::atomic<bool> m_ready = { false };
-  std::atomic<bool> m_pause = { true  };
-  std::atomic<bool> m_sendOne = { false  };
-  Throttle          m_throttle;
-  std::thread       m_thread;
+  for (Read read : { Read::Pop, Read::View, Read::Drain })
+  {
+    SPMCQueue<std::allocator<uint8_t>> queue (1024);
 
-};
+    queue.lag_policy (policy);
 
-template <class Queue>
-class Client : boost::noncopyable
+    detail::ConsumerState consumer, reader;
+
+    queue.register_consumer (consumer);
+    queue.register_consumer (reader);
+
+    Header header;
+    std::vector<uint8_t> in (24), out;
+
+    std::vector<uint64_t> drained;
+
+    auto callback = [&] (const Header &drainedHeader, const uint8_t *, size_t) {
+
+      drained.push_back (drainedHeader.seqNum);
+    };
+
+    auto read_one = [&] () {
+
+      ReadView view;
+
+      switch (read)
+      {
+        case Read::Pop:
+          return queue.pop (header, out, consumer);
+
+        case Read::View:
+          if (!queue.read_view (view, consumer))
+          {
+            return false;
+          }
+
+          header = view.header;
+
+          return queue.release (view, consumer);
+
+        case Read::Drain:
+          drained.clear ();
+
+          if (queue.drain (callback, 1, consumer) == 0)
+          {
+            return false;
+          }
+
+          header.seqNum = drained.back ();
+
+          return true;
+      }
+
+      return false;
+    };
+
+    header.size = in.size ();
+
+    for (uint64_t i = 1; i <= 4; ++i)
+    {
+      header.seqNum = i;
+
+      BOOST_REQUIRE (queue.push (header, in));
+      BOOST_REQUIRE (queue.pop (header, out, reader));
+    }
+    /*
+     * The data range of the consumer covers the four messages
+     */
+    BOOST_REQUIRE (read_one ());
+    BOOST_CHECK_EQUAL (header.seqNum, 1);
+    /*
+     * The producer evicts the consumer and overwrites its remaining messages
+     * with larger messages, so the old header positions fall in payloads
+     * whose bytes are not a valid size
+     */
+    std::vector<uint8_t> overwrite (40, 0xff);
+
+    header.size = overwrite.size ();
+
+    for (uint64_t i = 5; i <= 100; ++i)
+    {
+      header.seqNum = i;
+
+      BOOST_REQUIRE (queue.push (header, overwrite));
+      BOOST_REQUIRE (queue.pop (header, out, reader));
+    }
+
+    BOOST_CHECK_EQUAL (queue.evicted_consumers (), 1);
+    /*
+     * The consumer is demoted and skips the overwritten messages
+     */
+    BOOST_CHECK (!read_one ());
+    BOOST_CHECK (consumer.mode () == ConsumerMode::Drop);
+
+    header.seqNum = 101;
+
+    BOOST_REQUIRE (queue.push (header, overwrite));
+
+    BOOST_REQUIRE (read_one ());
+    BOOST_CHECK_EQUAL (header.seqNum, 101);
+
+    queue.unregister_consumer (consumer);
+    queue.unregister_consumer (reader);
+  }
+}
+
+/*
+ * The queue metrics report the producer and consumer progress, and can be read
+ * from a queue opened read-only
+ */
+BOOST_AUTO_TEST_CASE (ReadQueueMetrics)
 {
-public:
-  Client (Queue &queue, size_t dataSize)
-  : m_queue (queue)
+  using namespace boost::interprocess;
+
+  ScopedLogLevel log (error);
+
+  Header header;
+  std::vector<uint8_t> in (24), out;
+
+  header.size = in.size ();
+
+  const size_t messageSize = sizeof (Header) + in.size ();
+
+  std::string name = "QueueMetrics:Test";
+
+  struct RemoveSharedMemory
+  {
+    RemoveSharedMemory (const std::string & name) : name (name)
+    { shared_memory_object::remove (name.c_str ()); }
+
+    ~RemoveSharedMemory ()
+    { shared_memory_object::remove (name.c_str ()); }
+
+    std::string name;
+  } cleanup (name);
+
+  using Queue = SPMCQueue<SharedMemory::Allocator>;
+
+  Queue queue (name, name + ":queue", 1024);
+
+  Queue monitor (name, name + ":queue", open_read_only);
+
+  detail::ConsumerState consumer, dropping (ConsumerMode::Drop);
+
+  queue.register_consumer (consumer);
+  queue.register_consumer (dropping);
+  /*
+   * Fill the queue, the NoDrop consumer reading only the first message
+   */
+  uint64_t seqNum = 0;
+
+  header.seqNum = ++seqNum;
+
+  BOOST_REQUIRE (queue.push (header, in));
+  BOOST_REQUIRE (queue.pop (header, out, consumer));
+  BOOST_REQUIRE (queue.pop (header, out, dropping));
+
+  header.seqNum = ++seqNum;
+
+  while (queue.push (header, in))
+  {
+    header.seqNum = ++seqNum;
+  }
+
+  /*
+   * Publish the progress of the NoDrop consumer
+   */
+  BOOST_REQUIRE (queue.pop (header, out, consumer));
+
+  auto metrics = monitor.metrics ();
+
+  BOOST_CHECK_EQUAL (metrics.published, seqNum - 1);
+  BOOST_CHECK_EQUAL (metrics.committed, (seqNum - 1) * messageSize);
+  BOOST_CHECK_EQUAL (metrics.stalls, 1);
+  BOOST_CHECK_EQUAL (metrics.evictions, 0);
+  BOOST_REQUIRE_EQUAL (metrics.consumers.size (), 1);
+  BOOST_CHECK_EQUAL (metrics.consumers[0].pid, ::getpid ());
+  BOOST_CHECK_EQUAL (metrics.consumers[0].consumed, 1);
+  BOOST_CHECK_EQUAL (metrics.consumers[0].consumedBytes, messageSize);
+  BOOST_CHECK_EQUAL (metrics.consumers[0].lag,
+                     metrics.committed - messageSize);
+  /*
+   * Overwrite the data of the Drop consumer. The messages it skips are counted
+   * once it reads the next message.
+   */
+  while (queue.pop (header, out, consumer))
   {
-    m_data.resize (dataSize);
+  }
 
-    m_thread = std::thread ([this] () {
+  for (size_t i = 0; i < 10; ++i)
+  {
+    header.seqNum = seqNum++;
 
-      try
-      {
-        m_queue.register_consumer (m_consumer);
+    BOOST_REQUIRE (queue.push (header, in));
+  }
 
-        auto &throughput =  m_stats.throughput ().summary ();
-        auto &latency    =  m_stats.latency ().summary ();
+  BOOST_CHECK (!queue.pop (header, out, dropping));
 
-        Header header;
+  header.seqNum = seqNum;
 
-        m_ready = true;
+  BOOST_REQUIRE (queue.push (header, in));
+  BOOST_REQUIRE (queue.pop (header, out, dropping));
+  BOOST_CHECK_EQUAL (header.seqNum, seqNum);
 
-        while (!m_stop)
-        {
-          if (m_queue.pop (header, m_data, m_consumer))
-          {
-            throughput.next (sizeof (header) + m_data.size (), header.seqNum);
+  metrics = monitor.metrics ();
 
-            latency.next ({ Clock::now () -
-                  timepoint_from_nanoseconds_since_epoch (header.timestamp) });
-          }
-        }
-       /*
-        * Notifying the queue of a consumer exiting should occur from the thread
-        * context of the consumer.
-        *
-        * Failure to do this will prevent the consumer slot from being reused.
-        */
-        m_queue.unregister_consumer (m_consumer);
-      }
-      catch (const std::exception &e)
-      {
-        m_stop = true;
+  BOOST_CHECK_EQUAL (metrics.published, seqNum);
+  BOOST_CHECK_EQUAL (metrics.dropped, seqNum - 2);
+  /*
+   * The counts of a consumer start when it registers
+   */
+  detail::ConsumerState late;
 
-        m_exceptions.push_back (std::string (e.what ()));
-      }
-    });
-  }
+  queue.register_consumer (late);
 
-  ~Client ()
+  for (size_t i = 0; i < 2; ++i)
   {
-    m_stop = true;
+    header.seqNum = ++seqNum;
 
-    m_thread.join ();
+    BOOST_REQUIRE (queue.push (header, in));
+    BOOST_REQUIRE (queue.pop (header, out, late));
   }
 
-  bool ready () const { return m_ready; }
+  BOOST_CHECK (!queue.pop (header, out, late));
 
-  void stop () { m_stop = true; m_ready = false;}
+  metrics = monitor.metrics ();
 
-  const std::vector<uint8_t> &data () const { return m_data; }
+  auto counted = std::find_if (metrics.consumers.begin (),
+                               metrics.consumers.end (),
+                               [&late] (const QueueMetrics::Consumer &entry) {
+                                 return entry.index == late.index ();
+                               });
 
-  const PerformanceStats &stats ()    const { return m_stats;    }
+  BOOST_REQUIRE (counted != metrics.consumers.end ());
+  BOOST_CHECK_EQUAL (counted->consumed, 2);
+  BOOST_CHECK_EQUAL (counted->consumedBytes, 2 * messageSize);
 
-  std::vector<std::string> &exceptions () { return m_exceptions; }
+  queue.unregister_consumer (late);
+  queue.unregister_consumer (consumer);
+  queue.unregister_consumer (dropping);
 
-private:
+  BOOST_CHECK (monitor.metrics ().consumers.empty ());
+}
 
-  std::atomic<bool> m_ready = { false };
+BOOST_AUTO_TEST_CASE (ConcurrentConsumerRegistration)
+{
+  using namespace boost::interprocess;
 
-  Queue &m_queue;
+  ScopedLogLevel log (error);
 
-  detail::ConsumerState m_consumer;
+  Header header;
+  std::vector<uint8_t> in (24), out;
 
-  std::vector<uint8_t> m_data;
+  header.size = in.size ();
+  /*
+   * Consumers register and unregister concurrently while the producer pushes,
+   * each slot owned by one consumer at a time
+   */
+  {
+    const uint8_t maxConsumers = 16;
 
-  std::atomic<bool> m_stop = { false };
+    SPMCQueue<std::allocator<uint8_t>> queue (1024*1024, maxConsumers);
 
-  std::thread m_thread;
+    std::array<std::atomic<bool>, maxConsumers> occupied;
 
-  PerformanceStats m_stats;
+    for (auto &slot : occupied)
+    {
+      slot = false;
+    }
 
-  std::vector<std::string> m_exceptions;
-};
+    std::atomic<size_t> errors = { 0 };
+    std::atomic<bool>   stop   = { false };
 
-using TestServer = Server<SPMCQueue<std::allocator<uint8_t>>>;
-using TestClient = Client<SPMCQueue<std::allocator<uint8_t>>>;
+    std::thread producer ([&queue, &header, &in, &stop] () {
 
-BOOST_AUTO_TEST_CASE (ThreadedProducerSingleConsumer)
-{
-  ScopedLogLevel log (error);
+      while (!stop)
+      {
+        queue.push (header, in);
+      }
+    });
 
-  SPMCQueue<std::allocator<uint8_t>> queue (1024*1024*100);
-#if CACHE_SIZE_ENABLED // re-enable prefetch functionality
+    std::vector<std::thread> consumers;
 
-  queue.resize_cache (1024);
-#endif
+    for (size_t i = 0; i < maxConsumers; ++i)
+    {
+      consumers.emplace_back ([&queue, &occupied, &errors] () {
 
-  size_t   messageSize = 32+sizeof (Header);  // typical BBA message size
-  uint32_t throughput  = 100e3;   // 100K message/sec
+        Header header;
+        std::vector<uint8_t> out;
 
-  TestServer server (queue, messageSize, throughput);
+        for (size_t j = 0; j < 1000; ++j)
+        {
+          detail::ConsumerState consumer;
 
-  while (!server.ready ())
-  {
-    std::this_thread::sleep_for (1ms);
-  }
+          queue.register_consumer (consumer);
 
-  TestClient client (queue, messageSize);
+          if (consumer.index () >= maxConsumers ||
+              occupied[consumer.index ()].exchange (true))
+          {
+            ++errors;
+          }
 
-  std::this_thread::sleep_for (get_test_duration ().nanoseconds ());
+          queue.pop (header, out, consumer);
 
-  BOOST_CHECK_EQUAL (client.data ().size (), server.data ().size ());
-  for (size_t i = 0; i < server.data ().size (); ++i)
-  {
-    BOOST_CHECK_EQUAL (client.data ()[i], server.data ()[i]);
-  }
+          occupied[consumer.index () % maxConsumers] = false;
 
-  // test throughput against a relatively conservative value
-  auto &summary = client.stats ().throughput ().summary ();
-  BOOST_CHECK (summary.messages () > 100);
+          queue.unregister_consumer (consumer);
+        }
+      });
+    }
 
-  BOOST_TEST_MESSAGE ("throughput:\t" << summary.to_string ());
-}
+    for (auto &consumer : consumers)
+    {
+      consumer.join ();
+    }
 
+    stop = true;
 
-BOOST_AUTO_TEST_CASE (ThreadedProducerMultiConsumerNoMesssage)
-{
-  ScopedLogLevel log (error);
+    producer.join ();
 
-  SPMCQueue<std::allocator<uint8_t>> queue (1024*1024);
+    BOOST_CHECK_EQUAL (errors, 0);
+    BOOST_CHECK (queue.metrics ().consumers.empty ());
+    /*
+     * Every slot is free again
+     */
+    std::vector<detail::ConsumerState> states (maxConsumers);
 
-  size_t messageSize = 32;
-  uint32_t throughput = 1e6;
+    for (auto &consumer : states)
+    {
+      queue.register_consumer (consumer);
+    }
 
-  TestServer server (queue, messageSize, throughput);
+    detail::ConsumerState extra;
 
-  // allow the server to initialise
-  while (!server.ready ())
-  {
-    std::this_thread::sleep_for (1ms);
+    BOOST_CHECK_THROW (queue.register_consumer (extra), std::logic_error);
+
+    for (auto &consumer : states)
+    {
+      queue.unregister_consumer (consumer);
+    }
   }
+  /*
+   * The slot of a consumer process which exits without unregistering is
+   * reclaimed by the next consumer to register, without the producer
+   */
+  {
+    std::string name = "ConcurrentConsumerRegistration:Test";
 
-  const int clientCount = 2;
-  std::vector<std::unique_ptr<TestClient>> clients;
+    struct RemoveSharedMemory
+    {
+      RemoveSharedMemory (const std::string & name) : name (name)
+      { shared_memory_object::remove (name.c_str ()); }
 
-  for (int i = 0; i < clientCount; ++i)
-  {
-    auto client = std::make_unique<TestClient> (queue, messageSize);
+      ~RemoveSharedMemory ()
+      { shared_memory_object::remove (name.c_str ()); }
 
-    while (!client->ready ())
+      std::string name;
+    } cleanup (name);
+
+    using Queue = SPMCQueue<SharedMemory::Allocator>;
+
+    Queue queue (name, name + ":queue", 1024, 1);
+
+    pid_t pid = ::fork ();
+
+    if (pid == 0)
     {
-      std::this_thread::sleep_for (1ms);
+      Queue client (name, name + ":queue");
+
+      detail::ConsumerState consumer;
+
+      client.register_consumer (consumer);
+
+      ::_exit (EXIT_SUCCESS);
     }
 
-    clients.push_back (std::move (client));
-  }
+    BOOST_REQUIRE (pid > 0);
 
-  BOOST_TEST_MESSAGE ("server throughput:\t" << throughput);
-  BOOST_TEST_MESSAGE ("message size:\t\t"    << messageSize);
+    int status = 0;
 
-  std::this_thread::sleep_for (get_test_duration ().nanoseconds ());
+    BOOST_REQUIRE_EQUAL (::waitpid (pid, &status, 0), pid);
 
-  server.stop ();
-  for (auto &client : clients)
-  {
-    client->stop ();
-  }
+    auto metrics = queue.metrics ();
 
-  auto print = [] (const PerformanceStats& stats) {
-    BOOST_TEST_MESSAGE (" throughput:\t\t"
-      << stats.throughput ().summary ().to_string ());
-  };
+    BOOST_REQUIRE_EQUAL (metrics.consumers.size (), 1);
+    BOOST_CHECK_EQUAL (metrics.consumers[0].pid, pid);
 
-  for (auto &client : clients)
-  {
-    auto &stats = client->stats ();
+    detail::ConsumerState consumer;
 
-    // test throughput against a relatively conservative value
-    BOOST_CHECK ((stats.throughput ().summary ()
-                       .messages_per_sec () / 1.0e6) > .8);
+    BOOST_REQUIRE_NO_THROW (queue.register_consumer (consumer));
 
-    BOOST_TEST_MESSAGE ("client");
-    print (stats);
-  }
+    metrics = queue.metrics ();
 
-  BOOST_TEST_MESSAGE("\nlatency stats for one of the clients");
+    BOOST_REQUIRE_EQUAL (metrics.consumers.size (), 1);
+    BOOST_CHECK_EQUAL (metrics.consumers[0].pid, ::getpid ());
 
-  auto &latencies = clients.back ()->stats ().latency ().summary ();
+    header.seqNum = 1;
 
-  for (auto line : latencies.to_strings ())
-  {
-    BOOST_TEST_MESSAGE (line);
+    BOOST_REQUIRE (queue.push (header, in));
+    BOOST_REQUIRE (queue.pop (header, out, consumer));
+    BOOST_CHECK_EQUAL (header.seqNum, 1);
+
+    queue.unregister_consumer (consumer);
   }
 }
 
-template <class Queue>
-class Client2 : boost::noncopyable
+BOOST_AUTO_TEST_CASE (QueueLayoutValidation)
 {
-public:
-  Client2 (Queue &queue, size_t dataSize)
-  {
-    m_thread = std::thread ([this, dataSize, &queue] () {
+  using namespace boost::interprocess;
 
-      try
-      {
-        SPMCSink<Queue> sink (queue);
-        std::vector<uint8_t> data (dataSize);
+  ScopedLogLevel log (error);
 
-        auto &throughput =  m_stats.throughput ().summary ();
-        auto &latency    =  m_stats.latency ().summary ();
+  std::string name = "QueueLayoutValidation:Test";
 
-        Header header;
+  struct RemoveSharedMemory
+  {
+    RemoveSharedMemory (const std::string & name) : name (name)
+    { shared_memory_object::remove (name.c_str ()); }
 
-        while (!m_stop)
-        {
-          if (sink.next (header, data))
-          {
-            throughput.next (sizeof (header) + data.size (), header.seqNum);
+    ~RemoveSharedMemory ()
+    { shared_memory_object::remove (name.c_str ()); }
 
-            latency.next ({ Clock::now () -
-                  timepoint_from_nanoseconds_since_epoch (header.timestamp) });
-          }
-        }
-      }
-      catch (const std::exception &e)
-      {
-        m_stop = true;
+    std::string name;
+  } cleanup (name);
 
-        m_exceptions.push_back (std::string (e.what ()));
-      }
-    });
-  }
+  using Queue = SPMCQueue<SharedMemory::Allocator>;
 
-  ~Client2 ()
+  Queue queue (name, name + ":queue", 1024);
+  /*
+   * The queue is one block in the segment, starting with the layout header
+   */
   {
-    m_stop = true;
+    managed_shared_memory memory (open_only, name.c_str ());
 
-    m_thread.join ();
-  }
+    auto block = memory.find<uint8_t> ((name + ":queue").c_str ());
 
-  void stop () { m_stop = true; }
+    BOOST_REQUIRE (block.first != nullptr);
+    BOOST_CHECK_EQUAL (block.second,
+                       Queue::memory_size (1024) - SharedMemory::BOOK_KEEPING);
+  }
+  /*
+   * A consumer using a different header format or capacity mode fails to open
+   * the queue
+   */
+  using CompactQueue = SPMCQueue<SharedMemory::Allocator,
+                                 MAX_NO_DROP_CONSUMERS_DEFAULT, false,
+                                 CompactHeader>;
+  using PowerOf2Queue = SPMCQueue<SharedMemory::Allocator,
+                                  MAX_NO_DROP_CONSUMERS_DEFAULT, true>;
+
+  BOOST_CHECK_THROW (CompactQueue (name, name + ":queue"), std::logic_error);
+  BOOST_CHECK_THROW (PowerOf2Queue (name, name + ":queue"), std::logic_error);
+  /*
+   * A consumer built with a matching layout reads the queue
+   */
+  {
+    Queue client (name, name + ":queue");
 
-  const PerformanceStats &stats () const { return m_stats; }
+    BOOST_CHECK_EQUAL (client.capacity (), 1024);
 
-  std::vector<std::string> &exceptions () { return m_exceptions; }
+    detail::ConsumerState consumer;
 
-private:
+    client.register_consumer (consumer);
 
-  std::unique_ptr<SPMCSink<Queue>> m_sink;
+    Header header;
+    std::vector<uint8_t> in (24, 1), out;
 
-  std::atomic<bool> m_stop = { false };
+    header.seqNum = 1;
+    header.size   = in.size ();
 
-  std::thread m_thread;
+    BOOST_REQUIRE (queue.push (header, in));
+    BOOST_REQUIRE (client.pop (header, out, consumer));
+    BOOST_CHECK_EQUAL (header.seqNum, 1);
+    BOOST_CHECK (out == in);
 
-  PerformanceStats m_stats;
+    client.unregister_consumer (consumer);
+  }
+  /*
+   * A queue with an unknown layout version is rejected
+   */
+  {
+    managed_shared_memory memory (open_only, name.c_str ());
 
-  std::vector<std::string> m_exceptions;
-};
+    auto block = memory.find<uint8_t> ((name + ":queue").c_str ());
 
-BOOST_AUTO_TEST_CASE (TooManyConsumers)
-{
-  ScopedLogLevel log (error);
+    void  *ptr   = block.first;
+    size_t space = block.second;
 
-  /*
-   * Set the maximum number of consumers to be two
-   */
-  const size_t maxClients = 2;
+    auto *layout = reinterpret_cast<detail::QueueLayout*> (std::align (
+                      alignof (detail::QueueLayout),
+                      sizeof (detail::QueueLayout), ptr, space));
 
-  using QueueType  = SPMCQueue<std::allocator<uint8_t>, maxClients>;
-  using ClientType = Client<QueueType>;
+    BOOST_CHECK_EQUAL (layout->magic, detail::QUEUE_LAYOUT_MAGIC);
 
-  std::vector<std::unique_ptr<ClientType>> clients;
+    ++layout->version;
 
-  QueueType queue (1024*1024*10);
+    BOOST_CHECK_THROW (Queue (name, name + ":queue"), std::logic_error);
 
-  size_t messageSize  = 128;
-  uint32_t throughput = 1e6;
+    --layout->version;
+  }
 
-  // Add the maximum number of clients
-  clients.push_back (std::move (std::make_unique<ClientType>(queue, messageSize)));
-  clients.push_back (std::move (std::make_unique<ClientType>(queue, messageSize)));
+  BOOST_CHECK_NO_THROW (Queue (name, name + ":queue"));
+}
 
-  Server<QueueType> server (queue, messageSize, throughput);
+BOOST_AUTO_TEST_CASE (QueueLayoutInterruptedConstruction)
+{
+  using namespace boost::interprocess;
 
-  BOOST_TEST_MESSAGE ("Expected server throughput:\t" << throughput);
-  BOOST_TEST_MESSAGE ("Expected message size:\t\t"    << messageSize);
+  ScopedLogLevel log (error);
 
-  // allow the clients to initialise
-  std::this_thread::sleep_for (Milliseconds (100));
+  std::string name = "QueueLayoutInterruptedConstruction:Test";
 
-  BOOST_CHECK_EQUAL (clients.size (), 2);
+  struct RemoveSharedMemory
   {
-    BOOST_TEST_MESSAGE ("Add one client too many");
-    /*
-     * An exception should be thrown when registering more clients than the
-     * queue is configured to accept.
-     *
-     * For the purposes of this test the exception is stored in an exception
-     * pointer stored in the ClientType.
-     */
+    RemoveSharedMemory (const std::string & name) : name (name)
+    { shared_memory_object::remove (name.c_str ()); }
 
-    ClientType client (queue, messageSize);
+    ~RemoveSharedMemory ()
+    { shared_memory_object::remove (name.c_str ()); }
 
-    std::this_thread::sleep_for (Seconds (2));
+    std::string name;
+  } cleanup (name);
 
-    BOOST_CHECK_MESSAGE (client.exceptions ().size () == 1,
-                         "An expected exception was not thrown");
+  using Queue = SPMCQueue<SharedMemory::Allocator>;
 
-    client.exceptions ().clear ();
+  auto layout_header = [] (managed_shared_memory &memory,
+                           const std::string &queueName) {
 
-    BOOST_CHECK_EQUAL (clients.size (), 2);
+    auto block = memory.find<uint8_t> (queueName.c_str ());
 
-    client.stop ();
+    void  *ptr   = block.first;
+    size_t space = block.second;
+
+    return reinterpret_cast<detail::QueueLayout*> (std::align (
+                      alignof (detail::QueueLayout),
+                      sizeof (detail::QueueLayout), ptr, space));
+  };
+
+  {
+    Queue queue (name, name + ":queue", 1024);
   }
+  /*
+   * Emulate a producer which stopped while constructing the queue, after
+   * writing the header, then before writing it
+   */
+  for (bool writtenHeader : { true, false })
+  {
+    {
+      managed_shared_memory memory (open_only, name.c_str ());
 
-  // stop one of the clients to create room for a new client to be added
-  BOOST_TEST_MESSAGE ("Stop one of the clients, to free space for a new client");
-  clients.resize (clients.size () -1);
+      detail::QueueLayout *layout = layout_header (memory, name + ":queue");
 
-  std::this_thread::sleep_for (Milliseconds (10));
+      BOOST_REQUIRE (layout != nullptr);
+      BOOST_CHECK_EQUAL (layout->state, detail::QUEUE_CONSTRUCTED);
 
-  BOOST_TEST_MESSAGE ("Create and add a new client");
-  ClientType client (queue, messageSize);
+      if (writtenHeader)
+      {
+        layout->state = detail::QUEUE_CONSTRUCTING;
+      }
+      else
+      {
+        layout->magic = 0;
+      }
+    }
+    /*
+     * A consumer fails to open the incomplete queue
+     */
+    BOOST_CHECK_THROW (Queue (name, name + ":queue"), std::logic_error);
+    /*
+     * The next producer constructs the queue again
+     */
+    Queue queue (name, name + ":queue", 1024);
 
-  std::this_thread::sleep_for (Milliseconds (10));
+    Queue client (name, name + ":queue");
 
-  BOOST_CHECK (client.exceptions ().empty ());
+    detail::ConsumerState consumer;
 
-  std::this_thread::sleep_for (Milliseconds (10));
+    client.register_consumer (consumer);
 
-  BOOST_TEST_MESSAGE ("Stop all clients: " <<  clients.size ());
+    Header header;
+    std::vector<uint8_t> in (24, 1), out;
 
-  for (auto &client : clients)
-  {
-    client->stop ();
-  }
+    header.seqNum = 1;
+    header.size   = in.size ();
 
-  BOOST_TEST_MESSAGE ("Stop server");
+    BOOST_REQUIRE (queue.push (header, in));
+    BOOST_REQUIRE (client.pop (header, out, consumer));
+    BOOST_CHECK_EQUAL (header.seqNum, 1);
+    BOOST_CHECK (out == in);
 
-  server.stop ();
+    client.unregister_consumer (consumer);
+  }
 }
 
-/*
- * Restart the client consuming data from a server
- */
 BOOST_AUTO_TEST_CASE (RestartClient)
 {
   ScopedLogLevel log (error);
@@ -1113,6 +3604,109 @@ BOOST_AUTO_TEST_CASE (RestartServer)
   }
 }
 
+/*
+ * Consumers of a shared memory queue move to the data of a restarted producer
+ * without reopening the shared memory
+ */
+BOOST_AUTO_TEST_CASE (RestartServerInSharedMemory)
+{
+  using namespace boost::interprocess;
+
+  ScopedLogLevel log (error);
+
+  std::string name = "RestartServerInSharedMemory:Test";
+
+  struct RemoveSharedMemory
+  {
+    RemoveSharedMemory (const std::string & name) : name (name)
+    { shared_memory_object::remove (name.c_str ()); }
+
+    ~RemoveSharedMemory ()
+    { shared_memory_object::remove (name.c_str ()); }
+
+    std::string name;
+  } cleanup (name);
+
+  using Queue = SPMCQueue<SharedMemory::Allocator>;
+
+  const size_t capacity = 1024;
+
+  auto source = std::make_unique<Queue> (name, name + ":queue", capacity);
+
+  Queue queue (name, name + ":queue");
+
+  detail::ConsumerState noDrop, drop (ConsumerMode::Drop);
+
+  queue.register_consumer (noDrop);
+  queue.register_consumer (drop);
+
+  Header header;
+  std::vector<uint8_t> in (8), out;
+
+  auto push = [&header, &in] (Queue &to, uint64_t first, uint64_t last) {
+    for (uint64_t i = first; i <= last; ++i)
+    {
+      header.seqNum = i;
+      header.size   = in.size ();
+
+      BOOST_REQUIRE (to.push (header, in));
+    }
+  };
+
+  push (*source, 1, 10);
+
+  BOOST_REQUIRE (queue.pop (header, out, noDrop));
+  BOOST_CHECK_EQUAL (header.seqNum, 1);
+  BOOST_REQUIRE (queue.pop (header, out, drop));
+  BOOST_CHECK_EQUAL (header.seqNum, 1);
+  /*
+   * Restart the producer, leaving unread messages from the previous producer
+   */
+  source.reset ();
+
+  source = std::make_unique<Queue> (name, name + ":queue", capacity);
+
+  push (*source, 1, 5);
+  /*
+   * The consumers finish their current data ranges then continue from the
+   * first message of the new producer
+   */
+  for (auto *consumer : { &noDrop, &drop })
+  {
+    for (uint64_t i = 2; i <= 10; ++i)
+    {
+      BOOST_REQUIRE (queue.pop (header, out, *consumer));
+      BOOST_CHECK_EQUAL (header.seqNum, i);
+    }
+
+    for (uint64_t i = 1; i <= 5; ++i)
+    {
+      BOOST_REQUIRE (queue.pop (header, out, *consumer));
+      BOOST_CHECK_EQUAL (header.seqNum, i);
+    }
+
+    BOOST_CHECK_EQUAL (consumer->dropped (), 0);
+  }
+  /*
+   * The NoDrop consumer keeps its back-pressure slot, so the producer cannot
+   * overtake it
+   */
+  push (*source, 6, 20);
+
+  header.size = capacity / 2;
+
+  BOOST_CHECK (!source->push (header, std::vector<uint8_t> (header.size)));
+
+  for (uint64_t i = 6; i <= 20; ++i)
+  {
+    BOOST_REQUIRE (queue.pop (header, out, noDrop));
+    BOOST_CHECK_EQUAL (header.seqNum, i);
+  }
+
+  queue.unregister_consumer (noDrop);
+  queue.unregister_consumer (drop);
+}
+
 BOOST_AUTO_TEST_CASE (SourceSinkInSharedMemory)
 {
   using namespace boost;
@@ -1143,7 +3737,8 @@ BOOST_AUTO_TEST_CASE (SourceSinkInSharedMemory)
    * Create shared memory in which shared objects can be created
    */
   managed_shared_memory memory (open_or_create, name.c_str(),
-                         capacity + SharedMemory::BOOK_KEEPING);
+                         SPMCQueue<SharedMemory::Allocator>::memory_size (
+                                                                  capacity));
 
   SPMCSourceProcess source (name, name + ":queue", capacity);
 
@@ -1209,7 +3804,15 @@ BOOST_AUTO_TEST_CASE (SourceSinkInSharedMemory)
   consumer.join ();
   producer.join ();
 
-  BOOST_CHECK (stats.throughput ().summary ().messages_per_sec () > 1e6);
+  /*
+   * The producer and consumer threads share a core on a single CPU machine,
+   * which limits throughput to a few hundred thousand messages per second
+   */
+  if (std::thread::hardware_concurrency () > 1)
+  {
+    BOOST_CHECK (stats.throughput ().summary ().messages_per_sec () > 1e6);
+  }
+
   BOOST_TEST_MESSAGE ("throughput "
                         << stats.throughput ().summary ().to_string ());
 
@@ -1226,6 +3829,225 @@ BOOST_AUTO_TEST_CASE (SourceSinkInSharedMemory)
                         << stats.latency ().summary ().to_string ());
 }
 
+/*
+ * A topic sink only receives data from the topics it subscribes to
+ */
+BOOST_AUTO_TEST_CASE (TopicSourceSinkInSharedMemory)
+{
+  using namespace boost::interprocess;
+
+  ScopedLogLevel log (error);
+
+  std::string name = "TopicSourceSinkInSharedMemory:Test";
+
+  struct RemoveSharedMemory
+  {
+    RemoveSharedMemory (const std::string & name) : name (name)
+    { shared_memory_object::remove (name.c_str ()); }
+
+    ~RemoveSharedMemory ()
+    { shared_memory_object::remove (name.c_str ()); }
+
+    std::string name;
+  } cleanup (name);
+
+  size_t capacity = 1024;
+
+  SPMCTopicSourceProcess source (name,
+                          SPMCTopicSourceProcess::memory_size (capacity, 3));
+
+  size_t red   = source.add_topic ("red",   capacity);
+  size_t green = source.add_topic ("green", capacity);
+  size_t blue  = source.add_topic ("blue",  capacity);
+
+  BOOST_CHECK_THROW (source.add_topic ("red", capacity), std::exception);
+
+  BOOST_CHECK ((source.topics () ==
+                std::vector<std::string> { "red", "green", "blue" }));
+
+  BOOST_CHECK_THROW (SPMCTopicSinkProcess (name, { "red", "yellow" }),
+                     std::exception);
+
+  SPMCTopicSinkProcess sink (name, { "blue", "red" });
+
+  for (uint64_t i = 1; i <= 10; ++i)
+  {
+    source.next (red,   i);
+    source.next (green, i + 100);
+    source.next (blue,  i + 200);
+  }
+
+  Header header;
+  std::vector<uint8_t> data;
+  size_t topic = 0;
+
+  std::vector<uint64_t> received[2];
+
+  while (sink.next_non_blocking (header, data, topic))
+  {
+    BOOST_REQUIRE (topic < 2);
+    BOOST_REQUIRE_EQUAL (data.size (), sizeof (uint64_t));
+
+    received[topic].push_back (*reinterpret_cast<uint64_t*> (data.data ()));
+  }
+
+  std::vector<uint64_t> expectedBlue (10), expectedRed (10);
+  std::iota (expectedBlue.begin (), expectedBlue.end (), 201);
+  std::iota (expectedRed.begin (),  expectedRed.end (),  1);
+
+  BOOST_CHECK (received[0] == expectedBlue);
+  BOOST_CHECK (received[1] == expectedRed);
+  /*
+   * A blocking sink sleeps on the directory doorbell, which the queues of the
+   * topics ring
+   */
+  using BlockingTopicSink = SPMCTopicSink<SPMCQueue<SharedMemory::Allocator>,
+                                          BlockingWait>;
+
+  BlockingTopicSink blocking (name, { "green" });
+
+  const uint64_t messages = 10;
+
+  uint64_t count = 0;
+
+  std::thread consumer ([&] () {
+
+    Header header;
+    std::vector<uint8_t> data;
+    size_t topic = 0;
+
+    while (count < messages && blocking.next (header, data, topic))
+    {
+      BOOST_CHECK_EQUAL (*reinterpret_cast<uint64_t*> (data.data ()),
+                         ++count + 300);
+    }
+  });
+
+  for (uint64_t i = 1; i <= messages; ++i)
+  {
+    /*
+     * Allow the consumer to arm the doorbell and go to sleep
+     */
+    std::this_thread::sleep_for (Milliseconds (1));
+
+    source.next (green, i + 300);
+  }
+
+  consumer.join ();
+
+  BOOST_CHECK_EQUAL (count, messages);
+}
+
+BOOST_AUTO_TEST_CASE (SlotSourceSinkInSharedMemory)
+{
+  using namespace boost::interprocess;
+
+  ScopedLogLevel log (error);
+
+  std::string name = "SlotSourceSinkInSharedMemory:Test";
+
+  struct RemoveSharedMemory
+  {
+    RemoveSharedMemory (const std::string & name) : name (name)
+    { shared_memory_object::remove (name.c_str ()); }
+
+    ~RemoveSharedMemory ()
+    { shared_memory_object::remove (name.c_str ()); }
+
+    std::string name;
+  } cleanup (name);
+
+  using Queue = SPMCSlotQueue<uint64_t, SharedMemory::Allocator>;
+
+  SPMCSource<Queue> source (name, name + ":queue", 64, 2);
+
+  SPMCSink<Queue, BlockingWait> sink (name, name + ":queue");
+
+  const uint64_t count = 100000;
+
+  auto producer = std::thread ([&source, count] () {
+
+    for (uint64_t i = 1; i <= count; ++i)
+    {
+      source.push (i);
+    }
+  });
+
+  uint64_t value    = 0;
+  uint64_t expected = 0;
+  bool     ordered  = true;
+
+  while (expected < count && sink.pop (value))
+  {
+    ordered = ordered && (value == ++expected);
+  }
+
+  producer.join ();
+
+  BOOST_CHECK (ordered);
+  BOOST_CHECK_EQUAL (expected, count);
+  BOOST_CHECK (!sink.pop_non_blocking (value));
+}
+
+BOOST_AUTO_TEST_CASE (CpuTopologySelection)
+{
+  ScopedLogLevel log (error);
+
+  BOOST_CHECK ((CpuTopology::parse_cpu_list ("0-2,5\n") ==
+                std::vector<int> { 0, 1, 2, 5 }));
+
+  BOOST_CHECK (!CpuTopology ().cpus ().empty ());
+  /*
+   * Two sockets, each a NUMA node with one L3 cache and two cores of two
+   * hyper-threads. Cpus n and n+2 are hyper-thread siblings.
+   */
+  namespace fs = std::filesystem;
+
+  fs::path root = fs::temp_directory_path () / "CpuTopologySelection";
+
+  BOOST_SCOPE_EXIT (&root) { fs::remove_all (root); } BOOST_SCOPE_EXIT_END
+
+  auto write = [] (const fs::path &path, const std::string &value) {
+    fs::create_directories (path.parent_path ());
+    std::ofstream (path) << value << std::endl;
+  };
+
+  write (root / "cpu" / "online", "0-7");
+
+  for (int cpu = 0; cpu < 8; ++cpu)
+  {
+    fs::path path = root / "cpu" / ("cpu" + std::to_string (cpu));
+
+    write (path / "topology" / "physical_package_id", std::to_string (cpu / 4));
+    write (path / "topology" / "core_id", std::to_string (cpu % 2));
+    write (path / "cache" / "index3" / "level", "3");
+    write (path / "cache" / "index3" / "shared_cpu_list",
+           (cpu < 4) ? "0-3" : "4-7");
+  }
+
+  write (root / "node" / "node0" / "cpulist", "0-3");
+  write (root / "node" / "node1" / "cpulist", "4-7");
+
+  CpuTopology topology (root.string ());
+
+  BOOST_REQUIRE_EQUAL (topology.cpus ().size (), 8);
+  BOOST_CHECK_EQUAL (topology.node (5), 1);
+  BOOST_CHECK_EQUAL (topology.cpu (6).l3, 4);
+
+  BOOST_CHECK_EQUAL (topology.select ("-1"), -1);
+  BOOST_CHECK_EQUAL (topology.select ("3"), 3);
+  /*
+   * Relative selections avoid the core of the reference cpu and prefer cpus
+   * which have not been selected
+   */
+  BOOST_CHECK_EQUAL (topology.select ("l3:0"), 1);
+  BOOST_CHECK_EQUAL (topology.select ("l3:0"), 3);
+  BOOST_CHECK_EQUAL (topology.select ("node:4"), 5);
+
+  BOOST_CHECK_THROW (topology.select ("l3:9"), std::exception);
+  BOOST_CHECK_THROW (topology.select ("socket:0"), std::exception);
+}
+
 BOOST_AUTO_TEST_CASE (VariadicGetSize)
 {
   uint8_t i = 3;
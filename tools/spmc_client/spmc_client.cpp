@@ -1,5 +1,6 @@
 #include "Assert.h"
 #include "CpuBind.h"
+#include "CpuTopology.h"
 #include "Logger.h"
 #include "PerformanceStats.h"
 #include "SignalCatcher.h"
@@ -52,14 +53,25 @@ CxxOptsHelper parse (int argc, char* argv[])
     ("h,help", "Performance test consuming of shared memory messages")
     ("name", "Shared memory name", cxxopts::value<std::string> ())
     ("cpu", "Bind main thread to a cpu processor integer, "
-            "use -1 for no binding",
-      cxxopts::value<int> ()->default_value ("-1"))
+            "use -1 for no binding. Use l3:<cpu> or node:<cpu> to select a "
+            "cpu sharing the L3 cache or NUMA node of the server cpu",
+      cxxopts::value<std::string> ()->default_value ("-1"))
     ("directory", "Directory for statistics files",
       cxxopts::value<std::string> ())
     ("stats", "Statistics to log. "
      "Comma separated list (throughput,latency,interval)",
       cxxopts::value<std::vector<std::string>> (stats))
     ("test", "Enable basic tests for message validity", cxxopts::value<bool> ())
+    ("allow_drops", "Consume without exerting back-pressure on the server, "
+                    "dropping messages if the consumer falls behind",
+      cxxopts::value<bool> ())
+    ("from_oldest", "Start from the oldest message retained in the queue "
+                    "instead of the latest data",
+      cxxopts::value<bool> ())
+    ("huge_pages", "Back the queue with transparent huge pages",
+      cxxopts::value<bool> ())
+    ("lock_pages", "Lock the queue memory in RAM and pre-fault every page",
+      cxxopts::value<bool> ())
     ("log_level", "Logging level",
       cxxopts::value<std::string> ()->default_value ("NOTICE"));
 
@@ -98,8 +110,12 @@ int main(int argc, char* argv[]) try
    */
   auto name       = options.required<std::string> ("name");
   auto directory  = options.value<std::string>    ("directory", "");
-  auto cpu        = options.value<int>            ("cpu", -1);
+  auto cpu        = options.value<std::string>    ("cpu", "-1");
   auto test       = options.value<bool>           ("test", false);
+  auto allowDrops = options.value<bool>           ("allow_drops", false);
+  auto fromOldest = options.value<bool>           ("from_oldest", false);
+  auto hugePages  = options.value<bool>           ("huge_pages", false);
+  auto lockPages  = options.value<bool>           ("lock_pages", false);
   auto logLevel   = options.value<std::string>    ("log_level",
                                                    log_levels (),"INFO");
   auto latency    = options.positional ("stats", "latency");
@@ -114,7 +130,16 @@ int main(int argc, char* argv[]) try
   using Queue  = SPMCQueue<SharedMemory::Allocator>;
   using Sink = SPMCSink<Queue>;
 
-  Sink sink (name, name + ":queue");
+  PageOptions pages;
+  pages.hugePages = hugePages;
+  pages.lockPages = lockPages;
+
+  StartPosition start;
+  start.origin = fromOldest ? StartPosition::Oldest : StartPosition::Head;
+
+  Sink sink (name, name + ":queue",
+             allowDrops ? ConsumerMode::Drop : ConsumerMode::NoDrop, pages,
+             start);
 
   std::atomic<bool> stop = { false };
 
@@ -142,7 +167,7 @@ int main(int argc, char* argv[]) try
   stats.throughput ().summary ().enable (throughput);
   stats.throughput ().interval ().enable (interval && throughput);
 
-  bind_to_cpu (cpu);
+  bind_to_cpu (CpuTopology ().select (cpu));
 
   uint64_t testSeqNum = 0;
   std::vector<uint8_t> expected;
@@ -154,7 +179,7 @@ int main(int argc, char* argv[]) try
   {
     if (sink.next (header, data))
     {
-      stats.update (sizeof (Header) + header.size, header.seqNum,
+      stats.update (sizeof (Queue::HeaderType) + header.size, header.seqNum,
                     timepoint_from_nanoseconds_since_epoch (header.timestamp));
 
       if (SPMC_EXPECT_FALSE (test))
@@ -165,7 +190,13 @@ int main(int argc, char* argv[]) try
         }
         else
         {
-          CHECK_SS ((header.seqNum - testSeqNum) == 1,
+          /*
+           * Messages replayed from retained data may be overwritten
+           */
+          bool drops = allowDrops || fromOldest;
+
+          CHECK_SS ((header.seqNum - testSeqNum) == 1 ||
+                    (drops && header.seqNum > testSeqNum),
             "Invalid sequence number: header.seqNum: " << header.seqNum <<
             " testSeqNum: " << testSeqNum);
 
@@ -204,6 +235,11 @@ int main(int argc, char* argv[]) try
   stats.stop ();
   stats.print_summary ();
 
+  if (allowDrops || sink.evicted ())
+  {
+    BOOST_LOG_TRIVIAL (info) << "Dropped messages: " << sink.dropped ();
+  }
+
   BOOST_LOG_TRIVIAL (info) << "Exit SPMCSink";
 
   return EXIT_SUCCESS;
@@ -0,0 +1,167 @@
+#include "Chrono.h"
+#include "Logger.h"
+#include "SignalCatcher.h"
+#include "SPMCQueue.h"
+#include "detail/CXXOptsHelper.h"
+#include "detail/SharedMemory.h"
+
+#include <atomic>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace olive;
+namespace bi = boost::interprocess;
+
+namespace {
+
+CxxOptsHelper parse (int argc, char* argv[])
+{
+  cxxopts::Options cxxopts ("spmc_monitor",
+        "Print the metrics of a shared memory queue without consuming from it");
+
+  cxxopts.add_options ()
+    ("h,help", "Monitor the producer and clients of a shared memory queue")
+    ("name", "Shared memory name", cxxopts::value<std::string> ())
+    ("interval", "Time between reports (milliseconds)",
+     cxxopts::value<uint32_t> ()->default_value ("1000"))
+    ("count", "Number of reports, value=0 to report until stopped",
+     cxxopts::value<uint32_t> ()->default_value ("0"))
+    ("l,log_level", "Logging level",
+     cxxopts::value<std::string> ()->default_value ("WARNING"));
+
+  CxxOptsHelper options (cxxopts.parse (argc, argv));
+
+  if (options.exists ("help"))
+  {
+    std::cout << cxxopts.help ({"", "Group"}) << std::endl;
+
+    exit (EXIT_SUCCESS);
+  }
+
+  return options;
+}
+
+/*
+ * Return the change in a counter over an interval as a rate per second
+ */
+double rate (uint64_t current, uint64_t previous, double seconds)
+{
+  return (current >= previous) ? (current - previous) / seconds : 0;
+}
+
+/*
+ * Print the rates and lag measured between two snapshots of the queue metrics
+ */
+void report (const QueueMetrics &metrics, const QueueMetrics &previous,
+             double seconds, size_t capacity)
+{
+  std::cout << std::fixed << std::setprecision (0)
+            << "published=" << metrics.published
+            << " msgs/s=" << rate (metrics.published, previous.published,
+                                   seconds)
+            << " bytes/s=" << rate (metrics.committed, previous.committed,
+                                    seconds)
+            << " cursor=" << metrics.committedCursor
+            << " stalls/s=" << rate (metrics.stalls, previous.stalls, seconds)
+            << " dropped=" << metrics.dropped
+            << " evictions=" << metrics.evictions
+            << " consumers=" << metrics.consumers.size () << "\n";
+
+  std::map<uint8_t, const QueueMetrics::Consumer*> consumed;
+
+  for (auto &consumer : previous.consumers)
+  {
+    consumed[consumer.index] = &consumer;
+  }
+
+  for (auto &consumer : metrics.consumers)
+  {
+    auto last = consumed.find (consumer.index);
+
+    bool known = (last != consumed.end ());
+
+    std::cout << "  consumer index=" << static_cast<int> (consumer.index)
+              << " pid=" << consumer.pid
+              << " cursor=" << consumer.cursor
+              << " consumed=" << consumer.consumed
+              << " msgs/s="
+              << (known ? rate (consumer.consumed, last->second->consumed,
+                                seconds) : 0)
+              << " bytes/s="
+              << (known ? rate (consumer.consumedBytes,
+                                last->second->consumedBytes, seconds) : 0)
+              << " lag=" << consumer.lag
+              << std::setprecision (1)
+              << " (" << (100.0 * consumer.lag / capacity) << "%)"
+              << std::setprecision (0) << "\n";
+  }
+
+  std::cout << std::flush;
+}
+
+} // namespace {
+
+int main (int argc, char *argv[]) try
+{
+  auto options = parse (argc, argv);
+
+  auto name     = options.required<std::string> ("name");
+  auto interval = options.value<uint32_t>       ("interval", 1000);
+  auto count    = options.value<uint32_t>       ("count", 0);
+  auto logLevel = options.value<std::string>    ("log_level", log_levels (),
+                                                 "WARNING");
+  set_log_level (logLevel);
+
+  BOOST_LOG_TRIVIAL (info) << "Start spmc_monitor";
+  /*
+   * Map the queue read-only, the monitor does not register as a consumer and
+   * exerts no back-pressure on the server
+   */
+  using Queue = SPMCQueue<SharedMemory::Allocator>;
+
+  Queue queue (name, name + ":queue", bi::open_read_only);
+
+  std::atomic<bool> stop = { false };
+  /*
+   * Handle signals
+   */
+  SignalCatcher s ({SIGINT, SIGTERM}, [&stop] (int) {
+
+    stop = true;
+  });
+
+  QueueMetrics previous = queue.metrics ();
+
+  auto start = Clock::now ();
+
+  for (uint32_t i = 0; (count == 0 || i < count) && !stop; ++i)
+  {
+    std::this_thread::sleep_for (Milliseconds (interval));
+
+    QueueMetrics metrics = queue.metrics ();
+
+    auto now = Clock::now ();
+
+    report (metrics, previous, std::chrono::duration<double> (now - start)
+                                                        .count (),
+            queue.capacity ());
+
+    previous = std::move (metrics);
+    start    = now;
+  }
+
+  BOOST_LOG_TRIVIAL (info) << "Exit spmc_monitor";
+
+  return EXIT_SUCCESS;
+}
+catch (const cxxopts::OptionException &e)
+{
+  std::cerr << e.what () << std::endl;
+}
+catch (const std::exception &e)
+{
+  std::cerr << e.what () << std::endl;
+}
@@ -1,4 +1,5 @@
 #include "CpuBind.h"
+#include "CpuTopology.h"
 #include "Logger.h"
 #include "SignalCatcher.h"
 #include "SPMCQueue.h"
@@ -22,6 +23,10 @@ CxxOptsHelper parse (int argc, char* argv[])
   std::string level = "NOTICE";
   std::string rate  = "0";
   std::string cpu   = "-1";
+  std::string node  = "-1";
+  std::string consumers = std::to_string (MAX_NO_DROP_CONSUMERS_DEFAULT);
+  std::string lease = "0";
+  std::string lag   = "0";
 
   cxxopts::Options cxxopts ("spmc_server",
         "Message producer for shared memory performance testing");
@@ -35,10 +40,32 @@ CxxOptsHelper parse (int argc, char* argv[])
      cxxopts::value<size_t> ()->default_value (oneMB))
     ("rate", "msgs/sec (value=0 for maximum rate)",
      cxxopts::value<uint32_t> ()->default_value (rate))
+    ("max_consumers", "Maximum number of clients which do not drop messages",
+     cxxopts::value<size_t> ()->default_value (consumers))
+    ("consumer_lease", "Evict a client which blocks the server without reading "
+                       "for longer than this (milliseconds, value=0 to only "
+                       "evict clients which have exited)",
+     cxxopts::value<uint32_t> ()->default_value (lease))
+    ("max_lag", "Demote a client which lags the server by more than this to "
+                "drop messages (bytes, value=0 for no limit)",
+     cxxopts::value<size_t> ()->default_value (lag))
+    ("max_blocked", "Demote the clients which block the server for longer "
+                    "than this to drop messages (milliseconds, value=0 for no "
+                    "limit)",
+     cxxopts::value<uint32_t> ()->default_value (lag))
+    ("numa_node", "Bind the queue memory to a NUMA node, use -1 for default "
+                  "placement",
+     cxxopts::value<int> ()->default_value (node))
+    ("huge_pages", "Back the queue with transparent huge pages",
+     cxxopts::value<bool> ())
+    ("lock_pages", "Lock the queue memory in RAM and pre-fault every page",
+     cxxopts::value<bool> ())
     ("l,log_level", "Logging level",
      cxxopts::value<std::string> ()->default_value (level))
-    ("cpu", "bind main thread to a cpu processor id",
-     cxxopts::value<int> ()->default_value (cpu));
+    ("cpu", "Bind main thread to a cpu processor id, use -1 for no binding. "
+            "Use l3:<cpu> or node:<cpu> to select a cpu sharing the L3 cache "
+            "or NUMA node of a cpu",
+     cxxopts::value<std::string> ()->default_value (cpu));
 
   CxxOptsHelper options (cxxopts.parse (argc, argv));
 
@@ -55,7 +82,11 @@ CxxOptsHelper parse (int argc, char* argv[])
 void server (const std::string& name,
              size_t             messageSize,
              size_t             queueSize,
-             uint32_t           rate)
+             uint32_t           rate,
+             uint8_t            maxConsumers,
+             uint32_t           leaseMs,
+             const LagPolicy   &lagPolicy,
+             const PageOptions &pages)
 {
   BOOST_LOG_TRIVIAL (info) << "Target message rate: "
                            << ((rate == 0) ? "max" : std::to_string (rate));
@@ -66,7 +97,10 @@ void server (const std::string& name,
   using Queue  = SPMCQueue<SharedMemory::Allocator>;
   using Source = SPMCSource<Queue>;
 
-  Source source (name, name + ":queue", queueSize);
+  Source source (name, name + ":queue", queueSize, maxConsumers, pages);
+
+  source.queue ().consumer_lease (Milliseconds (leaseMs));
+  source.queue ().lag_policy (lagPolicy);
 
   std::atomic<bool> stop = { false };
   /*
@@ -126,7 +160,15 @@ int main(int argc, char *argv[]) try
   auto messageSize = options.required<size_t>      ("message_size");
   auto queueSize   = options.required<size_t>      ("queue_size");
   auto rate        = options.value<uint32_t>       ("rate", 0);
-  auto cpu         = options.value<int>            ("cpu", -1);
+  auto cpu         = options.value<std::string>    ("cpu", "-1");
+  auto numaNode    = options.value<int>            ("numa_node", -1);
+  auto consumers   = options.value<size_t>         ("max_consumers",
+                                                    MAX_NO_DROP_CONSUMERS_DEFAULT);
+  auto lease       = options.value<uint32_t>       ("consumer_lease", 0);
+  auto maxLag      = options.value<size_t>         ("max_lag", 0);
+  auto maxBlocked  = options.value<uint32_t>       ("max_blocked", 0);
+  auto hugePages   = options.value<bool>           ("huge_pages", false);
+  auto lockPages   = options.value<bool>           ("lock_pages", false);
   auto logLevel    = options.value<std::string>    ("log_level", log_levels (),
                                                     "INFO");
 
@@ -134,9 +176,22 @@ int main(int argc, char *argv[]) try
 
   BOOST_LOG_TRIVIAL (info) << "Start spmc_server";
 
-  bind_to_cpu (cpu);
+  bind_to_cpu (CpuTopology ().select (cpu));
+
+  CHECK_SS (consumers > 0 && consumers < Index::UnInitialised,
+            "Invalid max_consumers: " << consumers);
+
+  PageOptions pages;
+  pages.hugePages = hugePages;
+  pages.lockPages = lockPages;
+  pages.numaNode  = numaNode;
+
+  LagPolicy lagPolicy;
+  lagPolicy.maxLag     = maxLag;
+  lagPolicy.maxBlocked = Milliseconds (maxBlocked);
 
-  server (name, messageSize, queueSize, rate);
+  server (name, messageSize, queueSize, rate, static_cast<uint8_t> (consumers),
+          lease, lagPolicy, pages);
 
   BOOST_LOG_TRIVIAL (info) << "Exit spmc_server";
 
@@ -4,8 +4,10 @@
 #include "SPSCSource.h"
 #include "Throttle.h"
 #include "detail/CXXOptsHelper.h"
+#include "detail/Pages.h"
 #include "detail/SharedMemory.h"
 #include "detail/SharedMemoryCounter.h"
+#include "detail/SharedMemoryObject.h"
 #include "detail/Utils.h"
 
 #include <boost/interprocess/managed_shared_memory.hpp>
@@ -45,6 +47,10 @@ CxxOptsHelper parse (int argc, char* argv[])
      cxxopts::value<size_t> ()->default_value (oneGB))
     ("rate", "msgs/sec (value=0 for maximum rate)",
      cxxopts::value<uint32_t> ()->default_value (rate))
+    ("huge_pages", "Back the queues with transparent huge pages",
+     cxxopts::value<bool> ())
+    ("lock_pages", "Lock the queue memory in RAM and pre-fault every page",
+     cxxopts::value<bool> ())
     ("l,log_level", "Logging level",
      cxxopts::value<std::string> ()->default_value (level))
     ("cpu", "Bind main thread to a cpu processor id",
@@ -201,6 +207,8 @@ int main(int argc, char *argv[]) try
   auto queueSize   = options.required<size_t>      ("queue_size");
   auto rate        = options.value<uint32_t>       ("rate", 0);
   auto cpu         = options.value<int>            ("cpu", -1);
+  auto hugePages   = options.value<bool>           ("huge_pages", false);
+  auto lockPages   = options.value<bool>           ("lock_pages", false);
   auto logLevel    = options.value<std::string>    ("log_level", log_levels (),
                                                     "INFO");
 
@@ -211,14 +219,23 @@ int main(int argc, char *argv[]) try
   bind_to_cpu (cpu);
 
   /*
-   * Create enough shared memory for each of the clients queues to fit plus some
-   * extra room for shared memory book keeping.
+   * Create enough shared memory for each of the clients queues and doorbells to
+   * fit plus some extra room for shared memory book keeping.
    */
   size_t memorySize = (queueSize * clients)
+                    + (detail::aligned_object_size<detail::Doorbell> ()*clients)
                     + (SharedMemory::BOOK_KEEPING*clients);
 
   auto memory = bi::managed_shared_memory (bi::open_or_create, name.c_str(),
                                            memorySize);
+  /*
+   * Prepare the pages before the queues are constructed in the segment
+   */
+  PageOptions pages;
+  pages.hugePages = hugePages;
+  pages.lockPages = lockPages;
+
+  detail::prepare_pages (memory.get_address (), memory.get_size (), pages);
 
   server (name, clients, messageSize, queueSize, rate);
 